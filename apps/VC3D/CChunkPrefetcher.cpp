@@ -0,0 +1,118 @@
+#include "CChunkPrefetcher.hpp"
+
+#include "vc/core/types/Volume.hpp"
+#include "vc/core/util/Slicing.hpp"
+
+#include <chrono>
+
+using namespace ChaoVis;
+
+//I/O budget of the prefetcher
+#define PREFETCH_MAX_CHUNKS 64
+#define PREFETCH_CHUNKS_PER_SEC 32
+
+CChunkPrefetcher::CChunkPrefetcher(ChunkCache *cache) : _cache(cache)
+{
+    _worker = std::thread(&CChunkPrefetcher::run, this);
+}
+
+CChunkPrefetcher::~CChunkPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cond.notify_all();
+    _worker.join();
+}
+
+void CChunkPrefetcher::request(std::shared_ptr<volcart::Volume> vol, int level, const cv::Mat_<cv::Vec3f> &coords)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _req++;
+        _vol = vol;
+        _level = level;
+        _coords = coords.clone();
+    }
+    _cond.notify_all();
+}
+
+void CChunkPrefetcher::beginForeground()
+{
+    _foreground++;
+}
+
+void CChunkPrefetcher::endForeground()
+{
+    _foreground--;
+    _cond.notify_all();
+}
+
+bool CChunkPrefetcher::waitForeground(uint64_t req)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    //foreground changes are not signalled under the lock, so poll with a short timeout
+    while (_foreground > 0 && !_stop && req == _req)
+        _cond.wait_for(lock, std::chrono::milliseconds(10));
+    
+    return !_stop && req == _req;
+}
+
+void CChunkPrefetcher::run()
+{
+    uint64_t done_req = 0;
+    auto window_start = std::chrono::steady_clock::now();
+    int window_reads = 0;
+    
+    while (true) {
+        uint64_t req;
+        std::shared_ptr<volcart::Volume> vol;
+        int level;
+        cv::Mat_<cv::Vec3f> coords;
+        
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&]{ return _stop || _req != done_req; });
+            if (_stop)
+                return;
+            
+            req = done_req = _req;
+            vol = _vol;
+            level = _level;
+            coords = _coords;
+            _vol = nullptr;
+            _coords = cv::Mat_<cv::Vec3f>();
+        }
+        
+        z5::Dataset *ds = vol ? vol->zarrDataset(level) : nullptr;
+        if (!ds)
+            continue;
+        
+        std::vector<cv::Vec3i> ids = chunksForCoords(ds, coords, pow(2,-level));
+        
+        int reads = 0;
+        for(auto &id : ids) {
+            if (reads >= PREFETCH_MAX_CHUNKS || !waitForeground(req))
+                break;
+            
+            //rate limit, sleeps are interrupted by new requests
+            if (window_reads >= PREFETCH_CHUNKS_PER_SEC) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait_until(lock, window_start + std::chrono::seconds(1), [&]{ return _stop || req != _req; });
+                if (_stop || req != _req)
+                    break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now - window_start >= std::chrono::seconds(1)) {
+                window_start = now;
+                window_reads = 0;
+            }
+            
+            if (prefetchChunk(ds, _cache, id)) {
+                reads++;
+                window_reads++;
+            }
+        }
+    }
+}
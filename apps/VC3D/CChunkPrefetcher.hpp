@@ -0,0 +1,57 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class ChunkCache;
+
+namespace volcart {
+    class Volume;
+}
+
+namespace ChaoVis
+{
+
+//low priority read-ahead of volume chunks into the shared ChunkCache
+//viewers request the coords of the view they expect next, only the latest request is kept and worked on by a
+//single background thread which pauses while any foreground (on-screen) rendering is running and never reads more
+//than PREFETCH_MAX_CHUNKS chunks per request and PREFETCH_CHUNKS_PER_SEC chunks per second
+class CChunkPrefetcher
+{
+public:
+    CChunkPrefetcher(ChunkCache *cache);
+    ~CChunkPrefetcher();
+    
+    //replace the pending request, coords are full resolution volume coordinates which get read from pyramid level
+    void request(std::shared_ptr<volcart::Volume> vol, int level, const cv::Mat_<cv::Vec3f> &coords);
+    
+    //on-screen rendering, prefetching pauses while any is active
+    void beginForeground();
+    void endForeground();
+    
+protected:
+    void run();
+    //wait until no foreground render is active, returns false if the current request was superseded
+    bool waitForeground(uint64_t req);
+    
+    ChunkCache *_cache;
+    
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::thread _worker;
+    bool _stop = false;
+    
+    uint64_t _req = 0;
+    std::shared_ptr<volcart::Volume> _vol;
+    int _level = 0;
+    cv::Mat_<cv::Vec3f> _coords;
+    
+    std::atomic<int> _foreground = 0;
+};
+
+}  // namespace ChaoVis
@@ -7,9 +7,14 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 
+#include <opencv2/imgproc.hpp>
+
+#include <numeric>
+
 #include "CVolumeViewerView.hpp"
 #include "SegmentationStruct.hpp"
 #include "CSurfaceCollection.hpp"
+#include "CChunkPrefetcher.hpp"
 
 #include "vc/core/types/VolumePkg.hpp"
 #include "vc/core/util/Surface.hpp"
@@ -25,6 +30,20 @@ using qga = QGuiApplication;
 // #define ZOOM_FACTOR 1.148698354997035
 #define ZOOM_FACTOR 2.0 //1.414213562373095
 
+//background renderer: tile size and how many pyramid levels below the display level the first (coarse) pass uses
+#define RENDER_TILE_SIZE 256
+#define RENDER_COARSE_LEVELS 2
+//number of rendered tiles kept per viewer (64kB each)
+#define RENDER_TILE_CACHE_SIZE 1024
+//min delay between pixmap updates while tiles arrive
+#define RENDER_FLUSH_MS 30
+
+//prefetch: predicted views are sampled every PREFETCH_STRIDE scene pixels to find their chunks, pans are
+//extrapolated PREFETCH_LOOKAHEAD seconds ahead and forgotten after PREFETCH_VELOCITY_TIMEOUT seconds without movement
+#define PREFETCH_STRIDE 8
+#define PREFETCH_LOOKAHEAD 0.5
+#define PREFETCH_VELOCITY_TIMEOUT 0.3
+
 CVolumeViewer::CVolumeViewer(CSurfaceCollection *col, QWidget* parent)
     : QWidget(parent)
     , fGraphicsView(nullptr)
@@ -61,11 +80,23 @@ CVolumeViewer::CVolumeViewer(CSurfaceCollection *col, QWidget* parent)
     aWidgetLayout->addWidget(fGraphicsView);
 
     setLayout(aWidgetLayout);
+    
+    //a single worker per viewer, tiles are rendered in order (coarse first) and a new request cancels the old one
+    _render_pool = new QThreadPool(this);
+    _render_pool->setMaxThreadCount(1);
+    
+    //intersections are independent per surface, use all cores
+    _intersect_pool = new QThreadPool(this);
 }
 
 // Destructor
 CVolumeViewer::~CVolumeViewer(void)
 {
+    cancelRender();
+    cancelIntersections();
+    _render_pool->waitForDone();
+    _intersect_pool->waitForDone();
+    
     deleteNULL(fGraphicsView);
     deleteNULL(fScene);
 }
@@ -139,10 +170,18 @@ void CVolumeViewer::onZoom(int steps, QPointF scene_loc, Qt::KeyboardModifiers m
     if (modifiers & Qt::ShiftModifier) {
         _z_off += steps;
         renderVisible(true);
+        
+        //expect the next slice in the same direction
+        QRectF bbox = fGraphicsView->mapToScene(fGraphicsView->viewport()->geometry()).boundingRect();
+        prefetch(bbox, _ds_sd_idx, _z_off+steps);
     }
     else {
         float zoom = pow(ZOOM_FACTOR, steps);
         
+        //for non plane surfaces the scene to surface mapping gets re-anchored on zoom
+        if (!dynamic_cast<PlaneSurface*>(_surf))
+            invalidateTiles();
+        
         _scale *= zoom;
         round_scale(_scale);
 
@@ -183,6 +222,14 @@ void CVolumeViewer::onZoom(int steps, QPointF scene_loc, Qt::KeyboardModifiers m
         
         fGraphicsView->centerOn(center);
         renderVisible();
+        
+        //expect another zoom step in the same direction
+        QRectF bbox = fGraphicsView->mapToScene(fGraphicsView->viewport()->geometry()).boundingRect();
+        float next_zoom = pow(ZOOM_FACTOR, steps > 0 ? 1 : -1);
+        QPointF c = bbox.center();
+        QRectF next_bbox(c - QPointF(bbox.width(), bbox.height())*0.5/next_zoom, bbox.size()/next_zoom);
+        int next_idx = std::max<int>(-log2(_max_scale), _ds_sd_idx + (steps > 0 ? -1 : 1));
+        prefetch(next_bbox, next_idx, _z_off);
     }
     
     renderIntersections();
@@ -191,6 +238,7 @@ void CVolumeViewer::onZoom(int steps, QPointF scene_loc, Qt::KeyboardModifiers m
 void CVolumeViewer::OnVolumeChanged(volcart::Volume::Pointer volume_)
 {
     volume = volume_;
+    invalidateTiles();
     
     printf("sizes %d %d %d\n", volume_->sliceWidth(), volume_->sliceHeight(), volume_->numSlices());
     
@@ -228,6 +276,11 @@ void CVolumeViewer::setCache(ChunkCache *cache_)
     cache = cache_;
 }
 
+void CVolumeViewer::setPrefetcher(CChunkPrefetcher *prefetcher)
+{
+    _prefetcher = prefetcher;
+}
+
 void CVolumeViewer::setSurface(const std::string &name)
 {
     _surf_name = name;
@@ -247,23 +300,51 @@ void CVolumeViewer::invalidateVis()
     slice_vis_items.resize(0);
 }
 
+void CVolumeViewer::removeIntersectItems(std::unordered_map<std::string,std::vector<QGraphicsItem*>> &items, const std::string &key)
+{
+    if (!items.count(key))
+        return;
+    
+    for(auto &item : items[key]) {
+        fScene->removeItem(item);
+        delete item;
+    }
+    items.erase(key);
+}
+
+//swap in the new items of a surface in one step, replacing current and stale ones
+void CVolumeViewer::setIntersectItems(const std::string &key, const std::vector<QGraphicsItem*> &items)
+{
+    removeIntersectItems(_stale_intersect_items, key);
+    removeIntersectItems(_intersect_items, key);
+    _intersect_items[key] = items;
+}
+
+void CVolumeViewer::cancelIntersections()
+{
+    _intersect_gen++;
+    _intersect_pool->clear();
+    _intersect_pending.clear();
+}
+
 void CVolumeViewer::invalidateIntersect(const std::string &name)
 {
+    //results still in flight were computed for the old state, anything not yet displayed gets requested again
+    cancelIntersections();
+    
+    std::vector<std::string> keys;
     if (!name.size() || name == _surf_name) {
-        for(auto &pair : _intersect_items) {
-            for(auto &item : pair.second) {
-                fScene->removeItem(item);
-                delete item;
-            }
-        }
-        _intersect_items.clear();
+        for(auto &pair : _intersect_items)
+            keys.push_back(pair.first);
     }
-    else if (_intersect_items.count(name)) {
-        for(auto &item : _intersect_items[name]) {
-            fScene->removeItem(item);
-            delete item;
-        }
-        _intersect_items.erase(name);
+    else if (_intersect_items.count(name))
+        keys.push_back(name);
+    
+    //keep showing the old lines until the replacement is ready
+    for(auto &key : keys) {
+        removeIntersectItems(_stale_intersect_items, key);
+        _stale_intersect_items[key] = _intersect_items[key];
+        _intersect_items.erase(key);
     }
 }
 
@@ -298,9 +379,19 @@ void CVolumeViewer::setIntersects(const std::set<std::string> &set)
 void CVolumeViewer::onSurfaceChanged(std::string name, Surface *surf)
 {
     if (_surf_name == name) {
+        invalidateTiles();
         _surf = surf;
-        if (!_surf)
+        if (!_surf) {
+            cancelRender();
+            cancelIntersections();
             fScene->clear();
+            _intersect_items.clear();
+            _stale_intersect_items.clear();
+            fBaseImageItem = nullptr;
+            _center_marker = nullptr;
+            _cursor = nullptr;
+            _canvas = QImage();
+        }
         else
             invalidateVis();
     }
@@ -360,9 +451,16 @@ void CVolumeViewer::onPOIChanged(std::string name, POI *poi)
         if (poi->p == plane->origin())
             return;
         
+        cv::Vec3f delta = poi->p - plane->origin();
+        
         plane->setOrigin(poi->p);
         
         _surf_col->setSurface(_surf_name, plane);
+        
+        //expect the focus to keep moving the same way
+        PlaneSurface next(poi->p + delta, plane->normal(nullptr));
+        QRectF bbox = fGraphicsView->mapToScene(fGraphicsView->viewport()->geometry()).boundingRect();
+        prefetch(bbox, _ds_sd_idx, _z_off, &next);
     }
     else if (name == "cursor") {
         PlaneSurface *slice_plane = dynamic_cast<PlaneSurface*>(_surf);
@@ -397,45 +495,271 @@ void CVolumeViewer::onPOIChanged(std::string name, POI *poi)
     }
 }
 
-cv::Mat CVolumeViewer::render_area(const cv::Rect &roi)
+//moves the surface pointer to the center of roi, PlaneSurface use absolute positioning and need none
+void CVolumeViewer::centerPtr(const cv::Rect &roi)
 {
-    cv::Mat_<cv::Vec3f> coords;
-    cv::Mat_<uint8_t> img;
+    if (dynamic_cast<PlaneSurface*>(_surf))
+        return;
+    
+    cv::Vec2f roi_c = {roi.x+roi.width/2, roi.y + roi.height/2};
 
-    //PlaneSurface use absolute positioning to simplify intersection logic
-    if (dynamic_cast<PlaneSurface*>(_surf)) {
-        _surf->gen(&coords, nullptr, roi.size(), nullptr, _ds_scale, {roi.x, roi.y, _z_off});
+    if (!_ptr) {
+        _ptr = _surf->pointer();
+        _vis_center = roi_c;
     }
     else {
-        cv::Vec2f roi_c = {roi.x+roi.width/2, roi.y + roi.height/2};
+        cv::Vec3f diff = {roi_c[0]-_vis_center[0],roi_c[1]-_vis_center[1],0};
+        _surf->move(_ptr, diff/_ds_scale);
+        _vis_center = roi_c;
+    }
+}
 
-        if (!_ptr) {
-            _ptr = _surf->pointer();
-            _vis_center = roi_c;
-        }
-        else {
-            cv::Vec3f diff = {roi_c[0]-_vis_center[0],roi_c[1]-_vis_center[1],0};
-            _surf->move(_ptr, diff/_ds_scale);
-            _vis_center = roi_c;
-        }
+//coords of roi, ptr has to be centered on roi with centerPtr() unless surf is a plane
+static void gen_area(cv::Mat_<cv::Vec3f> &coords, Surface *surf, SurfacePointer *ptr, const cv::Rect &roi, float scale, float z_off)
+{
+    //PlaneSurface use absolute positioning to simplify intersection logic
+    if (dynamic_cast<PlaneSurface*>(surf))
+        surf->gen(&coords, nullptr, roi.size(), nullptr, scale, {roi.x, roi.y, z_off});
+    else
+        surf->gen(&coords, nullptr, roi.size(), ptr, scale, {-roi.width/2, -roi.height/2, z_off});
+}
 
-        _surf->gen(&coords, nullptr, roi.size(), _ptr, _ds_scale, {-roi.width/2, -roi.height/2, _z_off});
-        
-        if (_surf_name == "segmentation") {
-            invalidateIntersect();
+//the segmentation view publishes the coords it shows as visible_segmentation
+void CVolumeViewer::setVisibleSegmentation(const cv::Mat_<cv::Vec3f> &coords)
+{
+    invalidateIntersect();
+
+    QuadSurface *old_crop = dynamic_cast<QuadSurface*>(_surf_col->surface("visible_segmentation"));
+    
+    QuadSurface *crop = new QuadSurface(coords, {_ds_scale, _ds_scale});
+    _surf_col->setSurface("visible_segmentation", crop);
+    if (old_crop)
+        delete old_crop;
+}
+
+cv::Mat_<cv::Vec3f> CVolumeViewer::coords_area(const cv::Rect &roi)
+{
+    cv::Mat_<cv::Vec3f> coords;
 
-            QuadSurface *old_crop = dynamic_cast<QuadSurface*>(_surf_col->surface("visible_segmentation"));
+    centerPtr(roi);
+    gen_area(coords, _surf, _ptr, roi, _ds_scale, _z_off);
+    
+    if (_surf_name == "segmentation" && !dynamic_cast<PlaneSurface*>(_surf))
+        setVisibleSegmentation(coords);
+    
+    return coords;
+}
+
+cv::Mat CVolumeViewer::render_area(const cv::Rect &roi)
+{
+    cv::Mat_<cv::Vec3f> coords = coords_area(roi);
+    cv::Mat_<uint8_t> img;
+
+    readInterpolated3D(img, volume->zarrDataset(_ds_sd_idx), coords*_ds_scale, cache);
+    
+    return img;
+}
+
+void CVolumeViewer::cancelRender()
+{
+    _render_gen++;
+    _render_pool->clear();
+}
+
+void CVolumeViewer::invalidateTiles()
+{
+    _tile_version++;
+    _tile_cache.clear();
+}
+
+//render roi (curr_img_area at the current scale) in the background: the coords are generated by the worker, then
+//first all tiles are sampled from a coarser pyramid level and refined at the display level after.
+//tiles are rendered center-out and handed back to the GUI thread one by one
+void CVolumeViewer::renderAsync(const cv::Rect &roi)
+{
+    cancelRender();
+    uint64_t gen = _render_gen;
+    
+    //keep what is still valid from the last render visible until the new tiles arrive
+    QImage canvas(curr_img_area.size(), QImage::Format_Grayscale8);
+    canvas.fill(0);
+    if (!_canvas.isNull() && _canvas_ds_scale == _ds_scale && _canvas_z_off == _z_off) {
+        QPainter painter(&canvas);
+        painter.drawImage(_canvas_area.topLeft()-curr_img_area.topLeft(), _canvas);
+    }
+    _canvas = canvas;
+    _canvas_area = curr_img_area;
+    _canvas_ds_scale = _ds_scale;
+    _canvas_z_off = _z_off;
+    
+    //curr_img_area is aligned to the tile grid, reuse cached tiles and only render the missing ones
+    std::vector<cv::Rect> tiles;
+    std::vector<TileKey> keys;
+    for(int y=0;y<roi.height;y+=RENDER_TILE_SIZE)
+        for(int x=0;x<roi.width;x+=RENDER_TILE_SIZE) {
+            cv::Rect tile = cv::Rect(x, y, RENDER_TILE_SIZE, RENDER_TILE_SIZE) & cv::Rect(0, 0, roi.width, roi.height);
+            TileKey key = {_tile_version, _ds_sd_idx, _z_off, (curr_img_area.x()+x)/RENDER_TILE_SIZE, (curr_img_area.y()+y)/RENDER_TILE_SIZE};
             
-            QuadSurface *crop = new QuadSurface(coords.clone(), {_ds_scale, _ds_scale});
-            _surf_col->setSurface("visible_segmentation", crop);
-            if (old_crop)
-                delete old_crop;
+            auto it = _tile_cache.find(key);
+            if (it != _tile_cache.end() && it->second.first.size() == tile.size()) {
+                it->second.second = ++_tile_generation;
+                const cv::Mat &img = it->second.first;
+                for(int j=0;j<img.rows;j++)
+                    memcpy(_canvas.scanLine(tile.y+j)+tile.x, img.ptr<uint8_t>(j), img.cols);
+                continue;
+            }
+            
+            tiles.push_back(tile);
+            keys.push_back(key);
+        }
+    flushCanvas();
+    
+    //the segmentation view needs the coords of the whole area even if all tiles are cached
+    bool publish = _surf_name == "segmentation" && !dynamic_cast<PlaneSurface*>(_surf);
+    if (tiles.empty() && !publish)
+        return;
+    
+    cv::Point2f c(roi.width*0.5, roi.height*0.5);
+    auto center_dist = [&c](const cv::Rect &r) {
+        cv::Point2f d = cv::Point2f(r.x+r.width*0.5, r.y+r.height*0.5)-c;
+        return d.dot(d);
+    };
+    std::vector<int> order(tiles.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&center_dist,&tiles](int a, int b) {
+        return center_dist(tiles[a]) < center_dist(tiles[b]);
+    });
+    
+    std::vector<int> levels;
+    int coarse_idx = std::min<int>(_ds_sd_idx+RENDER_COARSE_LEVELS, volume->numScales()-1);
+    if (coarse_idx > _ds_sd_idx)
+        levels.push_back(coarse_idx);
+    levels.push_back(_ds_sd_idx);
+    
+    std::shared_ptr<volcart::Volume> vol = volume;
+    ChunkCache *chunk_cache = cache;
+    CChunkPrefetcher *prefetcher = _prefetcher;
+    int fine_idx = _ds_sd_idx;
+    float ds_scale = _ds_scale;
+    float z_off = _z_off;
+    
+    //the worker gets its own copy of a plane and of the pointer so the GUI may move both meanwhile,
+    //other surfaces are OpChains which serialize gen() themselves
+    std::shared_ptr<Surface> plane_copy;
+    if (PlaneSurface *plane = dynamic_cast<PlaneSurface*>(_surf))
+        plane_copy = std::make_shared<PlaneSurface>(*plane);
+    Surface *surf = plane_copy ? plane_copy.get() : _surf;
+    std::shared_ptr<SurfacePointer> ptr(_ptr ? _ptr->clone() : nullptr);
+    
+    _render_pool->start([this, gen, vol, chunk_cache, prefetcher, plane_copy, surf, ptr, roi, ds_scale, z_off, publish, tiles, keys, order, levels, fine_idx]() {
+        //prefetching pauses while we render on-screen tiles
+        if (prefetcher)
+            prefetcher->beginForeground();
+        
+        cv::Mat_<cv::Vec3f> coords;
+        
+        auto render_tiles = [&]() {
+            //OpChain ops may sample the volume, so this can take a while
+            gen_area(coords, surf, ptr.get(), roi, ds_scale, z_off);
+            
+            if (gen != _render_gen)
+                return;
+            
+            if (publish)
+                QMetaObject::invokeMethod(this, [this, gen, coords]() { onCoordsGenerated(gen, coords); }, Qt::QueuedConnection);
+            
+            for(int level : levels) {
+                z5::Dataset *ds = vol->zarrDataset(level);
+                float level_scale = pow(2,-level);
+                int f = 1 << (level-fine_idx);
+            
+                for(int t : order) {
+                    const cv::Rect &tile = tiles[t];
+                    const TileKey &key = keys[t];
+                
+                    if (gen != _render_gen)
+                        return;
+                
+                    cv::Mat_<cv::Vec3f> tile_coords = coords(tile);
+                    cv::Mat_<uint8_t> img;
+                
+                    if (f > 1) {
+                        cv::Mat_<cv::Vec3f> small;
+                        cv::resize(tile_coords, small, {std::max(1,tile.width/f), std::max(1,tile.height/f)}, 0, 0, cv::INTER_NEAREST);
+                        readInterpolated3D(img, ds, small*level_scale, chunk_cache);
+                        cv::resize(img, img, tile.size(), 0, 0, cv::INTER_LINEAR);
+                    }
+                    else
+                        readInterpolated3D(img, ds, tile_coords*level_scale, chunk_cache);
+                
+                    bool final = level == fine_idx;
+                    QMetaObject::invokeMethod(this, [this, gen, key, tile, img, final]() { onTileRendered(gen, key, tile, img, final); }, Qt::QueuedConnection);
+                }
+            }
+        };
+        render_tiles();
+        
+        if (prefetcher)
+            prefetcher->endForeground();
+    });
+}
+
+void CVolumeViewer::onCoordsGenerated(uint64_t gen, const cv::Mat_<cv::Vec3f> &coords)
+{
+    //_vis_center and _ds_scale only match the coords of the latest request
+    if (gen != _render_gen)
+        return;
+    
+    setVisibleSegmentation(coords);
+}
+
+void CVolumeViewer::onTileRendered(uint64_t gen, const TileKey &key, const cv::Rect &tile, const cv::Mat &img, bool final)
+{
+    //tiles of a cancelled request are still valid as long as the surface did not change
+    if (final && key.version == _tile_version) {
+        _tile_cache[key] = {img, ++_tile_generation};
+        
+        if (_tile_cache.size() > RENDER_TILE_CACHE_SIZE) {
+            //we delete 25% of the cache content to amortize sorting costs
+            using KG = std::pair<TileKey, uint64_t>;
+            std::vector<KG> gen_list;
+            for(auto &it : _tile_cache)
+                gen_list.push_back({it.first, it.second.second});
+            std::sort(gen_list.begin(), gen_list.end(), [](const KG &a, const KG &b){ return a.second < b.second; });
+            for(int i=0;i<RENDER_TILE_CACHE_SIZE/4;i++)
+                _tile_cache.erase(gen_list[i].first);
         }
     }
+    
+    if (gen != _render_gen || _canvas.isNull())
+        return;
+    
+    for(int j=0;j<img.rows;j++)
+        memcpy(_canvas.scanLine(tile.y+j)+tile.x, img.ptr<uint8_t>(j), img.cols);
+    
+    //coalesce pixmap updates, converting the whole canvas for every tile would be wasteful
+    if (!_canvas_flush_pending) {
+        _canvas_flush_pending = true;
+        QTimer::singleShot(RENDER_FLUSH_MS, this, &CVolumeViewer::flushCanvas);
+    }
+}
 
-    readInterpolated3D(img, volume->zarrDataset(_ds_sd_idx), coords*_ds_scale, cache);
+void CVolumeViewer::flushCanvas()
+{
+    _canvas_flush_pending = false;
     
-    return img;
+    if (_canvas.isNull())
+        return;
+    
+    QPixmap pixmap = QPixmap::fromImage(_canvas, fSkipImageFormatConv ? Qt::NoFormatConversion : Qt::AutoColor);
+    
+    // Add the QPixmap to the scene as a QGraphicsPixmapItem
+    if (!fBaseImageItem)
+        fBaseImageItem = fScene->addPixmap(pixmap);
+    else
+        fBaseImageItem->setPixmap(pixmap);
+    
+    fBaseImageItem->setOffset(_canvas_area.topLeft());
 }
 
 class LifeTime
@@ -465,19 +789,17 @@ void CVolumeViewer::renderVisible(bool force)
     if (!force && QRectF(curr_img_area).contains(bbox))
         return;
     
-    curr_img_area = {bbox.left()-128,bbox.top()-128, bbox.width()+256, bbox.height()+256};
+    //align to the tile grid so rendered tiles can be reused when panning
+    int x0 = floor((bbox.left()-128)/RENDER_TILE_SIZE)*RENDER_TILE_SIZE;
+    int y0 = floor((bbox.top()-128)/RENDER_TILE_SIZE)*RENDER_TILE_SIZE;
+    int x1 = ceil((bbox.right()+128)/RENDER_TILE_SIZE)*RENDER_TILE_SIZE;
+    int y1 = ceil((bbox.bottom()+128)/RENDER_TILE_SIZE)*RENDER_TILE_SIZE;
+    curr_img_area = {x0, y0, x1-x0, y1-y0};
     
-    cv::Mat img = render_area({curr_img_area.x(), curr_img_area.y(), curr_img_area.width(), curr_img_area.height()});
-    
-    QImage qimg = Mat2QImage(img);
-    
-    QPixmap pixmap = QPixmap::fromImage(qimg, fSkipImageFormatConv ? Qt::NoFormatConversion : Qt::AutoColor);
-    //     
-    // Add the QPixmap to the scene as a QGraphicsPixmapItem
-    if (!fBaseImageItem)
-        fBaseImageItem = fScene->addPixmap(pixmap);
-    else
-        fBaseImageItem->setPixmap(pixmap);
+    //only the pointer moves here, generating the coords and sampling the volume happens in the background
+    cv::Rect roi = {curr_img_area.x(), curr_img_area.y(), curr_img_area.width(), curr_img_area.height()};
+    centerPtr(roi);
+    renderAsync(roi);
     
     if (!_center_marker) {
         _center_marker = fScene->addEllipse({-10,-10,20,20}, QPen(Qt::yellow, 3, Qt::DashDotLine, Qt::RoundCap, Qt::RoundJoin));
@@ -485,8 +807,6 @@ void CVolumeViewer::renderVisible(bool force)
     }
 
     _center_marker->setParentItem(fBaseImageItem);
-    
-    fBaseImageItem->setOffset(curr_img_area.topLeft());
 
     invalidateIntersect();
     renderIntersections();
@@ -512,15 +832,15 @@ void CVolumeViewer::renderIntersections()
     
     std::vector<std::string> remove;
     for (auto &pair : _intersect_items)
-        if (!_intersect_tgts.count(pair.first)) {
-            for(auto &item : pair.second) {
-                fScene->removeItem(item);
-                delete item;
-            }
+        if (!_intersect_tgts.count(pair.first))
             remove.push_back(pair.first);
-        }
-    for(auto key : remove)
-        _intersect_items.erase(key);
+    for (auto &pair : _stale_intersect_items)
+        if (!_intersect_tgts.count(pair.first) || _z_off)
+            remove.push_back(pair.first);
+    for(auto key : remove) {
+        removeIntersectItems(_intersect_items, key);
+        removeIntersectItems(_stale_intersect_items, key);
+    }
 
     PlaneSurface *plane = dynamic_cast<PlaneSurface*>(_surf);
     
@@ -528,42 +848,36 @@ void CVolumeViewer::renderIntersections()
         return;
     
     if (plane) {
+        //the workers get their own copy of the plane and share each grid so the GUI may move on meanwhile
+        PlaneSurface plane_copy = *plane;
+        cv::Rect plane_roi = {curr_img_area.x()/_ds_scale, curr_img_area.y()/_ds_scale, curr_img_area.width()/_ds_scale, curr_img_area.height()/_ds_scale};
+        float step = 4/_ds_scale;
+        uint64_t gen = _intersect_gen;
+        
         for(auto key : _intersect_tgts)
-            if (!_intersect_items.count(key) && dynamic_cast<QuadSurface*>(_surf_col->surface(key))) {
+            if (!_intersect_items.count(key) && !_intersect_pending.count(key) && dynamic_cast<QuadSurface*>(_surf_col->surface(key))) {
             
             QuadSurface *segmentation = dynamic_cast<QuadSurface*>(_surf_col->surface(key));
+            std::shared_ptr<const cv::Mat_<cv::Vec3f>> points = segmentation->sharedPoints();
+            std::shared_ptr<const GridBoundsTree> tree = segmentation->boundsTree();
             
-            std::vector<std::vector<cv::Vec2f>> xy_seg_;
-            std::vector<std::vector<cv::Vec3f>> intersections;
-            
-            cv::Rect plane_roi = {curr_img_area.x()/_ds_scale, curr_img_area.y()/_ds_scale, curr_img_area.width()/_ds_scale, curr_img_area.height()/_ds_scale};
-            
-            find_intersect_segments(intersections, xy_seg_, segmentation->rawPoints(), plane, plane_roi, 4/_ds_scale);
-            
-            std::vector<QGraphicsItem*> items;
-            
-            for (auto seg : intersections) {
-                QColor col(128+rand()%127, 128+rand()%127, 128+rand()%127);
-                QPainterPath path;
+            _intersect_pending.insert(key);
+            _intersect_pool->start([this, gen, key, points, tree, plane_copy, plane_roi, step]() mutable {
+                if (gen != _intersect_gen)
+                    return;
                 
-                bool first = true;
-                for (auto wp : seg)
-                {
-                    cv::Vec3f p = plane->project(wp, 1.0, _ds_scale);
-                    if (first)
-                        path.moveTo(p[0],p[1]);
-                    else
-                        path.lineTo(p[0],p[1]);
-                    first = false;
-                }
-                auto item = fGraphicsView->scene()->addPath(path, QPen(Qt::yellow, 1/_scene_scale));
-                item->setZValue(5);
-                items.push_back(item);
-            }
-            _intersect_items[key] = items;
-            _ignore_intersect_change = new Intersection({intersections});
-            _surf_col->setIntersection(_surf_name, key, _ignore_intersect_change);
-            _ignore_intersect_change = nullptr;
+                std::vector<std::vector<cv::Vec2f>> xy_seg_;
+                std::vector<std::vector<cv::Vec3f>> intersections;
+                
+                find_intersect_segments(intersections, xy_seg_, *points, &plane_copy, plane_roi, step, tree.get());
+                
+                if (gen != _intersect_gen)
+                    return;
+                
+                QMetaObject::invokeMethod(this, [this, gen, key, intersections]() {
+                    onIntersectionComputed(gen, key, intersections);
+                }, Qt::QueuedConnection);
+            });
         }
     }
     else if (_surf_name == "segmentation" && dynamic_cast<QuadSurface*>(_surf_col->surface("visible_segmentation"))) {
@@ -623,12 +937,103 @@ void CVolumeViewer::renderIntersections()
                 item->setZValue(5);
                 items.push_back(item);
             }
-            _intersect_items[key] = items;
+            setIntersectItems(key, items);
+        }
+    }
+}
+
+void CVolumeViewer::onIntersectionComputed(uint64_t gen, const std::string &key, const std::vector<std::vector<cv::Vec3f>> &intersections)
+{
+    //plane or targets changed since the request, a newer one is already running
+    if (gen != _intersect_gen)
+        return;
+    
+    _intersect_pending.erase(key);
+    
+    PlaneSurface *plane = dynamic_cast<PlaneSurface*>(_surf);
+    if (!plane || _z_off || !_intersect_tgts.count(key))
+        return;
+    
+    std::vector<QGraphicsItem*> items;
+    
+    for (auto seg : intersections) {
+        QPainterPath path;
+        
+        bool first = true;
+        for (auto wp : seg)
+        {
+            cv::Vec3f p = plane->project(wp, 1.0, _ds_scale);
+            if (first)
+                path.moveTo(p[0],p[1]);
+            else
+                path.lineTo(p[0],p[1]);
+            first = false;
         }
+        auto item = fGraphicsView->scene()->addPath(path, QPen(Qt::yellow, 1/_scene_scale));
+        item->setZValue(5);
+        items.push_back(item);
     }
+    setIntersectItems(key, items);
+    
+    _ignore_intersect_change = new Intersection({intersections});
+    _surf_col->setIntersection(_surf_name, key, _ignore_intersect_change);
+    _ignore_intersect_change = nullptr;
 }
 
 void CVolumeViewer::onScrolled()
 {
     renderVisible();
+    predictPan();
+}
+
+//extrapolate the pan velocity to prefetch the view we will probably see next
+void CVolumeViewer::predictPan()
+{
+    QRectF bbox = fGraphicsView->mapToScene(fGraphicsView->viewport()->geometry()).boundingRect();
+    QPointF c = bbox.center();
+    auto now = std::chrono::steady_clock::now();
+    
+    double dt = std::chrono::duration<double>(now - _last_view_time).count();
+    if (dt > 0 && dt < PREFETCH_VELOCITY_TIMEOUT)
+        _view_velocity = 0.5*_view_velocity + 0.5*(c - _last_view_center)/dt;
+    else
+        _view_velocity = {0,0};
+    
+    _last_view_center = c;
+    _last_view_time = now;
+    
+    QPointF shift = _view_velocity*PREFETCH_LOOKAHEAD;
+    if (shift.manhattanLength() < PREFETCH_STRIDE)
+        return;
+    
+    prefetch(bbox.translated(shift), _ds_sd_idx, _z_off);
+}
+
+//hand the coarsely sampled coords of a predicted view (scene rect at the current scale) to the prefetcher
+void CVolumeViewer::prefetch(const QRectF &rect, int level, float z_off, Surface *surf)
+{
+    if (!_prefetcher || !volume || level < 0 || level >= volume->numScales())
+        return;
+    
+    if (!surf)
+        surf = _surf;
+    
+    int k = PREFETCH_STRIDE;
+    cv::Size size(std::max(1, int(rect.width()/k)), std::max(1, int(rect.height()/k)));
+    cv::Mat_<cv::Vec3f> coords;
+    
+    if (dynamic_cast<PlaneSurface*>(surf))
+        surf->gen(&coords, nullptr, size, nullptr, _ds_scale/k, {rect.x()/k, rect.y()/k, z_off/k});
+    //OpChain::gen() has side effects (and might read the volume itself) so only plain quad surfaces get predicted
+    else if (dynamic_cast<QuadSurface*>(surf) && _ptr) {
+        SurfacePointer *ptr = _ptr->clone();
+        QPointF c = rect.center();
+        surf->move(ptr, {(c.x()-_vis_center[0])/_ds_scale, (c.y()-_vis_center[1])/_ds_scale, 0});
+        surf->gen(&coords, nullptr, size, ptr, _ds_scale/k, {-size.width/2, -size.height/2, z_off/k});
+        delete ptr;
+    }
+    else
+        return;
+    
+    _prefetcher->request(volume, level, coords);
 }
@@ -5,6 +5,8 @@
 #include <QtWidgets>
 #include <opencv2/core/core.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <set>
 
 class ChunkCache;
@@ -22,9 +24,36 @@ namespace ChaoVis
 
 class CVolumeViewerView;
 class CSurfaceCollection;
+class CChunkPrefetcher;
 class POI;
 class Intersection;
 
+//identifies a rendered tile, version changes whenever the content of the viewer surface changes
+struct TileKey
+{
+    uint64_t version;
+    int ds_idx;
+    float z_off;
+    int x;
+    int y;
+    
+    bool operator==(const TileKey &o) const
+    {
+        return version == o.version && ds_idx == o.ds_idx && z_off == o.z_off && x == o.x && y == o.y;
+    }
+};
+
+struct tile_key_hash {
+    size_t operator()(const TileKey &k) const
+    {
+        size_t hash = std::hash<uint64_t>{}(k.version);
+        //magic numbers from boost. should be good enough
+        for(size_t h : {std::hash<int>{}(k.ds_idx), std::hash<float>{}(k.z_off), std::hash<int>{}(k.x), std::hash<int>{}(k.y)})
+            hash ^= h + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
 class CVolumeViewer : public QWidget
 {
     Q_OBJECT
@@ -34,12 +63,17 @@ public:
     ~CVolumeViewer(void);
 
     void setCache(ChunkCache *cache);
+    void setPrefetcher(CChunkPrefetcher *prefetcher);
     void setSurface(const std::string &name);
     void renderVisible(bool force = false);
     void renderIntersections();
     cv::Mat render_area(const cv::Rect &roi);
+    cv::Mat_<cv::Vec3f> coords_area(const cv::Rect &roi);
+    void cancelRender();
+    void invalidateTiles();
     void invalidateVis();
     void invalidateIntersect(const std::string &name = "");
+    void cancelIntersections();
     
     std::set<std::string> intersects();
     void setIntersects(const std::set<std::string> &set);
@@ -65,6 +99,17 @@ signals:
 protected:
     void ScaleImage(double nFactor);
     void CenterOn(const QPointF& point);
+    void centerPtr(const cv::Rect &roi);
+    void setVisibleSegmentation(const cv::Mat_<cv::Vec3f> &coords);
+    void renderAsync(const cv::Rect &roi);
+    void onCoordsGenerated(uint64_t gen, const cv::Mat_<cv::Vec3f> &coords);
+    void onTileRendered(uint64_t gen, const TileKey &key, const cv::Rect &tile, const cv::Mat &img, bool final);
+    void flushCanvas();
+    void onIntersectionComputed(uint64_t gen, const std::string &key, const std::vector<std::vector<cv::Vec3f>> &intersections);
+    void setIntersectItems(const std::string &key, const std::vector<QGraphicsItem*> &items);
+    void removeIntersectItems(std::unordered_map<std::string,std::vector<QGraphicsItem*>> &items, const std::string &key);
+    void prefetch(const QRectF &rect, int level, float z_off, Surface *surf = nullptr);
+    void predictPan();
 
 protected:
     // widget components
@@ -105,7 +150,34 @@ protected:
     std::unordered_map<std::string,std::vector<QGraphicsItem*>> _intersect_items;
     Intersection *_ignore_intersect_change = nullptr;
     
+    //plane intersections are computed in the background, one job per surface; invalidated items stay
+    //visible (stale) until their replacement arrives, every invalidation bumps _intersect_gen
+    QThreadPool *_intersect_pool = nullptr;
+    std::atomic<uint64_t> _intersect_gen = 0;
+    std::set<std::string> _intersect_pending;
+    std::unordered_map<std::string,std::vector<QGraphicsItem*>> _stale_intersect_items;
+    
     CSurfaceCollection *_surf_col = nullptr;
+    
+    //background rendering, every request bumps _render_gen which makes workers drop stale tiles
+    QThreadPool *_render_pool = nullptr;
+    std::atomic<uint64_t> _render_gen = 0;
+    QImage _canvas;
+    QRect _canvas_area;
+    float _canvas_ds_scale = 0;
+    float _canvas_z_off = 0;
+    bool _canvas_flush_pending = false;
+    
+    //fully rendered tiles (scene tile grid) of the current surface, evicted oldest first
+    std::unordered_map<TileKey,std::pair<cv::Mat,uint64_t>,tile_key_hash> _tile_cache;
+    uint64_t _tile_version = 0;
+    uint64_t _tile_generation = 0;
+    
+    //read-ahead, fed with views predicted from the recent navigation
+    CChunkPrefetcher *_prefetcher = nullptr;
+    QPointF _last_view_center;
+    std::chrono::steady_clock::time_point _last_view_time;
+    QPointF _view_velocity = {0,0};
 };  // class CVolumeViewer
 
 }  // namespace ChaoVis
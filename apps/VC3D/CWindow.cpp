@@ -12,6 +12,7 @@
 #include "UDataManipulateUtils.hpp"
 #include "SettingsDialog.hpp"
 #include "CSurfaceCollection.hpp"
+#include "CChunkPrefetcher.hpp"
 #include "OpChain.hpp"
 #include "opslist.hpp"
 #include "opssettings.hpp"
@@ -44,6 +45,7 @@ CWindow::CWindow() :
 
     //TODO make configurable
     chunk_cache = new ChunkCache(10e9);
+    _prefetcher = new CChunkPrefetcher(chunk_cache);
     
     _surf_col = new CSurfaceCollection();
     
@@ -110,6 +112,23 @@ CWindow::CWindow() :
 // Destructor
 CWindow::~CWindow(void)
 {
+    //viewers wait for their render tasks on destruction, those still use the prefetcher and the cache
+    //viewers whose window was closed are already gone
+    for(auto &viewer : _viewers)
+        delete viewer.data();
+    _viewers.clear();
+    
+    //stops and joins the prefetch worker
+    delete _prefetcher;
+    _prefetcher = nullptr;
+    
+    //frees the op tile caches
+    for(auto &pair : _opchains)
+        delete pair.second;
+    _opchains.clear();
+    
+    delete chunk_cache;
+    chunk_cache = nullptr;
 }
 
 CVolumeViewer *CWindow::newConnectedCVolumeViewer(std::string show_surf, QMdiArea *mdiArea)
@@ -118,6 +137,7 @@ CVolumeViewer *CWindow::newConnectedCVolumeViewer(std::string show_surf, QMdiAre
     QMdiSubWindow *win = mdiArea->addSubWindow(volView);
     win->setWindowTitle(show_surf.c_str());
     volView->setCache(chunk_cache);
+    volView->setPrefetcher(_prefetcher);
     connect(this, &CWindow::sendVolumeChanged, volView, &CVolumeViewer::OnVolumeChanged);
     connect(_surf_col, &CSurfaceCollection::sendSurfaceChanged, volView, &CVolumeViewer::onSurfaceChanged);
     connect(_surf_col, &CSurfaceCollection::sendPOIChanged, volView, &CVolumeViewer::onPOIChanged);
@@ -704,10 +724,16 @@ void CWindow::onOpChainChanged(OpChain *chain)
 void CWindow::onSurfaceSelected(QTreeWidgetItem *current, QTreeWidgetItem *previous)
 {
     std::string surf_path = current->data(0, Qt::UserRole).toString().toStdString();
+    OpChain *prev = dynamic_cast<OpChain*>(_surf_col->surface("segmentation"));
 
     if (!_opchains.count(surf_path)) {
         if (fs::path(surf_path).extension() == ".vcps")
             _opchains[surf_path] = new OpChain(load_quad_from_vcps(surf_path));
+        else if (fs::path(surf_path).extension() == ".vcqs") {
+            QuadSurface *quads = load_quad_from_vcqs(surf_path);
+            if (quads)
+                _opchains[surf_path] = new OpChain(quads);
+        }
         else if (fs::path(surf_path).extension() == ".obj") {
             QuadSurface *quads = load_quad_from_obj(surf_path);
             if (quads)
@@ -718,6 +744,10 @@ void CWindow::onSurfaceSelected(QTreeWidgetItem *current, QTreeWidgetItem *previ
     if (_opchains[surf_path]) {
         _surf_col->setSurface("segmentation", _opchains[surf_path]);
         sendOpChainSelected(_opchains[surf_path]);
+        
+        //the previous chain is not shown anymore, its tiles are regenerated if it gets selected again
+        if (prev && prev != _opchains[surf_path])
+            prev->releaseCaches();
     }
     else
         std::cout << "ERROR loading " << surf_path << std::endl;
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <QPointer>
 #include <opencv2/core.hpp>
 #include "ui_VCMain.h"
 
@@ -32,6 +33,7 @@ namespace ChaoVis
 
 class CVolumeViewer;
 class CSurfaceCollection;
+class CChunkPrefetcher;
 
 class CWindow : public QMainWindow
 {
@@ -139,7 +141,9 @@ private:
     bool can_change_volume_();
     
     ChunkCache *chunk_cache;
-    std::vector<CVolumeViewer*> _viewers;
+    CChunkPrefetcher *_prefetcher;
+    //closing a viewer window deletes the viewer, QPointer drops it then
+    std::vector<QPointer<CVolumeViewer>> _viewers;
     CSurfaceCollection *_surf_col;
 
     std::unordered_map<std::string,OpChain*> _opchains;
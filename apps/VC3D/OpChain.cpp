@@ -3,9 +3,233 @@
 #include "vc/core/util/Slicing.hpp"
 #include "vc/core/util/Surface.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+#define OPCHAIN_TILE_SIZE 128
+//byte budget shared by the tile caches of all ops of all chains, 128x128 tiles of coords+normals are ~400kB each
+#define OPCHAIN_CACHE_BYTES (size_t(512)*1024*1024)
+//requests are snapped to this fraction of an output pixel, so pans by whole pixels keep hitting the same tiles
+#define OPCHAIN_SUBPIXEL_STEPS 64
+
+//keeps the output of an op in tiles of a fixed grid of output pixels (nominal position * scale)
+//so views at the same scale and z share them, e.g. while panning
+//all tile caches share one LRU byte budget, they are only used with OpChain::_mutex held
+class TileCacheSurface : public DeltaSurface
+{
+public:
+    TileCacheSurface(DeltaSurface *op) : DeltaSurface(op), _op(op) { _all.insert(this); };
+    ~TileCacheSurface();
+    void gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset) override;
+    
+    void invalidate();
+    //drop tiles within radius output pixels of the nominal location
+    void invalidate(const cv::Vec2f &nominal, float radius);
+    
+protected:
+    struct Tile {
+        cv::Mat_<cv::Vec3f> coords;
+        cv::Mat_<cv::Vec3f> normals;
+        uint64_t generation;
+        size_t bytes() const { return coords.total()*coords.elemSize() + normals.total()*normals.elemSize(); }
+    };
+    //scale, ptr z, offset z, subpixel phase x, subpixel phase y, tile x, tile y
+    using Key = std::tuple<float,float,float,int,int,int,int>;
+    
+    //evict the least recently used quarter of all tiles of all caches, except the ones used by the current request
+    static void evict();
+    
+    DeltaSurface *_op;
+    std::map<Key,Tile> _tiles;
+    
+    static std::set<TileCacheSurface*> _all;
+    static size_t _bytes;
+    static uint64_t _generation;
+};
+
+std::set<TileCacheSurface*> TileCacheSurface::_all;
+size_t TileCacheSurface::_bytes = 0;
+uint64_t TileCacheSurface::_generation = 0;
+
+TileCacheSurface::~TileCacheSurface()
+{
+    for(auto &pair : _tiles)
+        _bytes -= pair.second.bytes();
+    _all.erase(this);
+}
+
+void TileCacheSurface::gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset)
+{
+    TrivialSurfacePointer ptr_local({0,0,0});
+    if (!ptr)
+        ptr = &ptr_local;
+    
+    //upper left corner of the request, snapped to the subpixel grid and split into a whole pixel position
+    //on the tile grid and the subpixel phase, which is part of the tile key
+    int steps = OPCHAIN_SUBPIXEL_STEPS;
+    cv::Vec3f nominal = loc(ptr);
+    int sx = std::round((nominal[0]*scale+offset[0])*steps);
+    int sy = std::round((nominal[1]*scale+offset[1])*steps);
+    int x0 = std::floor(float(sx)/steps);
+    int y0 = std::floor(float(sy)/steps);
+    int phase_x = sx-x0*steps;
+    int phase_y = sy-y0*steps;
+    //offset (relative to the pointer) at which pixel (0,0) of the tile grid is generated
+    cv::Vec2f grid_offset = {float(phase_x)/steps-nominal[0]*scale, float(phase_y)/steps-nominal[1]*scale};
+    
+    cv::Mat_<cv::Vec3f> coords_local;
+    if (!coords)
+        coords = &coords_local;
+    coords->create(size);
+    //ops that do not produce normals leave them zero
+    if (normals)
+        *normals = cv::Mat_<cv::Vec3f>(size, cv::Vec3f(0,0,0));
+    
+    int t = OPCHAIN_TILE_SIZE;
+    int b = _op->border();
+    cv::Rect area(x0, y0, size.width, size.height);
+    _generation++;
+    
+    for(int ty=std::floor(float(y0)/t);ty*t<area.br().y;ty++)
+        for(int tx=std::floor(float(x0)/t);tx*t<area.br().x;tx++) {
+            Key key = {scale, nominal[2], offset[2], phase_x, phase_y, tx, ty};
+            auto it = _tiles.find(key);
+            if (it == _tiles.end()) {
+                //generate with a border so filters inside the op see real neighbours at the tile edges
+                Tile tile;
+                cv::Vec3f tile_offset = {tx*t-b+grid_offset[0], ty*t-b+grid_offset[1], offset[2]};
+                _base->gen(&tile.coords, &tile.normals, {t+2*b,t+2*b}, ptr, scale, tile_offset);
+                tile.coords = tile.coords(cv::Rect(b,b,t,t)).clone();
+                if (!tile.normals.empty())
+                    tile.normals = tile.normals(cv::Rect(b,b,t,t)).clone();
+                _bytes += tile.bytes();
+                it = _tiles.emplace(key, tile).first;
+            }
+            it->second.generation = _generation;
+            
+            cv::Rect tile_rect(tx*t, ty*t, t, t);
+            cv::Rect common = tile_rect & area;
+            it->second.coords(common - tile_rect.tl()).copyTo((*coords)(common - area.tl()));
+            if (normals && !it->second.normals.empty())
+                it->second.normals(common - tile_rect.tl()).copyTo((*normals)(common - area.tl()));
+        }
+    
+    if (_bytes > OPCHAIN_CACHE_BYTES)
+        evict();
+}
+
+void TileCacheSurface::invalidate()
+{
+    for(auto &pair : _tiles)
+        _bytes -= pair.second.bytes();
+    _tiles.clear();
+}
+
+void TileCacheSurface::invalidate(const cv::Vec2f &nominal, float radius)
+{
+    int t = OPCHAIN_TILE_SIZE;
+    for(auto it = _tiles.begin(); it != _tiles.end();) {
+        float scale = std::get<0>(it->first);
+        //one extra pixel as tiles are shifted by their subpixel phase
+        float r = radius+1;
+        cv::Rect2f reach(std::get<5>(it->first)*t-r, std::get<6>(it->first)*t-r, t+2*r, t+2*r);
+        if (reach.contains({nominal[0]*scale, nominal[1]*scale})) {
+            _bytes -= it->second.bytes();
+            it = _tiles.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+void TileCacheSurface::evict()
+{
+    std::vector<uint64_t> gens;
+    for(auto cache : _all)
+        for(auto &pair : cache->_tiles)
+            gens.push_back(pair.second.generation);
+    if (gens.empty())
+        return;
+    
+    std::nth_element(gens.begin(), gens.begin()+gens.size()/4, gens.end());
+    uint64_t th = gens[gens.size()/4];
+    for(auto cache : _all)
+        for(auto it = cache->_tiles.begin(); it != cache->_tiles.end();)
+            if (it->second.generation <= th && it->second.generation != _generation) {
+                _bytes -= it->second.bytes();
+                it = cache->_tiles.erase(it);
+            }
+            else
+                it++;
+}
+
+std::mutex OpChain::_mutex;
+
+OpChain::~OpChain()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    clearCaches();
+}
+
 void OpChain::append(DeltaSurface *op)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
     _ops.push_back(op);
+    _chain_dirty = true;
+}
+
+void OpChain::clearCaches()
+{
+    for(auto cache : _caches)
+        delete cache;
+    _caches.resize(0);
+    _cached_ops.resize(0);
+}
+
+void OpChain::releaseCaches()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    clearCaches();
+    _chain_dirty = true;
+}
+
+void OpChain::buildChain(Surface *base)
+{
+    clearCaches();
+    
+    Surface *last = base;
+    for(auto s : _ops) {
+        if (!enabled(s))
+            continue;
+        s->setBase(last);
+        //all caches are new, earlier edits don't matter
+        s->takeChanges();
+        _cached_ops.push_back(s);
+        _caches.push_back(new TileCacheSurface(s));
+        last = _caches.back();
+    }
+    
+    _chain_dirty = false;
+    _chain_mode = _src_mode;
+}
+
+//an edit invalidates the op's own output in its reach and the outputs of all later ops, grown by their borders
+void OpChain::applyChanges()
+{
+    for(int n=0;n<_cached_ops.size();n++)
+        for(auto &change : _cached_ops[n]->takeChanges()) {
+            float radius = change[2];
+            for(int m=n;m<_caches.size();m++) {
+                if (radius < 0)
+                    _caches[m]->invalidate();
+                else
+                    _caches[m]->invalidate({change[0],change[1]}, radius);
+                if (m+1 < _cached_ops.size())
+                    radius += _cached_ops[m+1]->border();
+            }
+        }
 }
 
 SurfacePointer *OpChain::pointer()
@@ -48,6 +272,7 @@ float OpChain::pointTo(SurfacePointer *ptr, const cv::Vec3f &coord, float th, in
 
 void OpChain::gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
     Surface *last = nullptr;
     SurfacePointer *ptr_center = ptr;
     if (!ptr_center)
@@ -76,19 +301,30 @@ void OpChain::gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv:
         last = _crop;
     }
 
-    //reset op chain
-    for(auto s : _ops) {
-        if (!enabled(s))
-            continue;
-        s->setBase(last);
-        last = s;
-    }
-
     if (_src_mode == OpChainSourceMode::RAW || _src_mode == OpChainSourceMode::BLUR) {
-        last->gen(coords, normals, size, ptr, scale, offset);
+        if (_chain_dirty || _chain_mode != _src_mode)
+            buildChain(last);
+        applyChanges();
+        
+        if (_caches.size())
+            _caches.back()->gen(coords, normals, size, ptr, scale, offset);
+        else
+            last->gen(coords, normals, size, ptr, scale, offset);
     }
-    else
+    else {
+        //base changes with every view, run the plain chain
+        clearCaches();
+        _chain_dirty = true;
+        
+        for(auto s : _ops) {
+            if (!enabled(s))
+                continue;
+            s->setBase(last);
+            last = s;
+        }
+        
         last->gen(coords, normals, size, nullptr, scale, {-size.width/2, -size.height/2, ((TrivialSurfacePointer*)ptr_center)->loc[2]+offset[2]});
+    }
 }
 
 const char *op_name(Surface *op)
@@ -104,12 +340,21 @@ const char *op_name(Surface *op)
 }
 
 
+void OpChain::setSourceMode(OpChainSourceMode mode)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _src_mode = mode;
+}
+
 void OpChain::setEnabled(DeltaSurface *surf, bool enabled)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
     if (enabled)
         _disabled.erase(surf);
     else
         _disabled.insert(surf);
+    
+    _chain_dirty = true;
 }
 
 bool OpChain::enabled(DeltaSurface *surf)
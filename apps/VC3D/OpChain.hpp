@@ -2,6 +2,7 @@
 
 #include "vc/core/util/Surface.hpp"
 
+#include <mutex>
 #include <set>
 
 class QuadSurface;
@@ -9,6 +10,7 @@ class DeltaSurface;
 class SurfacePointer;
 class ChunkCache;
 class FormSetSrc;
+class TileCacheSurface;
 
 namespace z5 {
     class Dataset;
@@ -23,9 +25,11 @@ enum class OpChainSourceMode: int
 
 //special "windowed" surface that represents a set of delta surfaces on top of a base QuadSurface
 //caches the generated coords to base surface method on this cached representation
+//gen() runs on the viewer render threads, it and all edits of a chain are serialized by one lock shared by all chains
 class OpChain : public Surface {
 public:
     OpChain(QuadSurface *src) : _src(src) {};
+    ~OpChain();
     // cv::Mat render(SurfacePointer *ptr, const cv::Size &size, float z, float scale, ChunkCache *cache, z5::Dataset *ds);
     QuadSurface *surf(SurfacePointer *ptr, const cv::Size &size, float z, float scale, ChunkCache *cache, z5::Dataset *ds);
     void append(DeltaSurface *op);
@@ -41,18 +45,36 @@ public:
 
     std::vector<DeltaSurface*> ops() { return _ops; };
 
+    void setSourceMode(OpChainSourceMode mode);
     void setEnabled(DeltaSurface *surf, bool enabled);
     bool enabled(DeltaSurface *surf);
+    //free all cached tiles, e.g. when the chain is no longer shown, they are regenerated on demand
+    void releaseCaches();
     
     friend class FormSetSrc;
 
 protected:
+    //guards the chains and the tile caches, which share one byte budget
+    static std::mutex _mutex;
+    
+    void buildChain(Surface *base);
+    void clearCaches();
+    //drop the cached tiles affected by op edits since the last gen()
+    void applyChanges();
+    
+
     OpChainSourceMode _src_mode = OpChainSourceMode::BLUR;
     std::vector<DeltaSurface*> _ops;
     std::set<DeltaSurface*> _disabled;
     QuadSurface *_src = nullptr;
     QuadSurface *_crop = nullptr;
     QuadSurface *_src_blur = nullptr;
+    
+    //output cache after each enabled op (RAW/BLUR only, GREEDY regenerates its base per view)
+    std::vector<DeltaSurface*> _cached_ops;
+    std::vector<TileCacheSurface*> _caches;
+    bool _chain_dirty = true;
+    OpChainSourceMode _chain_mode = OpChainSourceMode::BLUR;
 };
 
 const char * op_name(Surface *op);
@@ -23,7 +23,7 @@ void FormSetSrc::onAlgoIdxChanged(int index)
     if (!_chain)
         return;
     
-    _chain->_src_mode = OpChainSourceMode(index);
+    _chain->setSourceMode(OpChainSourceMode(index));
     
     sendOpChainChanged(_chain);
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "vc/core/util/Surface.hpp"
+
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+//convert vcps/obj quad surfaces into the native vcqs format which VC3D can map without parsing
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cout << "usage: " << argv[0] << " <input.vcps|input.obj> <output.vcqs>" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    
+    fs::path src_path = argv[1];
+    fs::path tgt_path = argv[2];
+    
+    QuadSurface *surf = nullptr;
+    if (src_path.extension() == ".vcps")
+        surf = load_quad_from_vcps(src_path);
+    else if (src_path.extension() == ".obj")
+        surf = load_quad_from_obj(src_path);
+    else {
+        std::cerr << "ERROR: unsupported input format " << src_path << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (!surf) {
+        std::cerr << "ERROR: could not load " << src_path << " as quad surface" << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (!write_quad_to_vcqs(surf, tgt_path)) {
+        std::cerr << "ERROR: could not write " << tgt_path << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    delete surf;
+    
+    return EXIT_SUCCESS;
+}
@@ -11,8 +11,10 @@
 #include "vc/app_support/ProgressIndicator.hpp"
 #include "vc/apps/render/RenderTexturing.hpp"
 #include "vc/core/filesystem.hpp"
+#include "vc/core/io/FileFilters.hpp"
 #include "vc/core/io/ImageIO.hpp"
 #include "vc/core/io/PointSetIO.hpp"
+#include "vc/core/io/VolumetricMaskIO.hpp"
 #include "vc/core/neighborhood/CuboidGenerator.hpp"
 #include "vc/core/neighborhood/LineGenerator.hpp"
 #include "vc/core/types/PerPixelMap.hpp"
@@ -308,8 +310,13 @@ auto main(int argc, char* argv[]) -> int
             std::exit(EXIT_FAILURE);
         }
         Logger()->info("Loading volume mask...");
-        auto pts = PointSetIO<cv::Vec3i>::ReadPointSet(maskPath);
-        auto mask = VolumetricMask::New(pts);
+        VolumetricMask::Pointer mask;
+        if (io::FileExtensionFilter(maskPath, {"vcvm"})) {
+            mask = io::ReadVolumetricMask(maskPath);
+        } else {
+            auto pts = PointSetIO<cv::Vec3i>::ReadPointSet(maskPath);
+            mask = VolumetricMask::New(pts);
+        }
 
         auto thickness = vct::ThicknessTexture::New();
         thickness->setPerPixelMap(ppm);
@@ -129,7 +129,7 @@ auto GetThicknessOpts() -> po::options_description
     po::options_description opts("Thickness Texture Options");
     opts.add_options()
         ("volume-mask", po::value<std::string>(),
-            "Path to volumetric mask point set")
+            "Path to volumetric mask point set (.vcps) or mask (.vcvm)")
         ("normalize-output", po::value<bool>()->default_value(true),
             "Normalize the output image between [0, 1]. If enabled "
             "(default), the output file should be a TIFF file and the "
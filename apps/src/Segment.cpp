@@ -1,9 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
+#include <nlohmann/json.hpp>
 
 #include "vc/app_support/GeneralOptions.hpp"
 #include "vc/app_support/GetMemorySize.hpp"
@@ -40,17 +49,36 @@ static const int kDefaultPeakDistanceWeight = 50;
 static const bool kDefaultConsiderPrevious = false;
 static constexpr int kDefaultResliceSize = 32;
 
-static int SaveInterval{-1};
-static int CurrentIteration{0};
+// Default number of concurrent batch jobs
+static constexpr std::size_t kDefaultBatchJobs = 4;
 
 enum class Algorithm { LRPS, TFF };
 
 using PointSet = vs::ThinnedFloodFillSegmentation::PointSet;
 using VoxelMask = vs::ThinnedFloodFillSegmentation::VoxelMask;
 
-static void WritePointset(const PointSet& pointset);
-static void WriteIntermediatePointset(const PointSet& pointset);
-static void WriteMaskPointset(const VoxelMask& pointset);
+// One segmentation run. Parameters use the names of the command line options.
+struct Job {
+    std::string name;
+    vc::Segmentation::Pointer seg;
+    nlohmann::json params;
+    fs::path output{"pointset.vcps"};
+    fs::path maskOutput{"mask_pointset.vcps"};
+};
+
+static auto OptionsToJson(const po::variables_map& parsed) -> nlohmann::json;
+static auto ParseAlgorithm(std::string method) -> Algorithm;
+static void RunJob(
+    const Job& job,
+    const vc::VolumePkg& vpkg,
+    const vc::Volume::Pointer& volume,
+    const std::optional<vc::ProgressConfig>& progress);
+static auto RunBatch(
+    const fs::path& manifestPath,
+    const po::variables_map& parsed,
+    vc::VolumePkg& vpkg,
+    std::size_t cacheBytes) -> int;
+static auto CacheBytes(const po::variables_map& parsed) -> std::size_t;
 
 auto main(int argc, char* argv[]) -> int
 {
@@ -59,9 +87,10 @@ auto main(int argc, char* argv[]) -> int
     po::options_description required("Required arguments");
     required.add_options()
         ("volpkg,v", po::value<std::string>()->required(), "VolumePkg path")
-        ("seg,s", po::value<std::string>()->required(), "Segmentation ID")
-        ("method,m", po::value<std::string>()->required(),
-            "Segmentation method: LRPS, TFF")
+        ("seg,s", po::value<std::string>(),
+            "Segmentation ID. Required unless running a batch.")
+        ("method,m", po::value<std::string>(),
+            "Segmentation method: LRPS, TFF. Required unless running a batch.")
         ("volume", po::value<std::string>(),
             "Volume to use for texturing. Default: Segmentation's associated "
             "volume or the first volume in the volume package.")
@@ -101,6 +130,12 @@ auto main(int argc, char* argv[]) -> int
             po::value<bool>()->default_value(kDefaultConsiderPrevious),
             "Consider propagation of a point's previous XY position as a "
             "candidate when optimizing each iteration")
+        ("structure-tensor-field",
+            "Estimate normals from a lazily computed, cached structure tensor "
+            "field instead of per-particle structure tensors")
+        ("incremental-energy",
+            "Score candidate positions with an incrementally updated energy "
+            "of the unfitted chain instead of refitting a curve per candidate")
         ("visualize", "Display curve visualization as algorithm runs");
 
     // TFF options
@@ -123,9 +158,27 @@ auto main(int argc, char* argv[]) -> int
         ("save-interval", po::value<int>(),
             "Save the segmentation after a specified number of slices.")
         ("save-mask","Save the mask created by the segmentation algorithm.");
+
+    // Batch options
+    po::options_description batchOptions("Batch Options");
+    batchOptions.add_options()
+        ("batch", po::value<std::string>(),
+            "JSON manifest of segmentation jobs to run in this process. All "
+            "jobs share one volume cache. Each job is an object with a "
+            "'seg' and a 'method' and may set any of the segmentation "
+            "options by their long names. Options not set by a job use the "
+            "values given on the command line. TFF jobs may set 'output' and "
+            "'mask-output' paths, which must be unique across jobs. "
+            "'visualize' and 'dump-vis' are not supported.")
+        ("batch-jobs", po::value<std::size_t>()->default_value(kDefaultBatchJobs),
+            "Number of batch jobs to run concurrently");
     // clang-format on
     po::options_description all("Usage");
-    all.add(GetGeneralOpts()).add(required).add(lrpsOptions).add(tffOptions);
+    all.add(GetGeneralOpts())
+        .add(required)
+        .add(lrpsOptions)
+        .add(tffOptions)
+        .add(batchOptions);
 
     // Parse and handle options
     po::variables_map parsed;
@@ -156,20 +209,13 @@ auto main(int argc, char* argv[]) -> int
         std::cerr << "[error]: " << e.what() << '\n';
         return EXIT_FAILURE;
     }
-
-    Algorithm alg;
-    auto method = parsed["method"].as<std::string>();
-    std::transform(method.begin(), method.end(), method.begin(), ::tolower);
-    std::cout << "Segmentation method: " << method << std::endl;
-    if (method == "lrps") {
-        alg = Algorithm::LRPS;
-    } else if (method == "tff") {
-        alg = Algorithm::TFF;
-    } else {
-        std::cerr
-            << "[error]: Unknown algorithm type. Must be one of ['LRPS', 'TFF']"
-            << '\n';
-        std::exit(1);
+    auto batch = parsed.count("batch") > 0;
+    if (not batch and
+        (parsed.count("seg") == 0 or parsed.count("method") == 0)) {
+        std::cerr << "[error]: 'seg' and 'method' are required unless running "
+                     "a batch"
+                  << '\n';
+        return EXIT_FAILURE;
     }
 
     ///// Load the volume package /////
@@ -187,11 +233,25 @@ auto main(int argc, char* argv[]) -> int
         return EXIT_FAILURE;
     }
 
+    if (batch) {
+        return RunBatch(
+            parsed["batch"].as<std::string>(), parsed, vpkg,
+            CacheBytes(parsed));
+    }
+
+    Job job;
+    job.params = OptionsToJson(parsed);
+    try {
+        ParseAlgorithm(job.params["method"].get<std::string>());
+    } catch (const std::exception& e) {
+        std::cerr << "[error]: " << e.what() << '\n';
+        std::exit(1);
+    }
+
     ///// Load the segmentation /////
-    vc::Segmentation::Pointer seg;
     auto segID = parsed["seg"].as<std::string>();
     try {
-        seg = vpkg.segmentation(segID);
+        job.seg = vpkg.segmentation(segID);
     } catch (const std::exception& e) {
         std::cerr << "Cannot load segmentation. ";
         std::cerr << "Please check the provided ID: " << segID << '\n';
@@ -205,8 +265,8 @@ auto main(int argc, char* argv[]) -> int
 
     if (parsed.count("volume")) {
         volID = parsed["volume"].as<std::string>();
-    } else if (seg->hasVolumeID()) {
-        volID = seg->getVolumeID();
+    } else if (job.seg->hasVolumeID()) {
+        volID = job.seg->getVolumeID();
     }
 
     try {
@@ -225,22 +285,114 @@ auto main(int argc, char* argv[]) -> int
     }
 
     // Set the cache size
-    std::size_t cacheBytes;
-    if (parsed.count("cache-memory-limit")) {
-        auto cacheSizeOpt = parsed["cache-memory-limit"].as<std::string>();
-        cacheBytes = vc::MemorySizeStringParser(cacheSizeOpt);
-    } else {
-        cacheBytes = SystemMemorySize() / 2;
-    }
+    auto cacheBytes = CacheBytes(parsed);
     volume->setCacheMemoryInBytes(cacheBytes);
     std::cout << "Volume Cache :: ";
     std::cout << "Capacity: " << volume->getCacheCapacity() << " || ";
     std::cout << "Size: " << vc::BytesToMemorySizeString(cacheBytes);
     std::cout << std::endl;
 
+    // Progress reporting
+    std::optional<vc::ProgressConfig> progress;
+    if (parsed["progress"].as<bool>()) {
+        progress = vc::ProgressConfig{};
+        if (parsed.count("progress-interval") > 0) {
+            progress->interval = vc::DurationFromString(
+                parsed["progress-interval"].as<std::string>());
+        }
+    }
+
+    try {
+        RunJob(job, vpkg, volume, progress);
+    } catch (const std::exception& e) {
+        std::cerr << "[error]: " << e.what() << '\n';
+        std::exit(1);
+    }
+}
+
+static auto CacheBytes(const po::variables_map& parsed) -> std::size_t
+{
+    if (parsed.count("cache-memory-limit")) {
+        auto cacheSizeOpt = parsed["cache-memory-limit"].as<std::string>();
+        return vc::MemorySizeStringParser(cacheSizeOpt);
+    }
+    return SystemMemorySize() / 2;
+}
+
+static auto OptionsToJson(const po::variables_map& parsed) -> nlohmann::json
+{
+    nlohmann::json params;
+    auto copy = [&parsed, &params](const std::string& key, auto tag) {
+        using T = decltype(tag);
+        if (parsed.count(key) > 0) {
+            params[key] = parsed[key].as<T>();
+        }
+    };
+
+    // Run options
+    copy("seg", std::string{});
+    copy("method", std::string{});
+    copy("start-index", std::size_t{});
+    copy("end-index", std::size_t{});
+    copy("stride", std::size_t{});
+    copy("step-size", double{});
+
+    // LRPS options
+    copy("num-iters", int{});
+    copy("reslice-size", int{});
+    copy("alpha", double{});
+    copy("k1", double{});
+    copy("k2", double{});
+    copy("beta", double{});
+    copy("delta", double{});
+    copy("distance-weight", int{});
+    copy("consider-previous", bool{});
+
+    // TFF options
+    copy("tff-low-thresh", std::uint16_t{});
+    copy("tff-high-thresh", std::uint16_t{});
+    copy("tff-dt-thresh", float{});
+    copy("closing-kernel-size", int{});
+    copy("spur-length", std::size_t{});
+    copy("max-seed-radius", std::size_t{});
+    copy("save-interval", int{});
+
+    // Flags
+    for (const auto* flag :
+         {"dump-vis", "visualize", "measure-vert", "save-mask",
+          "structure-tensor-field", "incremental-energy"}) {
+        params[flag] = parsed.count(flag) > 0;
+    }
+    return params;
+}
+
+static auto ParseAlgorithm(std::string method) -> Algorithm
+{
+    std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+    if (method == "lrps") {
+        return Algorithm::LRPS;
+    }
+    if (method == "tff") {
+        return Algorithm::TFF;
+    }
+    throw std::invalid_argument(
+        "Unknown algorithm type. Must be one of ['LRPS', 'TFF']");
+}
+
+static void RunJob(
+    const Job& job,
+    const vc::VolumePkg& vpkg,
+    const vc::Volume::Pointer& volume,
+    const std::optional<vc::ProgressConfig>& progress)
+{
+    const auto& params = job.params;
+    auto alg = ParseAlgorithm(params.at("method").get<std::string>());
+    std::cout << job.name << "Segmentation method: "
+              << params.at("method").get<std::string>() << std::endl;
+
     // Setup
     // Load the segmentation
-    auto masterCloud = seg->getPointSet();
+    auto masterCloud = job.seg->getPointSet();
 
     // Get some info about the cloud, including chain length and z-index's
     // represented by seg.
@@ -252,39 +404,44 @@ auto main(int argc, char* argv[]) -> int
     // If no start index is given, our starting path is all of the points
     // already on the largest slice index
     std::size_t startIndex{0};
-    if (parsed.count("start-index") == 0) {
+    if (not params.contains("start-index")) {
         startIndex = maxIndex;
         std::cout
+            << job.name
             << "No starting index given. Defaulting to max Z in point set: "
             << startIndex << std::endl;
     } else {
-        startIndex = parsed["start-index"].as<std::size_t>();
+        startIndex = params["start-index"].get<std::size_t>();
     }
 
     // Step size
-    auto step = parsed["step-size"].as<double>();
+    auto step = params.at("step-size").get<double>();
 
     // Figure out endIndex using either start-index or stride
     std::size_t endIndex{0};
-    if (parsed.count("end-index") > 0) {
-        endIndex = parsed["end-index"].as<std::size_t>();
-    } else if (parsed.count("stride") > 0) {
-        endIndex = startIndex + parsed["stride"].as<std::size_t>();
+    if (params.contains("end-index") and params.contains("stride")) {
+        throw std::invalid_argument(
+            "'end-index' and 'stride' are mutually exclusive");
+    }
+    if (params.contains("end-index")) {
+        endIndex = params["end-index"].get<std::size_t>();
+    } else if (params.contains("stride")) {
+        endIndex = startIndex + params["stride"].get<std::size_t>();
         endIndex = std::min(endIndex, std::size_t(volume->numSlices() - 1));
     } else {
         endIndex = std::size_t(volume->numSlices() - 1);
-        std::cout << "No end index given. Defaulting to max Z in volume: "
+        std::cout << job.name
+                  << "No end index given. Defaulting to max Z in volume: "
                   << endIndex << std::endl;
     }
 
     // Sanity check for whether we actually need to run the algorithm
     if (startIndex >= endIndex) {
-        std::cerr << "[info]: startIndex(" << startIndex << ") >= endIndex("
-                  << endIndex
-                  << "), do not need to segment. Consider using --stride "
-                     "option instead of manually specifying endIndex"
-                  << std::endl;
-        std::exit(1);
+        throw std::invalid_argument(
+            "startIndex(" + std::to_string(startIndex) + ") >= endIndex(" +
+            std::to_string(endIndex) +
+            "), do not need to segment. Consider using --stride option "
+            "instead of manually specifying endIndex");
     }
 
     // Prepare our clouds
@@ -310,24 +467,12 @@ auto main(int argc, char* argv[]) -> int
     // Starting paths must have the same number of points as the input width to
     // maintain ordering
     if (segPath.size() != chainLength) {
-        std::cerr << std::endl;
-        std::cerr << "[error]: Starting chain length does not match expected "
-                     "chain length."
-                  << std::endl;
-        std::cerr << "           Expected: " << chainLength << std::endl;
-        std::cerr << "           Actual: " << segPath.size() << std::endl;
-        std::cerr << "       Consider using a lower starting index value."
-                  << std::endl
-                  << std::endl;
-        std::exit(1);
-    }
-
-    // Progress reporting
-    auto enableProgress = parsed["progress"].as<bool>();
-    vc::ProgressConfig cfg;
-    if (parsed.count("progress-interval") > 0) {
-        cfg.interval = vc::DurationFromString(
-            parsed["progress-interval"].as<std::string>());
+        throw std::invalid_argument(
+            "Starting chain length does not match expected chain length. "
+            "Expected: " +
+            std::to_string(chainLength) +
+            " Actual: " + std::to_string(segPath.size()) +
+            ". Consider using a lower starting index value.");
     }
 
     // Run the algorithms
@@ -340,19 +485,25 @@ auto main(int argc, char* argv[]) -> int
         segmenter.setMaterialThickness(vpkg.materialThickness());
         segmenter.setTargetZIndex(endIndex);
         segmenter.setStepSize(step);
-        segmenter.setOptimizationIterations(parsed["num-iters"].as<int>());
-        segmenter.setResliceSize(parsed["reslice-size"].as<int>());
-        segmenter.setAlpha(parsed["alpha"].as<double>());
-        segmenter.setK1(parsed["k1"].as<double>());
-        segmenter.setK2(parsed["k2"].as<double>());
-        segmenter.setBeta(parsed["beta"].as<double>());
-        segmenter.setDelta(parsed["delta"].as<double>());
-        segmenter.setDistanceWeightFactor(parsed["distance-weight"].as<int>());
-        segmenter.setConsiderPrevious(parsed["consider-previous"].as<bool>());
-        segmenter.setVisualize(parsed.count("visualize") > 0);
-        segmenter.setDumpVis(parsed.count("dump-vis") > 0);
-        if (enableProgress) {
-            vc::ReportProgress(segmenter, "Segmenting", cfg);
+        segmenter.setOptimizationIterations(params.at("num-iters").get<int>());
+        segmenter.setResliceSize(params.at("reslice-size").get<int>());
+        segmenter.setAlpha(params.at("alpha").get<double>());
+        segmenter.setK1(params.at("k1").get<double>());
+        segmenter.setK2(params.at("k2").get<double>());
+        segmenter.setBeta(params.at("beta").get<double>());
+        segmenter.setDelta(params.at("delta").get<double>());
+        segmenter.setDistanceWeightFactor(
+            params.at("distance-weight").get<int>());
+        segmenter.setConsiderPrevious(
+            params.at("consider-previous").get<bool>());
+        segmenter.setUseStructureTensorField(
+            params.value("structure-tensor-field", false));
+        segmenter.setUseIncrementalEnergy(
+            params.value("incremental-energy", false));
+        segmenter.setVisualize(params.value("visualize", false));
+        segmenter.setDumpVis(params.value("dump-vis", false));
+        if (progress) {
+            vc::ReportProgress(segmenter, "Segmenting", *progress);
         }
         mutableCloud = segmenter.compute();
     }
@@ -363,41 +514,50 @@ auto main(int argc, char* argv[]) -> int
         segmenter.setVolume(volume);
         segmenter.setIterations(endIndex - startIndex + 1);
         segmenter.setFFLowThreshold(
-            parsed["tff-low-thresh"].as<std::uint16_t>());
+            params.at("tff-low-thresh").get<std::uint16_t>());
         segmenter.setFFHighThreshold(
-            parsed["tff-high-thresh"].as<std::uint16_t>());
-        if (parsed.count("tff-dt-thresh") > 0) {
-            auto dtt = parsed["tff-dt-thresh"].as<float>();
+            params.at("tff-high-thresh").get<std::uint16_t>());
+        if (params.contains("tff-dt-thresh")) {
+            auto dtt = params["tff-dt-thresh"].get<float>();
             segmenter.setDistanceTransformThreshold(dtt);
         }
-        segmenter.setClosingKernelSize(parsed["closing-kernel-size"].as<int>());
+        segmenter.setClosingKernelSize(
+            params.at("closing-kernel-size").get<int>());
         segmenter.setSpurLengthThreshold(
-            parsed["spur-length"].as<std::size_t>());
-        if (parsed.count("max-seed-radius") > 0) {
-            auto r = parsed["max-seed-radius"].as<std::size_t>();
+            params.at("spur-length").get<std::size_t>());
+        if (params.contains("max-seed-radius")) {
+            auto r = params["max-seed-radius"].get<std::size_t>();
             segmenter.setMaxRadius(r);
         }
-        segmenter.setMeasureVertical(parsed.count("measure-vert") > 0);
-        segmenter.setDumpVis(parsed.count("dump-vis") > 0);
-
-        if (parsed.count("save-interval") > 0) {
-            SaveInterval = parsed["save-interval"].as<int>();
-            if (SaveInterval > 0) {
-                segmenter.pointsetUpdated.connect(WriteIntermediatePointset);
-            }
+        segmenter.setMeasureVertical(params.value("measure-vert", false));
+        segmenter.setDumpVis(params.value("dump-vis", false));
+
+        // Save intermediate pointsets if we're doing that
+        auto saveInterval = params.value("save-interval", -1);
+        if (saveInterval > 0) {
+            segmenter.pointsetUpdated.connect(
+                [&job, saveInterval, iteration = 0](
+                    const PointSet& pointset) mutable {
+                    if (++iteration % saveInterval == 0) {
+                        vc::PointSetIO<cv::Vec3d>::WritePointSet(
+                            job.output, pointset);
+                    }
+                });
         }
-        if (parsed.count("save-mask") > 0) {
-            segmenter.maskUpdated.connect(WriteMaskPointset);
+        if (params.value("save-mask", false)) {
+            segmenter.maskUpdated.connect([&job](const VoxelMask& mask) {
+                vc::PointSetIO<cv::Vec3i>::WritePointSet(job.maskOutput, mask);
+            });
         }
-        if (enableProgress) {
-            vc::ReportProgress(segmenter, "Segmenting", cfg);
+        if (progress) {
+            vc::ReportProgress(segmenter, "Segmenting", *progress);
         }
         auto skeleton = segmenter.compute();
 
         // Regular pointsets aren't fully supported in the main logic yet
         // Write our point set and exit early
-        WritePointset(skeleton);
-        return 0;
+        vc::PointSetIO<cv::Vec3d>::WritePointSet(job.output, skeleton);
+        return;
     }
 
     // Update the master cloud with the points we saved and concat the new
@@ -405,23 +565,178 @@ auto main(int argc, char* argv[]) -> int
     immutableCloud.append(mutableCloud);
 
     // Save point cloud and mesh
-    seg->setPointSet(immutableCloud);
+    job.seg->setPointSet(immutableCloud);
 }
 
-static void WritePointset(const PointSet& pointset)
+static auto RunBatch(
+    const fs::path& manifestPath,
+    const po::variables_map& parsed,
+    vc::VolumePkg& vpkg,
+    std::size_t cacheBytes) -> int
 {
-    vc::PointSetIO<cv::Vec3d>::WritePointSet("pointset.vcps", pointset);
-}
+    // Load the manifest
+    nlohmann::json manifest;
+    try {
+        std::ifstream file(manifestPath);
+        if (not file.is_open()) {
+            throw std::runtime_error("could not open file");
+        }
+        manifest = nlohmann::json::parse(file);
+        if (not manifest.contains("jobs") or not manifest["jobs"].is_array()) {
+            throw std::runtime_error("missing 'jobs' array");
+        }
+    } catch (const std::exception& e) {
+        vc::Logger()->error(
+            "Cannot read batch manifest {}: {}", manifestPath.string(),
+            e.what());
+        return EXIT_FAILURE;
+    }
 
-static void WriteIntermediatePointset(const PointSet& pointset)
-{
-    // Save intermediate pointsets if we're doing that
-    if (++CurrentIteration % SaveInterval == 0) {
-        WritePointset(pointset);
+    // Command line options are the defaults of every job. Segmentations are
+    // loaded up front since the VolumePkg is not thread-safe.
+    auto defaults = OptionsToJson(parsed);
+    std::vector<Job> jobs;
+    std::vector<std::string> lrpsSegs;
+    std::vector<fs::path> tffOutputs;
+    for (const auto& entry : manifest["jobs"]) {
+        Job job;
+        job.name = "[job " + std::to_string(jobs.size()) + "] ";
+        job.params = defaults;
+        try {
+            job.params.update(entry);
+            auto segID = job.params.at("seg").get<std::string>();
+            auto alg =
+                ParseAlgorithm(job.params.at("method").get<std::string>());
+            job.seg = vpkg.segmentation(segID);
+
+            // Jobs run on worker threads, where the visualization windows
+            // cannot be shown, and concurrent jobs would overwrite each
+            // other's visualization dumps
+            for (const auto* flag : {"visualize", "dump-vis"}) {
+                if (job.params.value(flag, false)) {
+                    throw std::invalid_argument(
+                        std::string("'") + flag +
+                        "' is not supported in batch mode");
+                }
+            }
+
+            // LRPS writes to the segmentation, so each may only be used once
+            if (alg == Algorithm::LRPS) {
+                if (std::find(lrpsSegs.begin(), lrpsSegs.end(), segID) !=
+                    lrpsSegs.end()) {
+                    throw std::invalid_argument(
+                        "segmentation " + segID +
+                        " is used by more than one LRPS job");
+                }
+                lrpsSegs.push_back(segID);
+            }
+        } catch (const std::exception& e) {
+            vc::Logger()->error("{}Invalid job: {}", job.name, e.what());
+            return EXIT_FAILURE;
+        }
+        auto prefix = "job" + std::to_string(jobs.size()) + "_";
+        job.output =
+            job.params.value("output", prefix + job.output.string());
+        job.maskOutput =
+            job.params.value("mask-output", prefix + job.maskOutput.string());
+
+        // TFF writes its results to files, so no two jobs may share a path
+        if (ParseAlgorithm(job.params.at("method").get<std::string>()) ==
+            Algorithm::TFF) {
+            std::vector<fs::path> outputs{job.output};
+            if (job.params.value("save-mask", false)) {
+                outputs.push_back(job.maskOutput);
+            }
+            for (const auto& output : outputs) {
+                auto path = fs::absolute(output).lexically_normal();
+                if (std::find(tffOutputs.begin(), tffOutputs.end(), path) !=
+                    tffOutputs.end()) {
+                    vc::Logger()->error(
+                        "{}Invalid job: output {} is written by more than one "
+                        "job",
+                        job.name, output.string());
+                    return EXIT_FAILURE;
+                }
+                tffOutputs.push_back(path);
+            }
+        }
+        jobs.push_back(std::move(job));
+    }
+    if (jobs.empty()) {
+        vc::Logger()->warn("Batch manifest contains no jobs");
+        return EXIT_SUCCESS;
     }
-}
 
-static void WriteMaskPointset(const VoxelMask& pointset)
-{
-    vc::PointSetIO<cv::Vec3i>::WritePointSet("mask_pointset.vcps", pointset);
+    ///// Load the shared Volume /////
+    vc::Volume::Identifier volID;
+    if (parsed.count("volume")) {
+        volID = parsed["volume"].as<std::string>();
+    } else if (manifest.contains("volume")) {
+        volID = manifest["volume"].get<std::string>();
+    } else if (jobs.front().seg->hasVolumeID()) {
+        volID = jobs.front().seg->getVolumeID();
+    }
+    vc::Volume::Pointer volume;
+    try {
+        volume = volID.empty() ? vpkg.volume() : vpkg.volume(volID);
+    } catch (const std::exception& e) {
+        vc::Logger()->error("Cannot load volume {}: {}", volID, e.what());
+        return EXIT_FAILURE;
+    }
+    for (const auto& job : jobs) {
+        if (job.seg->hasVolumeID() and job.seg->getVolumeID() != volume->id()) {
+            vc::Logger()->warn(
+                "{}Segmentation {} is associated with volume {}, but the "
+                "batch runs on volume {}",
+                job.name, job.seg->id(), job.seg->getVolumeID(),
+                volume->id());
+        }
+    }
+
+    // All jobs share this cache
+    volume->setCacheMemoryInBytes(cacheBytes);
+    std::cout << "Volume Cache :: ";
+    std::cout << "Capacity: " << volume->getCacheCapacity() << " || ";
+    std::cout << "Size: " << vc::BytesToMemorySizeString(cacheBytes);
+    std::cout << std::endl;
+
+    // Run the jobs on a fixed number of workers. Each job writes its result
+    // as soon as it finishes.
+    auto numWorkers = std::clamp<std::size_t>(
+        parsed["batch-jobs"].as<std::size_t>(), 1, jobs.size());
+    vc::Logger()->info(
+        "Running {} jobs with {} workers", jobs.size(), numWorkers);
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> failed{0};
+    std::vector<std::thread> workers;
+    for (std::size_t w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&]() {
+            for (auto i = next++; i < jobs.size(); i = next++) {
+                const auto& job = jobs[i];
+                auto start = std::chrono::steady_clock::now();
+                try {
+                    RunJob(job, vpkg, volume, std::nullopt);
+                    vc::Logger()->info(
+                        "{}Finished segmentation {} in {}", job.name,
+                        job.seg->id(),
+                        vc::DurationToString(
+                            std::chrono::steady_clock::now() - start));
+                } catch (const std::exception& e) {
+                    ++failed;
+                    vc::Logger()->error(
+                        "{}Segmentation {} failed: {}", job.name,
+                        job.seg->id(), e.what());
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (failed > 0) {
+        vc::Logger()->error("{} of {} jobs failed", failed.load(), jobs.size());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
 }
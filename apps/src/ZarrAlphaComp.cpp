@@ -203,40 +203,16 @@ private:
 
 cv::Mat_<cv::Vec3f> surf_alpha_integ(z5::Dataset *ds, ChunkCache *chunk_cache, const cv::Mat_<cv::Vec3f> &points, const cv::Mat_<cv::Vec3f> &normals, cv::Mat *composed)
 {
-    cv::Mat_<cv::Vec3f> res;
-    
-    cv::Mat_<float> integ(points.size(), 0);
-    cv::Mat_<float> integ_blur(points.size(), 0);
-    cv::Mat_<float> transparent(points.size(), 1);
-    cv::Mat_<float> blur(points.size(), 0);
-    cv::Mat_<float> integ_z(points.size(), 0);
+    cv::Mat_<float> integ;
+    cv::Mat_<float> integ_blur;
+    cv::Mat_<float> transparent;
+    cv::Mat_<float> integ_z;
     
-    for(int n=0;n<21;n++) {
-        xt::xarray<uint8_t> raw_extract;
-        // coords = points_reg*2.0;
-        float off = (n-5)*0.5;
-        readInterpolated3D(raw_extract, ds, xt_from_mat((points+normals*off)*0.5), chunk_cache);
-        cv::Mat_<uint8_t> slice = cv::Mat(raw_extract.shape(0), raw_extract.shape(1), CV_8U, raw_extract.data());
-        
-        cv::Mat floatslice;
-        slice.convertTo(floatslice, CV_32F, 1/255.0);
-        
-        cv::GaussianBlur(floatslice, blur, {7,7}, 0);
-        cv::Mat opaq_slice = blur;
-        
-        float low = 0.0; //map to 0
-        float up = 1.0; //map to 1
-        opaq_slice = (opaq_slice-low)/(up-low);
-        opaq_slice = cv::min(opaq_slice,1);
-        opaq_slice = cv::max(opaq_slice,0);
-        
-        cv::Mat joint = transparent.mul(opaq_slice);
-        integ += joint.mul(floatslice);
-        integ_blur += joint.mul(blur);
-        integ_z += joint * off;
-        transparent = transparent-joint;
-    }
+    std::vector<float> offsets;
+    for(int n=0;n<21;n++)
+        offsets.push_back((n-5)*0.5);
     
+    alphaCompNormals(integ_z, transparent, ds, chunk_cache, points, normals, offsets, 0.5, 1e-3, composed ? &integ : nullptr, composed ? &integ_blur : nullptr);
     
     if (composed) {
         integ /= (1-transparent);
@@ -1,5 +1,6 @@
 #include <nlohmann/json.hpp>
 
+#include <xtensor/xadapt.hpp>
 #include <xtensor/xarray.hpp>
 #include <xtensor/xaxis_slice_iterator.hpp>
 #include <xtensor/xio.hpp>
@@ -426,9 +427,44 @@ private:
     std::chrono::time_point<std::chrono::high_resolution_clock> start;
 };
 
+//write all layers into a single uint8 zarr array of shape (layers, h, w)
+static void write_zarr_stack(const fs::path &path, const std::vector<cv::Mat_<uint8_t>> &layers)
+{
+    z5::filesystem::handle::File f(path);
+    z5::createFile(f, true);
+    
+    nlohmann::json comp_options = {
+        {"blocksize", 0},
+        {"level", 9},
+        {"codec", "zstd"},
+        {"shuffle", 2}
+    };
+    
+    size_t d = layers.size();
+    size_t h = layers[0].rows;
+    size_t w = layers[0].cols;
+    
+    std::vector<size_t> stack_shape = {d, h, w};
+    std::vector<size_t> chunks_shape = {std::min<size_t>(d, 64), 128, 128};
+    auto ds = z5::createDataset(f, "0", "uint8", stack_shape, chunks_shape, "blosc", comp_options);
+    
+    xt::xarray<uint8_t> stack = xt::empty<uint8_t>(stack_shape);
+    for(size_t n=0;n<d;n++) {
+        auto slice = xt::adapt(layers[n].ptr<uint8_t>(), h*w, xt::no_ownership(), std::vector<std::size_t>({h, w}));
+        xt::view(stack, n) = slice;
+    }
+    
+    shape offset = {0, 0, 0};
+    z5::multiarray::writeSubarray<uint8_t>(ds, stack, offset.begin());
+}
+
 int main(int argc, char *argv[])
 {
-    assert(argc >= 4 && argc <= 5);
+    if (argc < 4 || argc > 5) {
+        std::cout << "usage: " << argv[0] << " <zarr-volume> <segment> <output> [slice]" << std::endl;
+        std::cout << "  output is either a directory (one tif per layer), a .zarr (layer stack) or a .tif (multi-page)" << std::endl;
+        return EXIT_FAILURE;
+    }
     
     const char *vol_path = argv[1];
     const char *segment_path = argv[2];
@@ -437,27 +473,32 @@ int main(int argc, char *argv[])
     int min_slice = 0;
     int max_slice = 65;
     
-    if (!fs::exists(outdir_path)) {
+    //stack outputs build the surface once and sample all layers in one batched pass
+    std::string out_ext = fs::path(outdir_path).extension().string();
+    bool batch = out_ext == ".zarr" || out_ext == ".tif" || out_ext == ".tiff";
+    
+    if (argc == 5) {
+        min_slice = atoi(argv[4]);
+        max_slice = min_slice;
+    }
+
+    if (batch) {
+        if (fs::exists(outdir_path)) {
+            printf("ERROR: target path %s already exists\n", outdir_path);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (!fs::exists(outdir_path)) {
         fs::create_directory(outdir_path);
     }
     else if (!fs::is_directory(outdir_path)) {
         printf("ERROR: target path %s is not a directory\n", outdir_path);
         return EXIT_FAILURE;
     }
-
-    if (argc == 5) {
-        min_slice = atoi(argv[4]);
-        max_slice = min_slice;
-    }
-    else if (!fs::is_empty(outdir_path)) {
+    else if (argc != 5 && !fs::is_empty(outdir_path)) {
         printf("ERROR: target path %s is not empty\n", outdir_path);
         return EXIT_FAILURE;
     }
-
-    else if (!fs::is_directory(outdir_path) || !fs::is_empty(outdir_path)) {
-        printf("ERROR: target path %s is not an empty directory\n", outdir_path);
-        return EXIT_FAILURE;
-    }
   
     MeasureLife *timer = new MeasureLife("loading ...");
     z5::filesystem::handle::Group group(vol_path, z5::FileMode::FileMode::r);
@@ -554,6 +595,41 @@ int main(int argc, char *argv[])
     
     // output_scale *= 0.5;
     
+    if (batch) {
+        //every layer is generated exactly like in the per slice loop below (the refined surface is generated at
+        //the layer offset), only the chunk reads are batched: groups of layers are sampled in one chunk ordered
+        //pass, the group size bounds the memory held by the coordinates of the group
+        int layers_per_pass = std::max(1, int(2e9/(double(w)*h*sizeof(cv::Vec3f))));
+        std::vector<cv::Mat_<uint8_t>> layers;
+        for(int first=min_slice;first<=max_slice;first+=layers_per_pass) {
+            int last = std::min(first+layers_per_pass-1, max_slice);
+            std::vector<cv::Mat_<cv::Vec3f>> group;
+            {
+                MeasureLife timer("generate layers "+std::to_string(first)+"-"+std::to_string(last)+" ...");
+                for(int off=first;off<=last;off++) {
+                    comp_surf->gen(&coords, nullptr, {w,h}, nullptr, output_scale, {-w/2,-h/2,off-32});
+                    coords *= ds_scale;
+                    group.push_back(coords.clone());
+                }
+            }
+            std::vector<cv::Mat_<uint8_t>> group_layers;
+            {
+                MeasureLife timer("rendering "+std::to_string(group.size())+" layers ...");
+                readInterpolated3DLayers(group_layers, ds.get(), group, &chunk_cache);
+            }
+            layers.insert(layers.end(), group_layers.begin(), group_layers.end());
+        }
+        {
+            MeasureLife timer("writing ...");
+            if (out_ext == ".zarr")
+                write_zarr_stack(outdir_path, layers);
+            else
+                cv::imwritemulti(outdir_path, std::vector<cv::Mat>(layers.begin(), layers.end()));
+        }
+        
+        return 0;
+    }
+    
     timer = new MeasureLife("rendering ...\n");
     for(int off=min_slice;off<=max_slice;off++) {
         MeasureLife time_slice("slice "+std::to_string(off)+" ... ");
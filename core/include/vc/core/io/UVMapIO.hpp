@@ -8,6 +8,10 @@ namespace volcart::io
 /**
  * @brief Write a UVMap in the custom .uvm archival format
  *
+ * Version 2 of the format follows the text header with the UVMap's validity
+ * bitmap and its dense, vertex-indexed UV array, each written with a single
+ * bulk write in the map's storage precision.
+ *
  * @throws volcart::IOException
  */
 void WriteUVMap(const filesystem::path& path, const UVMap& uvMap);
@@ -15,6 +19,9 @@ void WriteUVMap(const filesystem::path& path, const UVMap& uvMap);
 /**
  * @brief Read a UVMap from the custom .uvm archival format
  *
+ * Reads both version 1 (ID/value pairs) and version 2 (bulk dense storage)
+ * files.
+ *
  * @throws volcart::IOException
  */
 auto ReadUVMap(const filesystem::path& path) -> UVMap;
@@ -0,0 +1,30 @@
+#pragma once
+
+/** @file */
+
+#include "vc/core/filesystem.hpp"
+#include "vc/core/types/VolumetricMask.hpp"
+
+namespace volcart::io
+{
+/**
+ * @brief Write a VolumetricMask in the custom .vcvm format
+ *
+ * The text header is followed by the mask's blocks. Each block is stored as
+ * its block index, a bitmap of which of its rows contain masked voxels, and
+ * those non-empty rows. A thin layer mask therefore takes a small fraction of
+ * the space of the equivalent .vcps point set.
+ *
+ * @throws volcart::IOException
+ */
+void WriteVolumetricMask(
+    const filesystem::path& path, const VolumetricMask& mask);
+
+/**
+ * @brief Read a VolumetricMask from the custom .vcvm format
+ *
+ * @throws volcart::IOException
+ */
+auto ReadVolumetricMask(const filesystem::path& path)
+    -> VolumetricMask::Pointer;
+}  // namespace volcart::io
@@ -86,6 +86,13 @@ StructureTensor ComputeSubvoxelStructureTensor(
     int radius = 1,
     int kernelSize = 3);
 
+/**
+ * @brief Compute the eigenvalues and eigenvectors of a structure tensor
+ *
+ * Eigenpairs are sorted in descending order of eigenvalue.
+ */
+EigenPairs ComputeEigenPairs(const StructureTensor& st);
+
 /**
  * @brief Compute the eigenvalues and eigenvectors from the structure tensor
  * for a voxel position
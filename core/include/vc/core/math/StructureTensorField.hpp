@@ -0,0 +1,176 @@
+/**
+ * @file
+ *
+ * @ingroup Math
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "vc/core/filesystem.hpp"
+#include "vc/core/math/StructureTensor.hpp"
+#include "vc/core/types/LRUCache.hpp"
+#include "vc/core/types/Volume.hpp"
+
+namespace z5
+{
+class Dataset;
+}
+
+namespace volcart
+{
+/**
+ * @class StructureTensorField
+ * @brief Lazily computed, cached structure tensor field of a Volume
+ *
+ * ComputeSubvoxelStructureTensor() builds a neighborhood, its gradients, and
+ * a Gaussian window from scratch for every query. This class instead computes
+ * the structure tensor of every voxel in a cubic block the first time any
+ * position inside that block is queried. The gradient operators and the
+ * Gaussian window are applied as separable filters over whole slices of the
+ * block. Finished blocks are kept in an LRU cache bounded by a memory budget
+ * and can optionally be persisted to a zarr array with setCachePath(), so
+ * later runs on the same Volume skip the computation entirely.
+ *
+ * Subvoxel queries trilinearly interpolate the tensors of the eight
+ * surrounding voxels. The tensors use the same gradient operators and
+ * Gaussian weighting as ComputeSubvoxelStructureTensor() on raw (not
+ * normalized) intensities. Unlike that function, gradients at the edge of the
+ * window are computed from the real neighboring voxels instead of a
+ * replicated border.
+ *
+ * All query functions are thread-safe.
+ *
+ * @ingroup Math
+ */
+class StructureTensorField
+{
+public:
+    /** Shared pointer type */
+    using Pointer = std::shared_ptr<StructureTensorField>;
+
+    /** Default block edge length in voxels */
+    static constexpr int DEFAULT_BLOCK_SIZE = 32;
+
+    /** Default memory budget for cached blocks: 1 GiB */
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 1ULL << 30;
+
+    /**
+     * @brief Constructor
+     *
+     * @param radius Radius of the Gaussian window
+     * @param kernelSize Size of the gradient kernel. See
+     * ComputeVoxelStructureTensor().
+     * @param blockSize Edge length of the cubic blocks which are computed and
+     * cached as a unit
+     */
+    explicit StructureTensorField(
+        Volume::Pointer volume,
+        int radius = 1,
+        int kernelSize = 3,
+        int blockSize = DEFAULT_BLOCK_SIZE);
+
+    /** @copydoc StructureTensorField() */
+    static auto New(
+        Volume::Pointer volume,
+        int radius = 1,
+        int kernelSize = 3,
+        int blockSize = DEFAULT_BLOCK_SIZE) -> Pointer;
+
+    /** @brief Destructor */
+    ~StructureTensorField();
+
+    /**@{*/
+    /** @brief Get the Gaussian window radius */
+    auto radius() const -> int { return radius_; }
+
+    /** @brief Get the gradient kernel size */
+    auto kernelSize() const -> int { return kernelSize_; }
+
+    /** @brief Get the block edge length */
+    auto blockSize() const -> int { return blockSize_; }
+
+    /** @brief Set the maximum number of bytes used by cached blocks */
+    void setMemoryBudget(std::size_t bytes);
+
+    /** @brief Get the maximum number of bytes used by cached blocks */
+    auto memoryBudget() const -> std::size_t;
+
+    /**
+     * @brief Persist computed blocks to a zarr array
+     *
+     * If @p path already holds a field computed with the same parameters,
+     * its blocks are read instead of being recomputed. Otherwise a new zarr
+     * array is created there. Must be called before the field is queried.
+     *
+     * @throws std::runtime_error if @p path holds a field with different
+     * parameters or dimensions
+     */
+    void setCachePath(const filesystem::path& path);
+
+    /** @brief Drop all blocks from the memory cache */
+    void purge();
+    /**@}*/
+
+    /**@{*/
+    /** @brief Get the structure tensor of a voxel */
+    auto structureTensorAt(int x, int y, int z) -> StructureTensor;
+
+    /**
+     * @brief Get the structure tensor at a subvoxel position
+     *
+     * Returns ZERO_STRUCTURE_TENSOR for positions outside of the Volume.
+     */
+    auto structureTensorAt(const cv::Vec3d& v) -> StructureTensor;
+
+    /** @brief Get the eigenpairs of the structure tensor at a position */
+    auto eigenPairsAt(const cv::Vec3d& v) -> EigenPairs;
+    /**@}*/
+
+private:
+    /** Tensor components: xx, xy, xz, yy, yz, zz */
+    using Tensor = cv::Vec6f;
+    /** One computed block, stored z-major */
+    using Block = std::shared_ptr<const std::vector<Tensor>>;
+
+    /** Get a block from the cache, loading or computing it if needed */
+    auto block_(int bx, int by, int bz) -> Block;
+    /** Compute a block from the Volume */
+    auto compute_block_(int bx, int by, int bz) const -> Block;
+    /** Read a block from the zarr array, if present */
+    auto read_block_(int bx, int by, int bz) const -> Block;
+    /** Write a block to the zarr array */
+    void write_block_(int bx, int by, int bz, const Block& block) const;
+
+    /** Get the tensor of a voxel within a block */
+    auto voxel_(const Block& block, int x, int y, int z) const -> Tensor
+    {
+        return (*block)
+            [(static_cast<std::size_t>(z) * blockSize_ + y) * blockSize_ + x];
+    }
+
+    /** Source volume */
+    Volume::Pointer vol_;
+    /** Gaussian window radius */
+    int radius_;
+    /** Gradient kernel size */
+    int kernelSize_;
+    /** Block edge length */
+    int blockSize_;
+    /** Block cache */
+    LRUCache<std::uint64_t, Block> cache_;
+    /** Serializes the computation of blocks which share a mutex */
+    static constexpr std::size_t NUM_BLOCK_MUTEXES = 64;
+    std::array<std::mutex, NUM_BLOCK_MUTEXES> blockMutexes_;
+    /** Persistent storage */
+    std::unique_ptr<z5::Dataset> zarrDs_;
+};
+}  // namespace volcart
@@ -180,7 +180,7 @@ public:
     auto data() -> typename Container::value_type* { return data_.data(); }
 
     /** @overload data() */
-    auto data() const -> typename Container::value_type*
+    auto data() const -> const typename Container::value_type*
     {
         return data_.data();
     }
@@ -3,17 +3,27 @@
 /** @file */
 
 #include <cstddef>
-#include <map>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "vc/core/filesystem.hpp"
 #include "vc/core/types/Color.hpp"
 #include "vc/core/types/ITKMesh.hpp"
 
 namespace volcart
 {
+class UVMap;
+
+namespace io
+{
+void WriteUVMap(const filesystem::path& path, const UVMap& uvMap);
+auto ReadUVMap(const filesystem::path& path) -> UVMap;
+}  // namespace io
+
 /** Null/Undefined UV Mapping */
 const static cv::Vec2d NULL_MAPPING{-1, -1};
 
@@ -46,6 +56,12 @@ const static cv::Vec2d NULL_MAPPING{-1, -1};
  * a way to store the dimensions and aspect ratio of the texture space for
  * later PerPixelMap and Texture generation.
  *
+ * Mappings are stored in a dense array indexed by vertex ID, alongside a
+ * bitmap which marks the IDs that have a mapping. Lookups are therefore a
+ * single array access, but storage grows with the largest inserted ID. UVs
+ * are stored as double-precision values by default. Use setPrecision() to
+ * store single-precision values and halve the memory footprint.
+ *
  * @ingroup Types
  */
 class UVMap
@@ -62,6 +78,9 @@ public:
         double width{1}, height{1}, aspect{1};
     };
 
+    /** Storage precision enumeration */
+    enum class Precision { Float64 = 0, Float32 };
+
     /**@{*/
     /** @brief Default constructor */
     UVMap() = default;
@@ -83,6 +102,33 @@ public:
 
     /** @brief Return whether the UVMap is empty */
     [[nodiscard]] auto empty() const -> bool;
+
+    /**
+     * @brief Return the number of vertex ID slots in storage
+     *
+     * One greater than the largest ID which has been set. IDs in the range
+     * `[0, extent())` may or may not have a mapping. Use contains() to check.
+     */
+    [[nodiscard]] auto extent() const -> std::size_t;
+
+    /** @brief Reserve storage for vertex IDs in the range `[0, n)` */
+    void reserve(std::size_t n);
+
+    /** @brief Remove all mappings */
+    void clear();
+    /**@}*/
+
+    /**@{*/
+    /**
+     * @brief Set the storage precision
+     *
+     * Existing mappings are converted to the new precision. Values are always
+     * returned as double-precision by get().
+     */
+    void setPrecision(Precision p);
+
+    /** @brief Get the storage precision */
+    [[nodiscard]] auto precision() const -> Precision;
     /**@}*/
 
     /**@{*/
@@ -128,9 +174,6 @@ public:
 
     /** @brief Check if the vertex index has a UV mapping */
     [[nodiscard]] auto contains(std::size_t id) const -> bool;
-
-    /** Access to underlying data. For serialization only. */
-    [[nodiscard]] auto as_map() const -> std::map<std::size_t, cv::Vec2d>;
     /**@}*/
 
     /**@{*/
@@ -234,8 +277,46 @@ public:
     /**@}*/
 
 private:
-    /** UV storage */
-    std::map<std::size_t, cv::Vec2d> map_;
+    friend void io::WriteUVMap(const filesystem::path&, const UVMap&);
+    friend auto io::ReadUVMap(const filesystem::path&) -> UVMap;
+
+    /** Validity bitmap word type */
+    using BitmapWord = std::uint64_t;
+    /** Number of bits in a validity bitmap word */
+    static constexpr std::size_t BITMAP_WORD_BITS{64};
+
+    /** Get the stored value (relative to the storage origin) */
+    [[nodiscard]] auto stored_(std::size_t id) const -> cv::Vec2d;
+    /** Set the stored value (relative to the storage origin) */
+    void store_(std::size_t id, const cv::Vec2d& uv);
+    /** Grow the storage so that ID @p id is addressable */
+    void grow_(std::size_t id);
+
+    /** Apply a function to every stored value */
+    template <typename Fn>
+    void for_each_stored_(Fn fn)
+    {
+        for (std::size_t id = 0; id < extent_; id++) {
+            if (contains(id)) {
+                auto uv = stored_(id);
+                fn(id, uv);
+                store_(id, uv);
+            }
+        }
+    }
+
+    /** Double-precision UV storage. Used when precision_ is Float64. */
+    std::vector<cv::Vec2d> uv64_;
+    /** Single-precision UV storage. Used when precision_ is Float32. */
+    std::vector<cv::Vec2f> uv32_;
+    /** Validity bitmap. One bit per vertex ID. */
+    std::vector<BitmapWord> valid_;
+    /** Number of vertex ID slots */
+    std::size_t extent_{0};
+    /** Number of valid mappings */
+    std::size_t size_{0};
+    /** Storage precision */
+    Precision precision_{Precision::Float64};
     /** Origin for set and get functions */
     Origin origin_{Origin::TopLeft};
     /** Aspect ratio */
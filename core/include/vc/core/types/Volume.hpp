@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <mutex>
+#include <vector>
 
 #include "vc/core/filesystem.hpp"
 #include "vc/core/types/BoundingBox.hpp"
@@ -215,6 +216,25 @@ public:
         const cv::Vec3d& yvec,
         int width = 64,
         int height = 64) const;
+
+    /**
+     * @brief Create a Reslice image from a preloaded slab of voxels
+     *
+     * Produces the same image as reslice(), but reads voxels from @p slab, a
+     * contiguous run of equally sized slice regions (e.g. from
+     * getSliceDataRectCopy()). Element (y, x) of `slab[z]` holds the voxel at
+     * @p slabOrigin + (x, y, z). Voxels outside of the slab fall back to the
+     * slice cache. Since the slab is only read, many reslices may be sampled
+     * from the same slab concurrently without contending on the cache.
+     */
+    Reslice reslice(
+        const cv::Vec3d& center,
+        const cv::Vec3d& xvec,
+        const cv::Vec3d& yvec,
+        const std::vector<cv::Mat>& slab,
+        const cv::Vec3i& slabOrigin,
+        int width = 64,
+        int height = 64) const;
     /**@}*/
 
     /**@{*/
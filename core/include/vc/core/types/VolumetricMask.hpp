@@ -2,20 +2,47 @@
 
 /** @file */
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
-#include <unordered_set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <opencv2/core.hpp>
+
+#include "vc/core/filesystem.hpp"
 #include "vc/core/types/PointSet.hpp"
-#include "vc/core/util/HashFunctions.hpp"
 
 namespace volcart
 {
+class VolumetricMask;
+
+namespace io
+{
+void WriteVolumetricMask(
+    const filesystem::path& path, const VolumetricMask& mask);
+auto ReadVolumetricMask(const filesystem::path& path)
+    -> std::shared_ptr<VolumetricMask>;
+}  // namespace io
 
 /**
  * @brief Stores per-voxel mask information for a volume
  *
- * @warning This container is built on std::unordered_set, so it's very fast
- * once built, but not very memory friendly.
+ * Voxels are stored as bits in sparse, fixed-size 3D blocks. Each block covers
+ * a 64x32x32 (XYZ) region of the volume and stores every row of 64 voxels as
+ * a single 64-bit word, so a block costs 8 KiB whether it holds one voxel or
+ * 65536. Blocks are only allocated once a voxel inside them is set. Masks of
+ * layers, which fill most of the blocks they touch, use well under one byte
+ * per voxel.
+ *
+ * Iteration visits the masked voxels in unspecified order, like the
+ * std::unordered_set this class used to be built on.
+ *
+ * @warning Modifying the mask is not thread-safe. To build a mask from many
+ * threads, fill one mask per thread and combine them with merge().
  */
 class VolumetricMask
 {
@@ -23,15 +50,132 @@ public:
     /** Voxel type */
     using Voxel = cv::Vec3i;
 
+    /** Block width (X) in voxels. One block row is one storage word. */
+    static constexpr int BLOCK_WIDTH = 64;
+    /** Block height (Y) in voxels */
+    static constexpr int BLOCK_HEIGHT = 32;
+    /** Block depth (Z) in voxels */
+    static constexpr int BLOCK_DEPTH = 32;
+    /** Number of storage words in a block */
+    static constexpr std::size_t BLOCK_WORDS = BLOCK_HEIGHT * BLOCK_DEPTH;
+
+    /**
+     * @brief A run of consecutive masked voxels along the X-axis
+     *
+     * Covers the voxels `[xBegin, xEnd)` in row `y` of slice `z`.
+     */
+    struct Run {
+        /** First voxel in the run */
+        int xBegin{0};
+        /** One past the last voxel in the run */
+        int xEnd{0};
+        /** Row of the run */
+        int y{0};
+        /** Slice of the run */
+        int z{0};
+    };
+
 private:
-    /** Custom set type */
-    using MaskSet = std::unordered_set<Voxel, Vec3iHash>;
+    /** Bit-packed storage for one block, indexed by (z * BLOCK_HEIGHT + y) */
+    using Block = std::array<std::uint64_t, BLOCK_WORDS>;
+    /** Blocks indexed by packed block position */
+    using BlockMap = std::unordered_map<std::uint64_t, Block>;
 
 public:
-    /** Iterator type */
-    using iterator = MaskSet::iterator;
-    /** Const-iterator type */
-    using const_iterator = MaskSet::const_iterator;
+    /** Forward iterator over the masked voxels */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Voxel;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Voxel*;
+        using reference = const Voxel&;
+
+        /** @brief Default constructor */
+        const_iterator() = default;
+
+        auto operator*() const -> reference { return voxel_; }
+        auto operator->() const -> pointer { return &voxel_; }
+
+        auto operator++() -> const_iterator&
+        {
+            bits_ &= bits_ - 1;
+            if (bits_ == 0) {
+                ++word_;
+                settle_();
+            } else {
+                update_voxel_();
+            }
+            return *this;
+        }
+
+        auto operator++(int) -> const_iterator
+        {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        auto operator==(const const_iterator& rhs) const -> bool
+        {
+            return block_ == rhs.block_ &&
+                   (block_ == end_ ||
+                    (word_ == rhs.word_ && bits_ == rhs.bits_));
+        }
+
+        auto operator!=(const const_iterator& rhs) const -> bool
+        {
+            return !(*this == rhs);
+        }
+
+    private:
+        friend class VolumetricMask;
+
+        const_iterator(
+            BlockMap::const_iterator block, BlockMap::const_iterator end)
+            : block_{block}, end_{end}
+        {
+            settle_();
+        }
+
+        /** Move to the first set bit at or after the current word */
+        void settle_()
+        {
+            while (block_ != end_) {
+                const auto& words = block_->second;
+                for (; word_ < BLOCK_WORDS; ++word_) {
+                    if (words[word_] != 0) {
+                        bits_ = words[word_];
+                        update_voxel_();
+                        return;
+                    }
+                }
+                ++block_;
+                word_ = 0;
+            }
+            bits_ = 0;
+        }
+
+        /** Compute the voxel position of the lowest set bit */
+        void update_voxel_()
+        {
+            auto origin = BlockOrigin(block_->first);
+            voxel_ = {
+                origin[0] + __builtin_ctzll(bits_),
+                origin[1] + static_cast<int>(word_ % BLOCK_HEIGHT),
+                origin[2] + static_cast<int>(word_ / BLOCK_HEIGHT)};
+        }
+
+        BlockMap::const_iterator block_{};
+        BlockMap::const_iterator end_{};
+        std::size_t word_{0};
+        std::uint64_t bits_{0};
+        Voxel voxel_{};
+    };
+
+    /** Iterator type. Masked voxels cannot be modified through iterators. */
+    using iterator = const_iterator;
 
     /** Pointer type */
     using Pointer = std::shared_ptr<VolumetricMask>;
@@ -50,8 +194,7 @@ public:
     template <class Container>
     explicit VolumetricMask(const Container& ps)
     {
-        mask_.reserve(ps.size());
-        mask_.insert(std::begin(ps), std::end(ps));
+        setIn(ps);
     }
 
     /** @brief Add Voxel to mask */
@@ -63,8 +206,9 @@ public:
     template <class Container>
     void setIn(const Container& ps)
     {
-        mask_.reserve(mask_.size() + ps.size());
-        mask_.insert(std::begin(ps), std::end(ps));
+        for (const auto& p : ps) {
+            setIn(p);
+        }
     }
 
     /** @brief Remove Voxels from the mask */
@@ -76,6 +220,22 @@ public:
         }
     }
 
+    /**
+     * @brief Add every non-zero pixel of a slice image to the mask
+     *
+     * @param slice Single-channel, 8-bit image. Pixel (x, y) maps to voxel
+     * (x, y, z).
+     */
+    void setSliceIn(const cv::Mat& slice, int z);
+
+    /**
+     * @brief Get the masked voxels of a slice as an image
+     *
+     * Masked voxels are 255, all others 0. Voxels outside of `size` are
+     * ignored.
+     */
+    [[nodiscard]] auto slice(int z, const cv::Size& size) const -> cv::Mat;
+
     /** @brief Check whether a Voxel is in the mask */
     [[nodiscard]] auto isIn(const Voxel& v) const -> bool;
     /** @brief Check whether a Voxel is not in the mask */
@@ -86,16 +246,19 @@ public:
     /** @brief Check whether a sub-voxel is not in the mask */
     [[nodiscard]] auto isOut(const cv::Vec3d& v) const -> bool;
 
+    /**
+     * @brief Add every voxel of another mask to this mask
+     *
+     * Blocks present in both masks are combined in parallel.
+     */
+    void merge(const VolumetricMask& other);
+
     /** @brief Get a const-iterator to the first element in the mask */
-    auto begin() noexcept -> iterator;
-    /** @copydoc begin() */
     [[nodiscard]] auto begin() const noexcept -> const_iterator;
     /** @copydoc begin() */
     [[nodiscard]] auto cbegin() const noexcept -> const_iterator;
 
     /** @brief Get a const-iterator to one past the last element in the mask */
-    auto end() noexcept -> iterator;
-    /** @copydoc end() */
     [[nodiscard]] auto end() const noexcept -> const_iterator;
     /** @copydoc end() */
     [[nodiscard]] auto cend() const noexcept -> const_iterator;
@@ -106,12 +269,83 @@ public:
     /** @brief Check if mask is empty */
     [[nodiscard]] auto empty() const -> bool;
 
+    /** @brief Get the number of masked voxels */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /** @brief Get the number of bytes used by the mask storage */
+    [[nodiscard]] auto memoryUsage() const -> std::size_t;
+
     /** @brief Get the list of masked points as a vector */
     [[nodiscard]] auto as_vector() const -> std::vector<Voxel>;
 
+    /**
+     * @brief Get the masked voxels as runs along the X-axis
+     *
+     * Runs are sorted by slice, then row, then position in the row. Runs
+     * which cross block boundaries are joined.
+     */
+    [[nodiscard]] auto as_runs() const -> std::vector<Run>;
+
 private:
+    friend void io::WriteVolumetricMask(
+        const filesystem::path&, const VolumetricMask&);
+    friend auto io::ReadVolumetricMask(const filesystem::path&)
+        -> std::shared_ptr<VolumetricMask>;
+
+    /** Offset which makes block coordinates non-negative when packed */
+    static constexpr std::int64_t KEY_OFFSET = 1 << 20;
+
+    /** Get the packed key of the block containing a voxel */
+    static auto BlockKey(int x, int y, int z) -> std::uint64_t
+    {
+        return BlockKeyFromIndex(
+            FloorDiv(x, BLOCK_WIDTH), FloorDiv(y, BLOCK_HEIGHT),
+            FloorDiv(z, BLOCK_DEPTH));
+    }
+
+    /** Get the packed key of a block index */
+    static auto BlockKeyFromIndex(int bx, int by, int bz) -> std::uint64_t
+    {
+        return (static_cast<std::uint64_t>(bz + KEY_OFFSET) << 42) |
+               (static_cast<std::uint64_t>(by + KEY_OFFSET) << 21) |
+               static_cast<std::uint64_t>(bx + KEY_OFFSET);
+    }
+
+    /** Get the block index of a packed key */
+    static auto BlockIndex(std::uint64_t key) -> Voxel
+    {
+        constexpr std::uint64_t mask = (1ULL << 21) - 1;
+        return {
+            static_cast<int>(std::int64_t(key & mask) - KEY_OFFSET),
+            static_cast<int>(std::int64_t((key >> 21) & mask) - KEY_OFFSET),
+            static_cast<int>(std::int64_t(key >> 42) - KEY_OFFSET)};
+    }
+
+    /** Get the position of the first voxel in a block */
+    static auto BlockOrigin(std::uint64_t key) -> Voxel
+    {
+        auto idx = BlockIndex(key);
+        return {
+            idx[0] * BLOCK_WIDTH, idx[1] * BLOCK_HEIGHT, idx[2] * BLOCK_DEPTH};
+    }
+
+    /** Integer division rounding towards negative infinity */
+    static auto FloorDiv(int a, int b) -> int
+    {
+        return (a >= 0) ? a / b : -((-a + b - 1) / b);
+    }
+
+    /** Get the word index and bit of a voxel within its block */
+    static auto WordIndex(int x, int y, int z) -> std::pair<std::size_t, int>
+    {
+        auto lx = x - FloorDiv(x, BLOCK_WIDTH) * BLOCK_WIDTH;
+        auto ly = y - FloorDiv(y, BLOCK_HEIGHT) * BLOCK_HEIGHT;
+        auto lz = z - FloorDiv(z, BLOCK_DEPTH) * BLOCK_DEPTH;
+        return {static_cast<std::size_t>(lz * BLOCK_HEIGHT + ly), lx};
+    }
+
     /** Mask storage container */
-    MaskSet mask_;
+    BlockMap blocks_;
 };
 
 }  // namespace volcart
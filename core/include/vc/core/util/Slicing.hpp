@@ -3,6 +3,9 @@
 #include <xtensor/xarray.hpp>
 #include <opencv2/core.hpp>
 
+#include <memory>
+#include <mutex>
+
 namespace z5
 {
     class Dataset;
@@ -10,34 +13,53 @@ namespace z5
 
 //TODO generation overrun
 //TODO groupkey overrun
+//all methods lock internally so a cache can be shared between threads (e.g. background renderers)
+//chunks are handed out as shared pointers so a chunk that is evicted while another thread still samples it stays alive
 class ChunkCache
 {
 public:
+    using Chunk = std::shared_ptr<xt::xarray<uint8_t>>;
+    
     ChunkCache(size_t size) : _size(size) {};
-    ~ChunkCache();
     
     //get key for a subvolume - should be uniqueley identified between all groups and volumes that use this cache.
     //for example by using path + group name
     uint64_t groupKey(std::string name);
     
     //key should be unique for chunk and contain groupkey (groupkey sets highest 16bits of uint64_t)
-    void put(uint64_t key, xt::xarray<uint8_t> *ar);
-    xt::xarray<uint8_t> *get(uint64_t key);
+    //ar may be null for chunks that do not exist in the dataset
+    void put(uint64_t key, Chunk ar);
+    //insert ar only if key is not cached yet (checked and inserted under the cache lock), returns the chunk now stored for key
+    //so a thread that lost the race to another reader drops its own copy and continues with the winner's
+    Chunk putIfAbsent(uint64_t key, Chunk ar);
+    Chunk get(uint64_t key);
     bool has(uint64_t key);
 private:
+    void put_locked(uint64_t key, Chunk ar);
     uint64_t _generation = 0;
     size_t _size = 0;
     size_t _stored = 0;
-    std::unordered_map<uint64_t,xt::xarray<uint8_t>*> _store;
+    std::unordered_map<uint64_t,Chunk> _store;
     //store generation number
     std::unordered_map<uint64_t,uint64_t> _gen_store;
     //store group keys
     std::unordered_map<std::string,uint64_t> _group_store;
+    std::mutex _mutex;
 };
 
 //NOTE depending on request this might load a lot (the whole array) into RAM
 void readInterpolated3D(xt::xarray<uint8_t> &out, z5::Dataset *ds, const xt::xarray<float> &coords, ChunkCache *cache = nullptr);
 void readInterpolated3D(cv::Mat_<uint8_t> &out, z5::Dataset *ds, const cv::Mat_<cv::Vec3f> &coords, ChunkCache *cache = nullptr);
+//ids (in dataset order) of the chunks touched when sampling coords*scale, in order of first appearance
+std::vector<cv::Vec3i> chunksForCoords(z5::Dataset *ds, const cv::Mat_<cv::Vec3f> &coords, float scale);
+//decode a chunk into the cache if it is not cached yet, returns true if the chunk had to be read
+bool prefetchChunk(z5::Dataset *ds, ChunkCache *cache, const cv::Vec3i &id);
+//sample a stack of (already scaled) coordinate layers in a single chunk-ordered pass, out[n] samples coords[n] like readInterpolated3D() would
+void readInterpolated3DLayers(std::vector<cv::Mat_<uint8_t>> &out, z5::Dataset *ds, const std::vector<cv::Mat_<cv::Vec3f>> &coords, ChunkCache *cache = nullptr);
+//front to back alpha compositing of the (7x7 gauss blurred) volume along (coords+normals*offsets[n])*scale in a single fused pass
+//integ_z accumulates opacity*offset, transparent the remaining transparency, integ/integ_blur the opacity weighted raw/blurred values
+//pixels stop marching once their transparency drops below min_transparent
+void alphaCompNormals(cv::Mat_<float> &integ_z, cv::Mat_<float> &transparent, z5::Dataset *ds, ChunkCache *cache, const cv::Mat_<cv::Vec3f> &coords, const cv::Mat_<cv::Vec3f> &normals, const std::vector<float> &offsets, float scale, float min_transparent = 0, cv::Mat_<float> *integ = nullptr, cv::Mat_<float> *integ_blur = nullptr);
 cv::Mat_<cv::Vec3f> smooth_vc_segmentation(const cv::Mat_<cv::Vec3f> &points);
 cv::Mat_<cv::Vec3f> vc_segmentation_calc_normals(const cv::Mat_<cv::Vec3f> &points);
 void vc_segmentation_scales(cv::Mat_<cv::Vec3f> points, double &sx, double &sy);
@@ -2,7 +2,12 @@
 
 #include <opencv2/core.hpp> 
 
+#include <functional>
+#include <memory>
+#include <mutex>
+
 class QuadSurface;
+class PlaneSurface;
 class ChunkCache;
 
 namespace z5 {
@@ -13,6 +18,7 @@ namespace z5 {
 class SurfacePointer
 {
 public:
+    virtual ~SurfacePointer() = default;
     virtual SurfacePointer *clone() const = 0;
 };
 
@@ -26,6 +32,9 @@ public:
 
 QuadSurface *load_quad_from_vcps(const std::string &path);
 QuadSurface *load_quad_from_obj(const std::string &path);
+//native format: json header (scale, bbox, ...) followed by the float32 xyz grid, mapped into memory without conversion
+QuadSurface *load_quad_from_vcqs(const std::string &path);
+bool write_quad_to_vcqs(QuadSurface *surf, const std::string &path);
 QuadSurface *regularized_local_quad(QuadSurface *src, SurfacePointer *ptr, int w, int h, int step_search = 100, int step_out = 5);
 QuadSurface *smooth_vc_segmentation(QuadSurface *src);
 
@@ -33,6 +42,8 @@ QuadSurface *smooth_vc_segmentation(QuadSurface *src);
 class Surface
 {
 public:    
+    virtual ~Surface() = default;
+    
     // a pointer in some central location
     virtual SurfacePointer *pointer() = 0;
     
@@ -84,6 +95,36 @@ protected:
     cv::Vec3d _T;
 };
 
+//hierarchy of axis aligned bounding boxes over a point grid
+//level 0 has one box per patch of patch_size x patch_size quads, every level above merges 2x2 boxes
+//invalid points (x == -1) are ignored, patches without valid points have no box
+class GridBoundsTree
+{
+public:
+    GridBoundsTree(const cv::Mat_<cv::Vec3f> &points, int patch_size = 16);
+    
+    //grid rects (_points coordinates) of all patches whose box is closer than dist to the plane
+    //if plane_roi is not empty only patches whose box projects into it are returned
+    std::vector<cv::Rect> planePatches(PlaneSurface *plane, float dist, const cv::Rect &plane_roi = {}) const;
+    //best first traversal of all patches by increasing lower bound of their distance to tgt
+    //visit() returns the best distance found so far, traversal ends once no patch may be closer
+    void visitNearest(const cv::Vec3f &tgt, const std::function<float(const cv::Rect &patch, float lower_bound)> &visit) const;
+    
+    int patchSize() const { return _patch_size; }
+protected:
+    struct Level {
+        int w, h;
+        std::vector<cv::Vec3f> lo, hi;
+    };
+    
+    bool valid(int level, int x, int y) const;
+    cv::Rect patchRect(int level, int x, int y) const;
+    
+    std::vector<Level> _levels;
+    cv::Size _grid_size;
+    int _patch_size;
+};
+
 //quads based surface class with a pointer implementing a nominal scale of 1 voxel
 class QuadSurface : public Surface
 {
@@ -100,15 +141,27 @@ public:
     float pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th, int max_iters = 1000) override;
 
     virtual cv::Mat_<cv::Vec3f> rawPoints() { return _points; }
+    cv::Vec2f scale() const { return _scale; }
+    //shares the grid without a copy, background jobs may keep using it after the surface is gone
+    //_points is never written in place, so readers of the shared grid need no locking
+    std::shared_ptr<const cv::Mat_<cv::Vec3f>> sharedPoints() const;
+    //built on first use, shared so background jobs can keep using it
+    std::shared_ptr<const GridBoundsTree> boundsTree();
 
     friend QuadSurface *regularized_local_quad(QuadSurface *src, SurfacePointer *ptr, int w, int h, int step_search, int step_out);
     friend QuadSurface *smooth_vc_segmentation(QuadSurface *src);
     friend class ControlPointSurface;
+    friend QuadSurface *load_quad_from_vcqs(const std::string &path);
+    friend bool write_quad_to_vcqs(QuadSurface *surf, const std::string &path);
 protected:
     cv::Mat_<cv::Vec3f> _points;
     cv::Rect _bounds;
     cv::Vec2f _scale;
     cv::Vec3f _center;
+    //keeps the file mapping alive if _points was loaded with load_quad_from_vcqs()
+    std::shared_ptr<void> _mapping;
+    std::shared_ptr<const GridBoundsTree> _bounds_tree;
+    std::mutex _bounds_tree_mutex;
 };
 
 
@@ -131,9 +184,17 @@ public:
     cv::Vec3f normal(SurfacePointer *ptr, const cv::Vec3f &offset = {0,0,0}) override;
     void gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset) override = 0;
     float pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th, int max_iters = 1000) override;
+    
+    //output pixels around a location whose base values are needed to generate it (filter size etc.)
+    virtual int border() const { return 0; }
+    //edits since the last call as nominal x/y + radius of influence in output pixels, radius < 0: everything changed
+    std::vector<cv::Vec3f> takeChanges();
 
 protected:
+    void changed(const cv::Vec2f &nominal = {0,0}, float radius = -1);
+    
     Surface *_base = nullptr;
+    std::vector<cv::Vec3f> _changes;
 };
 
 //might in the future have more properties! or those props are handled in whatever class manages a set of control points ...
@@ -165,6 +226,8 @@ class RefineCompSurface : public DeltaSurface
 public:
     RefineCompSurface(z5::Dataset *ds, ChunkCache *cache, QuadSurface *base = nullptr);
     void gen(cv::Mat_<cv::Vec3f> *coords, cv::Mat_<cv::Vec3f> *normals, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset) override;
+    //blur apron of alphaCompNormals() + normals from neighbouring coords
+    int border() const override { return 4; }
     
 protected:
     z5::Dataset *_ds;
@@ -172,6 +235,7 @@ protected:
 };
 
 //TODO constrain to visible area? or add visiable area disaplay?
-void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::vector<std::vector<cv::Vec2f>> &seg_grid, const cv::Mat_<cv::Vec3f> &points, PlaneSurface *plane, const cv::Rect &plane_roi, float step);
+//tree (built over points) restricts the search to patches crossing the plane
+void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::vector<std::vector<cv::Vec2f>> &seg_grid, const cv::Mat_<cv::Vec3f> &points, PlaneSurface *plane, const cv::Rect &plane_roi, float step, const GridBoundsTree *tree = nullptr);
 
 float min_loc(const cv::Mat_<cv::Vec3f> &points, cv::Vec2f &loc, cv::Vec3f &out, const std::vector<cv::Vec3f> &tgts, const std::vector<float> &tds, PlaneSurface *plane, float init_step = 16.0, float min_step = 0.125);
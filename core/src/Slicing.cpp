@@ -19,10 +19,12 @@
 #include <opencv2/core.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
+#include <mutex>
 #include <shared_mutex>
 
 #include <algorithm>
 #include <random>
+#include <unordered_set>
 
 using shape = z5::types::ShapeType;
 using namespace xt::placeholders;
@@ -63,7 +65,7 @@ namespace z5 {
     namespace multiarray {
 
         template<typename T>
-        inline xt::xarray<T> *readChunk(const Dataset & ds,
+        inline std::shared_ptr<xt::xarray<T>> readChunk(const Dataset & ds,
                             types::ShapeType chunkId)
         {
             if (!ds.chunkExists(chunkId)) {
@@ -83,8 +85,7 @@ namespace z5 {
             
             // chunkSize = std::accumulate(chunkShape.begin(), chunkShape.end(), 1, std::multiplies<std::size_t>());
             
-            xt::xarray<T> *out = new xt::xarray<T>();
-            *out = xt::empty<T>(maxChunkShape);
+            auto out = std::make_shared<xt::xarray<T>>(xt::empty<T>(maxChunkShape));
             
             // read the data from storage
             std::vector<char> dataBuffer;
@@ -100,14 +101,43 @@ namespace z5 {
 
 uint64_t ChunkCache::groupKey(std::string name)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
     if (!_group_store.count(name))
         _group_store[name] = _group_store.size()+1;
     
      return _group_store[name] << 48;
 }
     
-void ChunkCache::put(uint64_t key, xt::xarray<uint8_t> *ar)
+void ChunkCache::put(uint64_t key, Chunk ar)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    put_locked(key, std::move(ar));
+}
+
+ChunkCache::Chunk ChunkCache::putIfAbsent(uint64_t key, Chunk ar)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto res = _store.find(key);
+    if (res != _store.end()) {
+        _generation++;
+        _gen_store[key] = _generation;
+        return res->second;
+    }
+    
+    put_locked(key, ar);
+    return ar;
+}
+
+void ChunkCache::put_locked(uint64_t key, Chunk ar)
+{
+    //replacing a chunk must not count it twice
+    auto old = _store.find(key);
+    if (old != _store.end() && old->second)
+        _stored -= old->second->size();
+    
     if (ar)
         _stored += ar->size();
     
@@ -118,13 +148,11 @@ void ChunkCache::put(uint64_t key, xt::xarray<uint8_t> *ar)
         std::vector<KP> gen_list(_gen_store.begin(), _gen_store.end());
         std::sort(gen_list.begin(), gen_list.end(), [](KP &a, KP &b){ return a.second < b.second; });
         for(auto it : gen_list) {
-            xt::xarray<uint8_t> *ar = _store[it.first];
+            const Chunk &ar = _store[it.first];
             //TODO we could remove this with lower probability so we dont store infiniteyl empty blocks but also keep more of them as they are cheap
-            if (ar) {
-                size_t size = ar->storage().size();
-                delete ar;
-                _stored -= size;
-            }
+            //the chunk itself is only freed once no reader holds it anymore
+            if (ar)
+                _stored -= ar->storage().size();
             
             _store.erase(it.first);
             _gen_store.erase(it.first);
@@ -136,20 +164,15 @@ void ChunkCache::put(uint64_t key, xt::xarray<uint8_t> *ar)
         printf("cache reduce done %f\n",float(_stored)/1024/1024);
     }
     
-    _store[key] = ar;
+    _store[key] = std::move(ar);
     _generation++;
     _gen_store[key] = _generation;
 }
 
-
-ChunkCache::~ChunkCache()
-{
-    for(auto &it : _store)
-        delete it.second;
-}
-
-xt::xarray<uint8_t> *ChunkCache::get(uint64_t key)
+ChunkCache::Chunk ChunkCache::get(uint64_t key)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
     auto res = _store.find(key);
     if (res == _store.end())
         return nullptr;
@@ -162,6 +185,8 @@ xt::xarray<uint8_t> *ChunkCache::get(uint64_t key)
 
 bool ChunkCache::has(uint64_t key)
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
     return _store.count(key);
 }
 
@@ -201,7 +226,7 @@ void readInterpolated3D(cv::Mat_<uint8_t> &out, z5::Dataset *ds, const cv::Mat_<
     
     auto retrieve_single_value_cached = [&cw,&ch,&cd,&mutex,&cache,&key_base,&ds](int ox, int oy, int oz) -> uint8_t
     {
-        xt::xarray<uint8_t> *chunk = nullptr;
+        ChunkCache::Chunk chunk;
         
         int ix = int(ox)/cw;
         int iy = int(oy)/ch;
@@ -238,7 +263,7 @@ void readInterpolated3D(cv::Mat_<uint8_t> &out, z5::Dataset *ds, const cv::Mat_<
     for(size_t y = 0;y<h;y++) {
         // xt::xarray<uint16_t> last_id;
         uint64_t last_key = -1;
-        xt::xarray<uint8_t> *chunk = nullptr;
+        ChunkCache::Chunk chunk;
         for(size_t x = 0;x<w;x++) {            
             float ox = coords(y,x)[2];
             float oy = coords(y,x)[1];
@@ -335,6 +360,328 @@ void readInterpolated3D(cv::Mat_<uint8_t> &out, z5::Dataset *ds, const cv::Mat_<
     }
 }
 
+std::vector<cv::Vec3i> chunksForCoords(z5::Dataset *ds, const cv::Mat_<cv::Vec3f> &coords, float scale)
+{
+    int cw = ds->chunking().blockShape()[0];
+    int ch = ds->chunking().blockShape()[1];
+    int cd = ds->chunking().blockShape()[2];
+    
+    std::vector<cv::Vec3i> ids;
+    std::unordered_set<uint64_t> seen;
+    
+    for(int j=0;j<coords.rows;j++)
+        for(int i=0;i<coords.cols;i++) {
+            cv::Vec3f p = coords(j,i)*scale;
+            
+            if (p[0] < 0 || p[1] < 0 || p[2] < 0)
+                continue;
+            
+            cv::Vec3i id = {int(p[2])/cw, int(p[1])/ch, int(p[0])/cd};
+            if (seen.insert(uint64_t(id[0]) ^ (uint64_t(id[1])<<16) ^ (uint64_t(id[2])<<32)).second)
+                ids.push_back(id);
+        }
+    
+    return ids;
+}
+
+bool prefetchChunk(z5::Dataset *ds, ChunkCache *cache, const cv::Vec3i &id)
+{
+    uint64_t key = cache->groupKey(ds->path()) ^ uint64_t(id[0]) ^ (uint64_t(id[1])<<16) ^ (uint64_t(id[2])<<32);
+    
+    if (cache->has(key))
+        return false;
+    
+    //a foreground read might have been faster, then our copy is dropped
+    cache->putIfAbsent(key, z5::multiarray::readChunk<uint8_t>(*ds, {size_t(id[0]),size_t(id[1]),size_t(id[2])}));
+    return true;
+}
+
+//trilinear sampling of single points through a shared ChunkCache, can be used from multiple threads at once
+class ChunkSampler
+{
+public:
+    ChunkSampler(z5::Dataset *ds, ChunkCache *cache) : _ds(ds), _cache(cache)
+    {
+        _key_base = cache->groupKey(ds->path());
+        _cw = ds->chunking().blockShape()[0];
+        _ch = ds->chunking().blockShape()[1];
+        _cd = ds->chunking().blockShape()[2];
+    }
+    
+    //p is in the same (z,y,x) order as the coords of readInterpolated3D(), last_key and chunk are a per thread lookup cache
+    float sample(const cv::Vec3f &p, uint64_t &last_key, ChunkCache::Chunk &chunk)
+    {
+        float ox = p[2];
+        float oy = p[1];
+        float oz = p[0];
+        
+        if (ox < 0 || oy < 0 || oz < 0)
+            return 0;
+        
+        int ix = int(ox)/_cw;
+        int iy = int(oy)/_ch;
+        int iz = int(oz)/_cd;
+        
+        uint64_t key = chunk_key(ix, iy, iz);
+        
+        if (key != last_key) {
+            last_key = key;
+            chunk = chunk_at(ix, iy, iz);
+        }
+        
+        if (!chunk)
+            return 0;
+        
+        int lx = ox-ix*_cw;
+        int ly = oy-iy*_ch;
+        int lz = oz-iz*_cd;
+        
+        float c000, c100, c010, c110, c001, c101, c011, c111;
+        
+        if (lx+1 >= _cw || ly+1 >= _ch || lz+1 >= _cd) {
+            c000 = chunk->operator()(lx,ly,lz);
+            c100 = value_at(ox+1,oy,oz);
+            c010 = value_at(ox,oy+1,oz);
+            c110 = value_at(ox+1,oy+1,oz);
+            c001 = value_at(ox,oy,oz+1);
+            c101 = value_at(ox+1,oy,oz+1);
+            c011 = value_at(ox,oy+1,oz+1);
+            c111 = value_at(ox+1,oy+1,oz+1);
+        }
+        else {
+            c000 = chunk->operator()(lx,ly,lz);
+            c100 = chunk->operator()(lx+1,ly,lz);
+            c010 = chunk->operator()(lx,ly+1,lz);
+            c110 = chunk->operator()(lx+1,ly+1,lz);
+            c001 = chunk->operator()(lx,ly,lz+1);
+            c101 = chunk->operator()(lx+1,ly,lz+1);
+            c011 = chunk->operator()(lx,ly+1,lz+1);
+            c111 = chunk->operator()(lx+1,ly+1,lz+1);
+        }
+        
+        float fx = ox-int(ox);
+        float fy = oy-int(oy);
+        float fz = oz-int(oz);
+        
+        float c00 = (1-fz)*c000 + fz*c001;
+        float c01 = (1-fz)*c010 + fz*c011;
+        float c10 = (1-fz)*c100 + fz*c101;
+        float c11 = (1-fz)*c110 + fz*c111;
+        
+        float c0 = (1-fy)*c00 + fy*c01;
+        float c1 = (1-fy)*c10 + fy*c11;
+        
+        return (1-fx)*c0 + fx*c1;
+    }
+    
+    //chunk id of a point in the same order as used for the cache keys
+    uint64_t chunk_order(const cv::Vec3f &p) const
+    {
+        if (p[0] < 0 || p[1] < 0 || p[2] < 0)
+            return -1;
+        return uint64_t(int(p[2])/_cw) | (uint64_t(int(p[1])/_ch)<<16) | (uint64_t(int(p[0])/_cd)<<32);
+    }
+    
+private:
+    uint64_t chunk_key(int ix, int iy, int iz) const
+    {
+        return _key_base ^ uint64_t(ix) ^ (uint64_t(iy)<<16) ^ (uint64_t(iz)<<32);
+    }
+    
+    ChunkCache::Chunk chunk_at(int ix, int iy, int iz)
+    {
+        uint64_t key = chunk_key(ix, iy, iz);
+        
+        if (_cache->has(key))
+            return _cache->get(key);
+        
+        //decompress without holding any lock, if another thread was faster we continue with its chunk
+        return _cache->putIfAbsent(key, z5::multiarray::readChunk<uint8_t>(*_ds, {size_t(ix),size_t(iy),size_t(iz)}));
+    }
+    
+    float value_at(int ox, int oy, int oz)
+    {
+        int ix = ox/_cw;
+        int iy = oy/_ch;
+        int iz = oz/_cd;
+        
+        ChunkCache::Chunk chunk = chunk_at(ix, iy, iz);
+        if (!chunk)
+            return 0;
+        
+        return chunk->operator()(ox-ix*_cw,oy-iy*_ch,oz-iz*_cd);
+    }
+    
+    z5::Dataset *_ds;
+    ChunkCache *_cache;
+    uint64_t _key_base;
+    int _cw, _ch, _cd;
+};
+
+//sample a whole stack of coordinate layers in one pass
+//the output is processed in tiles which are visited in chunk order and every tile samples all layers
+//at once, so a chunk is fetched (and decompressed) once for the whole stack instead of once per layer
+void readInterpolated3DLayers(std::vector<cv::Mat_<uint8_t>> &out, z5::Dataset *ds, const std::vector<cv::Mat_<cv::Vec3f>> &coords, ChunkCache *cache)
+{
+    out.resize(coords.size());
+    
+    if (coords.empty())
+        return;
+    
+    for(auto &layer : coords)
+        assert(layer.size() == coords[0].size());
+    
+    for(auto &layer : out)
+        layer = cv::Mat_<uint8_t>(coords[0].size(), 0);
+    
+    ChunkCache local_cache(1e9);
+    
+    if (!cache) {
+        std::cout << "WARNING should use a shared chunk cache!" << std::endl;
+        cache = &local_cache;
+    }
+    
+    ChunkSampler sampler(ds, cache);
+    
+    int w = coords[0].cols;
+    int h = coords[0].rows;
+    
+    //sort tiles by the chunk hit by their center on the middle layer
+    constexpr int TILE_SIZE = 32;
+    const cv::Mat_<cv::Vec3f> &mid = coords[coords.size()/2];
+    std::vector<std::pair<uint64_t,cv::Rect>> tiles;
+    for(int ty=0;ty<h;ty+=TILE_SIZE)
+        for(int tx=0;tx<w;tx+=TILE_SIZE) {
+            cv::Rect tile(tx, ty, std::min(TILE_SIZE, w-tx), std::min(TILE_SIZE, h-ty));
+            int cx = tile.x+tile.width/2;
+            int cy = tile.y+tile.height/2;
+            tiles.push_back({sampler.chunk_order(mid(cy,cx)), tile});
+        }
+    
+    std::stable_sort(tiles.begin(), tiles.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    
+#pragma omp parallel for schedule(dynamic)
+    for(size_t t=0;t<tiles.size();t++) {
+        const cv::Rect &tile = tiles[t].second;
+        uint64_t last_key = -1;
+        ChunkCache::Chunk chunk;
+        
+        for(size_t n=0;n<coords.size();n++) {
+            const cv::Mat_<cv::Vec3f> &layer_coords = coords[n];
+            cv::Mat_<uint8_t> &layer = out[n];
+            
+            for(int y=tile.y;y<tile.br().y;y++)
+                for(int x=tile.x;x<tile.br().x;x++)
+                    layer(y,x) = sampler.sample(layer_coords(y,x), last_key, chunk);
+        }
+    }
+}
+
+//front to back alpha compositing along the normals, fused into a single tiled pass
+//every tile marches its pixels through all offsets, the 7x7 gaussian used as opacity is computed separably on the
+//tile (plus apron) and pixels drop out once their transparency falls below min_transparent, a tile stops sampling
+//once all of its pixels did
+void alphaCompNormals(cv::Mat_<float> &integ_z, cv::Mat_<float> &transparent, z5::Dataset *ds, ChunkCache *cache, const cv::Mat_<cv::Vec3f> &coords, const cv::Mat_<cv::Vec3f> &normals, const std::vector<float> &offsets, float scale, float min_transparent, cv::Mat_<float> *integ, cv::Mat_<float> *integ_blur)
+{
+    assert(coords.size() == normals.size());
+    
+    integ_z.create(coords.size());
+    integ_z.setTo(0);
+    transparent.create(coords.size());
+    transparent.setTo(1);
+    if (integ) {
+        integ->create(coords.size());
+        integ->setTo(0);
+    }
+    if (integ_blur) {
+        integ_blur->create(coords.size());
+        integ_blur->setTo(0);
+    }
+    
+    ChunkCache local_cache(1e9);
+    
+    if (!cache) {
+        std::cout << "WARNING should use a shared chunk cache!" << std::endl;
+        cache = &local_cache;
+    }
+    
+    ChunkSampler sampler(ds, cache);
+    
+    int w = coords.cols;
+    int h = coords.rows;
+    
+    //same kernel as cv::GaussianBlur(src, dst, {7,7}, 0)
+    constexpr int R = 3;
+    constexpr int TILE_SIZE = 64;
+    cv::Mat_<float> kernel = cv::getGaussianKernel(2*R+1, 0, CV_32F);
+    
+    int tiles_x = (w+TILE_SIZE-1)/TILE_SIZE;
+    int tiles_y = (h+TILE_SIZE-1)/TILE_SIZE;
+    
+#pragma omp parallel for schedule(dynamic) collapse(2)
+    for(int ty=0;ty<tiles_y;ty++)
+        for(int tx=0;tx<tiles_x;tx++) {
+            cv::Rect tile(tx*TILE_SIZE, ty*TILE_SIZE, std::min(TILE_SIZE, w-tx*TILE_SIZE), std::min(TILE_SIZE, h-ty*TILE_SIZE));
+            
+            //apron pixels are mirrored at the image border like BORDER_REFLECT_101 in cv::GaussianBlur
+            std::vector<int> ys(tile.height+2*R), xs(tile.width+2*R);
+            for(int j=0;j<ys.size();j++)
+                ys[j] = cv::borderInterpolate(tile.y-R+j, h, cv::BORDER_REFLECT_101);
+            for(int i=0;i<xs.size();i++)
+                xs[i] = cv::borderInterpolate(tile.x-R+i, w, cv::BORDER_REFLECT_101);
+            
+            cv::Mat_<float> raw(ys.size(), xs.size());
+            cv::Mat_<float> blur_x(ys.size(), tile.width);
+            
+            int active = tile.area();
+            uint64_t last_key = -1;
+            ChunkCache::Chunk chunk;
+            
+            for(int n=0;n<offsets.size() && active;n++) {
+                float off = offsets[n];
+                
+                for(int j=0;j<ys.size();j++)
+                    for(int i=0;i<xs.size();i++)
+                        raw(j,i) = uint8_t(sampler.sample((coords(ys[j],xs[i])+normals(ys[j],xs[i])*off)*scale, last_key, chunk))*(1/255.0f);
+                
+                for(int j=0;j<ys.size();j++)
+                    for(int i=0;i<tile.width;i++) {
+                        float sum = 0;
+                        for(int k=0;k<=2*R;k++)
+                            sum += kernel(k)*raw(j,i+k);
+                        blur_x(j,i) = sum;
+                    }
+                
+                for(int j=0;j<tile.height;j++)
+                    for(int i=0;i<tile.width;i++) {
+                        int y = tile.y+j;
+                        int x = tile.x+i;
+                        float &t = transparent(y,x);
+                        
+                        if (t < min_transparent)
+                            continue;
+                        
+                        float blur = 0;
+                        for(int k=0;k<=2*R;k++)
+                            blur += kernel(k)*blur_x(j+k,i);
+                        
+                        float opaq = std::min(std::max(blur,0.0f),1.0f);
+                        float joint = t*opaq;
+                        
+                        integ_z(y,x) += joint*off;
+                        if (integ)
+                            (*integ)(y,x) += joint*raw(j+R,i+R);
+                        if (integ_blur)
+                            (*integ_blur)(y,x) += joint*blur;
+                        
+                        t -= joint;
+                        if (t < min_transparent)
+                            active--;
+                    }
+            }
+        }
+}
+
 void readInterpolated3D_plain(xt::xarray<uint8_t> &out, z5::Dataset *ds, const xt::xarray<float> &coords)
 {
     // auto dims = xt::range(_,coords.shape().size()-2);
@@ -482,7 +829,7 @@ void readInterpolated3D_a2(xt::xarray<uint8_t> &out, z5::Dataset *ds, const xt::
     for(size_t y = 0;y<coords.shape(ydim);y++) {
         // xt::xarray<uint16_t> last_id;
         uint64_t last_key = -1;
-        xt::xarray<uint8_t> *chunk = nullptr;
+        ChunkCache::Chunk chunk;
         for(size_t x = 0;x<coords.shape(xdim);x++) {            
             float ox = coords(y,x,0);
             float oy = coords(y,x,1);
@@ -554,7 +901,7 @@ void readInterpolated3D_a2_trilin(xt::xarray<uint8_t> &out, z5::Dataset *ds, con
 
     auto retrieve_single_value_cached = [&cw,&ch,&cd,&mutex,&cache,&key_base,&ds](int ox, int oy, int oz) -> uint8_t
     {
-        xt::xarray<uint8_t> *chunk = nullptr;
+        ChunkCache::Chunk chunk;
 
         int ix = int(ox)/cw;
         int iy = int(oy)/ch;
@@ -592,7 +939,7 @@ void readInterpolated3D_a2_trilin(xt::xarray<uint8_t> &out, z5::Dataset *ds, con
     for(size_t y = 0;y<coords.shape(ydim);y++) {
         // xt::xarray<uint16_t> last_id;
         uint64_t last_key = -1;
-        xt::xarray<uint8_t> *chunk = nullptr;
+        ChunkCache::Chunk chunk;
         for(size_t x = 0;x<coords.shape(xdim);x++) {            
             float ox = coords(y,x,0);
             float oy = coords(y,x,1);
@@ -0,0 +1,385 @@
+#include "vc/core/math/StructureTensorField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "z5/attributes.hxx"
+#include "z5/dataset.hxx"
+#include "z5/factory.hxx"
+#include "z5/filesystem/handle.hxx"
+
+using namespace volcart;
+namespace fs = volcart::filesystem;
+
+namespace
+{
+// Name of the zarr array which holds a persisted field
+const std::string ZARR_DATASET_NAME = "structure_tensor";
+
+// Pack a block index into a cache key
+auto BlockKey(int bx, int by, int bz) -> std::uint64_t
+{
+    return (static_cast<std::uint64_t>(bz) << 42) |
+           (static_cast<std::uint64_t>(by) << 21) |
+           static_cast<std::uint64_t>(bx);
+}
+
+// 1D derivative and smoothing kernels of the gradient operator used by
+// ComputeSubvoxelStructureTensor(): Scharr for size 3, otherwise Sobel
+void GradientKernels(int kernelSize, cv::Mat& deriv, cv::Mat& smooth)
+{
+    auto ksize = (kernelSize == 3) ? int(cv::FILTER_SCHARR) : kernelSize;
+    cv::getDerivKernels(deriv, smooth, 1, 0, ksize, false, CV_32F);
+}
+
+// out = sum_k kernel[k] * planes[first + k]
+void AccumulateZ(
+    const std::vector<cv::Mat>& planes,
+    std::size_t first,
+    const cv::Mat& kernel,
+    cv::Mat& out)
+{
+    out = cv::Mat::zeros(planes[first].size(), CV_32F);
+    for (std::size_t k = 0; k < kernel.total(); ++k) {
+        auto w = kernel.at<float>(static_cast<int>(k));
+        if (w != 0) {
+            cv::scaleAdd(planes[first + k], w, out, out);
+        }
+    }
+}
+
+auto ToStructureTensor(const cv::Vec6f& t) -> StructureTensor
+{
+    // clang-format off
+    return StructureTensor{t[0], t[1], t[2],
+                           t[1], t[3], t[4],
+                           t[2], t[4], t[5]};
+    // clang-format on
+}
+}  // namespace
+
+StructureTensorField::StructureTensorField(
+    Volume::Pointer volume, int radius, int kernelSize, int blockSize)
+    : vol_{std::move(volume)}
+    , radius_{radius}
+    , kernelSize_{kernelSize}
+    , blockSize_{blockSize}
+{
+    if (kernelSize != 3 && kernelSize != 5 && kernelSize != 7) {
+        throw std::invalid_argument("gradient kernel size must be 3, 5, or 7");
+    }
+    if (radius < 0) {
+        throw std::invalid_argument("radius must be non-negative");
+    }
+    if (blockSize <= 0) {
+        throw std::invalid_argument("block size must be positive");
+    }
+    setMemoryBudget(DEFAULT_MEMORY_BUDGET);
+}
+
+auto StructureTensorField::New(
+    Volume::Pointer volume, int radius, int kernelSize, int blockSize)
+    -> Pointer
+{
+    return std::make_shared<StructureTensorField>(
+        std::move(volume), radius, kernelSize, blockSize);
+}
+
+StructureTensorField::~StructureTensorField() = default;
+
+void StructureTensorField::setMemoryBudget(std::size_t bytes)
+{
+    auto blockBytes = static_cast<std::size_t>(blockSize_) * blockSize_ *
+                      blockSize_ * sizeof(Tensor);
+    cache_.setCapacity(std::max<std::size_t>(1, bytes / blockBytes));
+}
+
+auto StructureTensorField::memoryBudget() const -> std::size_t
+{
+    return cache_.capacity() * static_cast<std::size_t>(blockSize_) *
+           blockSize_ * blockSize_ * sizeof(Tensor);
+}
+
+void StructureTensorField::setCachePath(const fs::path& path)
+{
+    const auto b = static_cast<std::size_t>(blockSize_);
+    const z5::types::ShapeType shape{
+        static_cast<std::size_t>(vol_->numSlices()),
+        static_cast<std::size_t>(vol_->sliceHeight()),
+        static_cast<std::size_t>(vol_->sliceWidth()), 6};
+
+    z5::filesystem::handle::File f(path);
+    if (!f.exists()) {
+        z5::createFile(f, true);
+    }
+
+    z5::filesystem::handle::Dataset dsHandle(f, ZARR_DATASET_NAME, "/");
+    if (dsHandle.exists()) {
+        nlohmann::json attrs;
+        z5::readAttributes(dsHandle, attrs);
+        auto ds = z5::filesystem::openDataset(dsHandle);
+        if (attrs.value("radius", -1) != radius_ ||
+            attrs.value("kernelSize", -1) != kernelSize_ ||
+            attrs.value("blockSize", -1) != blockSize_ ||
+            ds->shape() != shape) {
+            throw std::runtime_error(
+                "structure tensor field at " + path.string() +
+                " does not match the requested parameters");
+        }
+        zarrDs_ = std::move(ds);
+        return;
+    }
+
+    nlohmann::json compOptions = {
+        {"blocksize", 0}, {"level", 5}, {"codec", "zstd"}, {"shuffle", 2}};
+    zarrDs_ = z5::createDataset(
+        f, ZARR_DATASET_NAME, "float32", shape, {b, b, b, 6}, "blosc",
+        compOptions);
+    nlohmann::json attrs = {
+        {"radius", radius_},
+        {"kernelSize", kernelSize_},
+        {"blockSize", blockSize_}};
+    z5::writeAttributes(dsHandle, attrs);
+}
+
+void StructureTensorField::purge() { cache_.purge(); }
+
+auto StructureTensorField::structureTensorAt(int x, int y, int z)
+    -> StructureTensor
+{
+    if (!vol_->isInBounds(x, y, z)) {
+        return ZERO_STRUCTURE_TENSOR;
+    }
+    const auto b = blockSize_;
+    return ToStructureTensor(
+        voxel_(block_(x / b, y / b, z / b), x % b, y % b, z % b));
+}
+
+auto StructureTensorField::structureTensorAt(const cv::Vec3d& v)
+    -> StructureTensor
+{
+    if (!vol_->isInBounds(v)) {
+        return ZERO_STRUCTURE_TENSOR;
+    }
+
+    double intPart;
+    auto dx = static_cast<float>(std::modf(v[0], &intPart));
+    auto x0 = static_cast<int>(intPart);
+    auto dy = static_cast<float>(std::modf(v[1], &intPart));
+    auto y0 = static_cast<int>(intPart);
+    auto dz = static_cast<float>(std::modf(v[2], &intPart));
+    auto z0 = static_cast<int>(intPart);
+
+    // Corners in (x, y, z) bit order. Most positions have all eight corners
+    // in a single block, in which case the cache is only consulted once.
+    const auto b = blockSize_;
+    std::array<Tensor, 8> c;
+    if (x0 % b != b - 1 && y0 % b != b - 1 && z0 % b != b - 1) {
+        auto block = block_(x0 / b, y0 / b, z0 / b);
+        for (int i = 0; i < 8; ++i) {
+            c[i] = voxel_(
+                block, x0 % b + (i & 1), y0 % b + ((i >> 1) & 1),
+                z0 % b + ((i >> 2) & 1));
+        }
+    } else {
+        for (int i = 0; i < 8; ++i) {
+            auto x = x0 + (i & 1);
+            auto y = y0 + ((i >> 1) & 1);
+            auto z = z0 + ((i >> 2) & 1);
+            c[i] = voxel_(block_(x / b, y / b, z / b), x % b, y % b, z % b);
+        }
+    }
+
+    auto c00 = c[0] * (1 - dx) + c[1] * dx;
+    auto c10 = c[2] * (1 - dx) + c[3] * dx;
+    auto c01 = c[4] * (1 - dx) + c[5] * dx;
+    auto c11 = c[6] * (1 - dx) + c[7] * dx;
+    auto c0 = c00 * (1 - dy) + c10 * dy;
+    auto c1 = c01 * (1 - dy) + c11 * dy;
+    return ToStructureTensor(c0 * (1 - dz) + c1 * dz);
+}
+
+auto StructureTensorField::eigenPairsAt(const cv::Vec3d& v) -> EigenPairs
+{
+    return ComputeEigenPairs(structureTensorAt(v));
+}
+
+auto StructureTensorField::block_(int bx, int by, int bz) -> Block
+{
+    auto key = BlockKey(bx, by, bz);
+    if (cache_.contains(key)) {
+        try {
+            return cache_.get(key);
+        } catch (const std::invalid_argument&) {
+            // Evicted since the check, fall through and rebuild it
+        }
+    }
+
+    // Only one thread builds a given block. Others wait for it here and then
+    // find it in the cache.
+    std::lock_guard<std::mutex> lock(blockMutexes_[key % NUM_BLOCK_MUTEXES]);
+    if (cache_.contains(key)) {
+        try {
+            return cache_.get(key);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    auto block = read_block_(bx, by, bz);
+    if (!block) {
+        block = compute_block_(bx, by, bz);
+        write_block_(bx, by, bz, block);
+    }
+    cache_.put(key, block);
+    return block;
+}
+
+auto StructureTensorField::compute_block_(int bx, int by, int bz) const
+    -> Block
+{
+    const auto b = blockSize_;
+    const auto kh = kernelSize_ / 2;
+    // Voxels needed per axis: the block, the window, and the gradient kernel
+    const auto margin = radius_ + kh;
+    const auto loaded = b + 2 * margin;
+    // Gradients needed per axis: the block and the window
+    const auto gradSize = b + 2 * radius_;
+
+    // Load the neighborhood, zero outside of the volume like intensityAt()
+    const cv::Rect region{bx * b - margin, by * b - margin, loaded, loaded};
+    const auto valid =
+        region & cv::Rect{0, 0, vol_->sliceWidth(), vol_->sliceHeight()};
+    std::vector<cv::Mat> voxels(loaded);
+    for (int z = 0; z < loaded; ++z) {
+        voxels[z] = cv::Mat::zeros(loaded, loaded, CV_32F);
+        auto sliceIdx = bz * b - margin + z;
+        if (sliceIdx < 0 || sliceIdx >= vol_->numSlices() || valid.empty()) {
+            continue;
+        }
+        cv::Mat roi = voxels[z](valid - region.tl());
+        vol_->getSliceData(sliceIdx)(valid).convertTo(roi, CV_32F);
+    }
+
+    // Separable gradient operators, matching VolumeGradient(): X and Y
+    // derivatives are smoothed in-plane, Z derivatives are smoothed along X
+    cv::Mat deriv, smooth;
+    GradientKernels(kernelSize_, deriv, smooth);
+    const cv::Mat identity = cv::Mat::ones(1, 1, CV_32F);
+    const cv::Point anchor{-1, -1};
+
+    std::vector<cv::Mat> smoothX(loaded);
+    for (int z = 0; z < loaded; ++z) {
+        cv::sepFilter2D(
+            voxels[z], smoothX[z], CV_32F, smooth, identity, anchor, 0,
+            cv::BORDER_REPLICATE);
+    }
+
+    // Per-voxel tensor products over the gradient region
+    const cv::Rect gradRect{kh, kh, gradSize, gradSize};
+    std::array<std::vector<cv::Mat>, 6> products;
+    for (auto& p : products) {
+        p.resize(gradSize);
+    }
+    cv::Mat tmp;
+    for (int g = 0; g < gradSize; ++g) {
+        cv::sepFilter2D(
+            voxels[g + kh], tmp, CV_32F, deriv, smooth, anchor, 0,
+            cv::BORDER_REPLICATE);
+        cv::Mat ix = tmp(gradRect).clone();
+        cv::sepFilter2D(
+            voxels[g + kh], tmp, CV_32F, smooth, deriv, anchor, 0,
+            cv::BORDER_REPLICATE);
+        cv::Mat iy = tmp(gradRect).clone();
+        AccumulateZ(smoothX, g, deriv, tmp);
+        cv::Mat iz = tmp(gradRect).clone();
+
+        cv::multiply(ix, ix, products[0][g]);
+        cv::multiply(ix, iy, products[1][g]);
+        cv::multiply(ix, iz, products[2][g]);
+        cv::multiply(iy, iy, products[3][g]);
+        cv::multiply(iy, iz, products[4][g]);
+        cv::multiply(iz, iz, products[5][g]);
+    }
+
+    // Separable Gaussian window, normalized like MakeUniformGaussianField()
+    // and averaged over the window like ComputeSubvoxelStructureTensor()
+    const auto side = 2 * radius_ + 1;
+    cv::Mat gauss(side, 1, CV_32F);
+    double gaussSum = 0;
+    for (int k = 0; k < side; ++k) {
+        auto val = std::exp(-double((k - radius_) * (k - radius_)));
+        gauss.at<float>(k) = static_cast<float>(val);
+        gaussSum += val;
+    }
+    const double n = 1 / std::pow(2 * M_PI, 3.0 / 2.0);
+    const auto scale =
+        n / (gaussSum * gaussSum * gaussSum * side * side * side);
+
+    const cv::Rect blockRect{radius_, radius_, b, b};
+    std::array<std::vector<cv::Mat>, 6> windowed;
+    for (std::size_t c = 0; c < 6; ++c) {
+        windowed[c].resize(gradSize);
+        for (int g = 0; g < gradSize; ++g) {
+            cv::sepFilter2D(
+                products[c][g], tmp, CV_32F, gauss, gauss, anchor, 0,
+                cv::BORDER_REPLICATE);
+            windowed[c][g] = tmp(blockRect).clone();
+        }
+    }
+
+    auto block = std::make_shared<std::vector<Tensor>>(
+        static_cast<std::size_t>(b) * b * b);
+    std::array<cv::Mat, 6> channels;
+    for (int z = 0; z < b; ++z) {
+        for (std::size_t c = 0; c < 6; ++c) {
+            AccumulateZ(windowed[c], z, gauss, channels[c]);
+            channels[c] *= scale;
+        }
+        cv::Mat dst(
+            b, b, CV_32FC(6),
+            block->data() + static_cast<std::size_t>(z) * b * b);
+        cv::merge(channels.data(), channels.size(), dst);
+    }
+
+    return block;
+}
+
+auto StructureTensorField::read_block_(int bx, int by, int bz) const -> Block
+{
+    if (!zarrDs_) {
+        return nullptr;
+    }
+
+    const z5::types::ShapeType id{
+        static_cast<std::size_t>(bz), static_cast<std::size_t>(by),
+        static_cast<std::size_t>(bx), 0};
+    const auto b = blockSize_;
+    if (bx * b >= vol_->sliceWidth() || by * b >= vol_->sliceHeight() ||
+        bz * b >= vol_->numSlices() || !zarrDs_->chunkExists(id)) {
+        return nullptr;
+    }
+
+    auto block = std::make_shared<std::vector<Tensor>>(
+        static_cast<std::size_t>(b) * b * b);
+    zarrDs_->readChunk(id, block->data());
+    return block;
+}
+
+void StructureTensorField::write_block_(
+    int bx, int by, int bz, const Block& block) const
+{
+    const auto b = blockSize_;
+    if (!zarrDs_ || bx * b >= vol_->sliceWidth() ||
+        by * b >= vol_->sliceHeight() || bz * b >= vol_->numSlices()) {
+        return;
+    }
+
+    const z5::types::ShapeType id{
+        static_cast<std::size_t>(bz), static_cast<std::size_t>(by),
+        static_cast<std::size_t>(bx), 0};
+    zarrDs_->writeChunk(id, block->data());
+}
@@ -10,6 +10,20 @@
 //TODO remove
 #include <opencv2/highgui.hpp>
 
+#include <nlohmann/json.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
 #include <unordered_map>
 
 cv::Vec2f offsetPoint2d(TrivialSurfacePointer *ptr, const cv::Vec3f &offset)
@@ -486,6 +500,182 @@ static float search_min_loc(const cv::Mat_<cv::Vec3f> &points, cv::Vec2f &loc, c
     return sqrt(best);
 }
 
+GridBoundsTree::GridBoundsTree(const cv::Mat_<cv::Vec3f> &points, int patch_size)
+{
+    _patch_size = patch_size;
+    _grid_size = points.size();
+    
+    Level base;
+    base.w = std::max(1, (points.cols-1+patch_size-1)/patch_size);
+    base.h = std::max(1, (points.rows-1+patch_size-1)/patch_size);
+    base.lo.resize(base.w*base.h, {FLT_MAX,FLT_MAX,FLT_MAX});
+    base.hi.resize(base.w*base.h, {-FLT_MAX,-FLT_MAX,-FLT_MAX});
+    
+#pragma omp parallel for
+    for(int py=0;py<base.h;py++)
+        for(int px=0;px<base.w;px++) {
+            cv::Vec3f &lo = base.lo[py*base.w+px];
+            cv::Vec3f &hi = base.hi[py*base.w+px];
+            //neighbouring patches share their border points so the boxes cover the quads in between
+            for(int j=py*patch_size;j<=std::min((py+1)*patch_size,points.rows-1);j++)
+                for(int i=px*patch_size;i<=std::min((px+1)*patch_size,points.cols-1);i++) {
+                    const cv::Vec3f &p = points(j,i);
+                    if (p[0] == -1)
+                        continue;
+                    for(int c=0;c<3;c++) {
+                        lo[c] = std::min(lo[c],p[c]);
+                        hi[c] = std::max(hi[c],p[c]);
+                    }
+                }
+        }
+    _levels.push_back(base);
+    
+    while (_levels.back().w > 1 || _levels.back().h > 1) {
+        const Level &src = _levels.back();
+        Level dst;
+        dst.w = (src.w+1)/2;
+        dst.h = (src.h+1)/2;
+        dst.lo.resize(dst.w*dst.h, {FLT_MAX,FLT_MAX,FLT_MAX});
+        dst.hi.resize(dst.w*dst.h, {-FLT_MAX,-FLT_MAX,-FLT_MAX});
+        
+        for(int y=0;y<src.h;y++)
+            for(int x=0;x<src.w;x++)
+                for(int c=0;c<3;c++) {
+                    dst.lo[y/2*dst.w+x/2][c] = std::min(dst.lo[y/2*dst.w+x/2][c], src.lo[y*src.w+x][c]);
+                    dst.hi[y/2*dst.w+x/2][c] = std::max(dst.hi[y/2*dst.w+x/2][c], src.hi[y*src.w+x][c]);
+                }
+        
+        _levels.push_back(dst);
+    }
+}
+
+bool GridBoundsTree::valid(int level, int x, int y) const
+{
+    const Level &l = _levels[level];
+    if (x >= l.w || y >= l.h)
+        return false;
+    
+    return l.lo[y*l.w+x][0] <= l.hi[y*l.w+x][0];
+}
+
+cv::Rect GridBoundsTree::patchRect(int level, int x, int y) const
+{
+    int size = _patch_size << level;
+    cv::Rect patch(x*size, y*size, size, size);
+    
+    return patch & cv::Rect(0, 0, _grid_size.width-1, _grid_size.height-1);
+}
+
+static bool box_in_roi(PlaneSurface *plane, const cv::Vec3f &lo, const cv::Vec3f &hi, const cv::Rect &roi)
+{
+    cv::Vec2f min = {FLT_MAX,FLT_MAX};
+    cv::Vec2f max = {-FLT_MAX,-FLT_MAX};
+    
+    for(int i=0;i<8;i++) {
+        cv::Vec3f corner = {i & 1 ? hi[0] : lo[0], i & 2 ? hi[1] : lo[1], i & 4 ? hi[2] : lo[2]};
+        cv::Vec3f p = plane->project(corner);
+        for(int c=0;c<2;c++) {
+            min[c] = std::min(min[c],p[c]);
+            max[c] = std::max(max[c],p[c]);
+        }
+    }
+    
+    return max[0] >= roi.x && min[0] <= roi.br().x && max[1] >= roi.y && min[1] <= roi.br().y;
+}
+
+std::vector<cv::Rect> GridBoundsTree::planePatches(PlaneSurface *plane, float dist, const cv::Rect &plane_roi) const
+{
+    std::vector<cv::Rect> patches;
+    cv::Vec3f n = plane->normal(nullptr);
+    
+    std::vector<cv::Vec3i> stack = {{int(_levels.size())-1,0,0}};
+    while (stack.size()) {
+        cv::Vec3i node = stack.back();
+        stack.pop_back();
+        int l = node[0];
+        if (!valid(l, node[1], node[2]))
+            continue;
+        
+        const cv::Vec3f &lo = _levels[l].lo[node[2]*_levels[l].w+node[1]];
+        const cv::Vec3f &hi = _levels[l].hi[node[2]*_levels[l].w+node[1]];
+        
+        //box extent along the normal vs distance of the box center
+        cv::Vec3f e = 0.5*(hi-lo);
+        float r = e[0]*std::abs(n[0]) + e[1]*std::abs(n[1]) + e[2]*std::abs(n[2]);
+        if (std::abs(plane->scalarp(0.5*(lo+hi))) > r+dist)
+            continue;
+        
+        if (!plane_roi.empty() && !box_in_roi(plane, lo, hi, plane_roi))
+            continue;
+        
+        if (!l)
+            patches.push_back(patchRect(0, node[1], node[2]));
+        else
+            for(int j=0;j<2;j++)
+                for(int i=0;i<2;i++)
+                    stack.push_back({l-1, 2*node[1]+i, 2*node[2]+j});
+    }
+    
+    return patches;
+}
+
+void GridBoundsTree::visitNearest(const cv::Vec3f &tgt, const std::function<float(const cv::Rect &patch, float lower_bound)> &visit) const
+{
+    struct Node {
+        float lower_bound;
+        int level, x, y;
+        bool operator<(const Node &o) const { return lower_bound > o.lower_bound; }
+    };
+    
+    std::priority_queue<Node> queue;
+    auto push = [&](int l, int x, int y) {
+        if (!valid(l, x, y))
+            return;
+        const cv::Vec3f &lo = _levels[l].lo[y*_levels[l].w+x];
+        const cv::Vec3f &hi = _levels[l].hi[y*_levels[l].w+x];
+        float sd = 0;
+        for(int c=0;c<3;c++) {
+            float d = std::max({lo[c]-tgt[c], 0.0f, tgt[c]-hi[c]});
+            sd += d*d;
+        }
+        queue.push({sqrtf(sd), l, x, y});
+    };
+    
+    push(_levels.size()-1, 0, 0);
+    
+    float best = FLT_MAX;
+    while (!queue.empty()) {
+        Node node = queue.top();
+        queue.pop();
+        
+        if (node.lower_bound >= best)
+            break;
+        
+        if (!node.level)
+            best = visit(patchRect(0, node.x, node.y), node.lower_bound);
+        else
+            for(int j=0;j<2;j++)
+                for(int i=0;i<2;i++)
+                    push(node.level-1, 2*node.x+i, 2*node.y+j);
+    }
+}
+
+std::shared_ptr<const GridBoundsTree> QuadSurface::boundsTree()
+{
+    std::lock_guard<std::mutex> lock(_bounds_tree_mutex);
+    if (!_bounds_tree)
+        _bounds_tree = std::make_shared<GridBoundsTree>(_points);
+    
+    return _bounds_tree;
+}
+
+std::shared_ptr<const cv::Mat_<cv::Vec3f>> QuadSurface::sharedPoints() const
+{
+    //the header copy holds a reference on heap grids, the deleter keeps a vcqs mapping alive
+    std::shared_ptr<void> mapping = _mapping;
+    return std::shared_ptr<const cv::Mat_<cv::Vec3f>>(new cv::Mat_<cv::Vec3f>(_points), [mapping](const cv::Mat_<cv::Vec3f> *p) { delete p; });
+}
+
 //search the surface point that is closest to th tgt coord
 float QuadSurface::pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th, int max_iters)
 {
@@ -496,8 +686,6 @@ float QuadSurface::pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th,
     cv::Vec3f _out;
     
     cv::Vec2f step_small = {std::max(1.0f,_scale[0]),std::max(1.0f,_scale[1])};
-    float min_mul = std::min(0.1*_points.cols/_scale[0],0.1*_points.rows/_scale[1]);
-    cv::Vec2f step_large = {min_mul*_scale[0],min_mul*_scale[1]};
 
     float dist = search_min_loc(_points, loc, _out, tgt, step_small, _scale[0]*0.01);
     
@@ -511,20 +699,30 @@ float QuadSurface::pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th,
     if (min_dist < 0)
         min_dist = 10*(_points.cols/_scale[0]+_points.rows/_scale[1]);
     
-    //FIXME is this excessive?
-    for(int r=0;r<max_iters;r++) {
-        loc = {1 + (rand() % _points.cols-3), 1 + (rand() % _points.rows-3)};
+    //restart from the patches which may contain closer points, nearest first, until none can beat the best
+    int iters = 0;
+    boundsTree()->visitNearest(tgt, [&](const cv::Rect &patch, float lower_bound) {
+        if (iters++ >= max_iters)
+            return 0.0f;
+        
+        cv::Vec2f patch_loc = {patch.x+0.5f*patch.width, patch.y+0.5f*patch.height};
+        patch_loc[0] = std::clamp<float>(patch_loc[0], 1, _points.cols-2);
+        patch_loc[1] = std::clamp<float>(patch_loc[1], 1, _points.rows-2);
+        cv::Vec2f step = {std::max(1.0f,0.25f*patch.width),std::max(1.0f,0.25f*patch.height)};
         
-        float dist = search_min_loc(_points, loc, _out, tgt, step_large, _scale[0]*0.01);
+        float dist = search_min_loc(_points, patch_loc, _out, tgt, step, _scale[0]*0.01);
         
-        if (dist < th && dist >= 0) {
-            tgt_ptr->loc = cv::Vec3f(loc[0],loc[1],0) - cv::Vec3f(_center[0]*_scale[0],_center[1]*_scale[1],0);
-            return dist;
-        } else if (dist >= 0 && dist < min_dist) {
-            min_loc = loc;
+        if (dist >= 0 && dist < min_dist) {
+            min_loc = patch_loc;
             min_dist = dist;
         }
-    }
+        
+        //good enough, stop the traversal
+        if (min_dist < th)
+            return 0.0f;
+        
+        return min_dist;
+    });
     
     tgt_ptr->loc = cv::Vec3f(min_loc[0],min_loc[1],0) - cv::Vec3f(_center[0]*_scale[0],_center[1]*_scale[1],0);
     return min_dist;
@@ -545,6 +743,126 @@ QuadSurface *load_quad_from_vcps(const std::string &path)
     return new QuadSurface(points, {sx,sy});
 }
 
+//file layout: magic, uint64 header length, json header padded with spaces, float32 xyz grid (row major)
+//the grid starts at data_offset which is page aligned
+static const char VCQS_MAGIC[8] = {'V','C','Q','S','0','0','0','1'};
+static const size_t VCQS_ALIGN = 4096;
+
+QuadSurface *load_quad_from_vcqs(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "ERROR could not open " << path << std::endl;
+        return nullptr;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        close(fd);
+        std::cerr << "ERROR could not stat " << path << std::endl;
+        return nullptr;
+    }
+    size_t size = sb.st_size;
+    
+    //private mapping: pages are only copied if someone writes to _points, the file stays untouched
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "ERROR could not mmap " << path << std::endl;
+        return nullptr;
+    }
+    std::shared_ptr<void> mapping(data, [size](void *p) { munmap(p, size); });
+    
+    const char *bytes = static_cast<const char*>(data);
+    uint64_t header_len;
+    if (size < sizeof(VCQS_MAGIC)+sizeof(header_len) || memcmp(bytes, VCQS_MAGIC, sizeof(VCQS_MAGIC))) {
+        std::cerr << "ERROR not a vcqs file " << path << std::endl;
+        return nullptr;
+    }
+    memcpy(&header_len, bytes+sizeof(VCQS_MAGIC), sizeof(header_len));
+    const char *header_start = bytes+sizeof(VCQS_MAGIC)+sizeof(header_len);
+    if (header_start+header_len > bytes+size) {
+        std::cerr << "ERROR truncated vcqs header " << path << std::endl;
+        return nullptr;
+    }
+    
+    int w, h;
+    size_t data_offset;
+    cv::Vec2f scale;
+    try {
+        nlohmann::json header = nlohmann::json::parse(header_start, header_start+header_len);
+        if (header["dtype"].get<std::string>() != "<f4") {
+            std::cerr << "ERROR unsupported vcqs dtype " << header["dtype"] << " in " << path << std::endl;
+            return nullptr;
+        }
+        w = header["width"].get<int>();
+        h = header["height"].get<int>();
+        data_offset = header["data_offset"].get<size_t>();
+        scale = {header["scale"][0].get<float>(), header["scale"][1].get<float>()};
+    }
+    catch (const nlohmann::json::exception &e) {
+        std::cerr << "ERROR invalid vcqs header in " << path << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+    
+    if (w < 2 || h < 2 || data_offset % sizeof(float) || data_offset+size_t(w)*h*sizeof(cv::Vec3f) > size) {
+        std::cerr << "ERROR vcqs grid does not match file size " << path << std::endl;
+        return nullptr;
+    }
+    
+    QuadSurface *surf = new QuadSurface();
+    surf->_points = cv::Mat_<cv::Vec3f>(h, w, reinterpret_cast<cv::Vec3f*>(static_cast<char*>(data)+data_offset));
+    surf->_mapping = mapping;
+    surf->_bounds = {0,0,w-1,h-1};
+    surf->_scale = scale;
+    surf->_center = {w/2.0f/scale[0],h/2.0f/scale[1],0};
+    
+    return surf;
+}
+
+bool write_quad_to_vcqs(QuadSurface *surf, const std::string &path)
+{
+    const cv::Mat_<cv::Vec3f> &points = surf->_points;
+    
+    cv::Vec3f lo = {FLT_MAX,FLT_MAX,FLT_MAX};
+    cv::Vec3f hi = {-FLT_MAX,-FLT_MAX,-FLT_MAX};
+    for(int j=0;j<points.rows;j++)
+        for(int i=0;i<points.cols;i++) {
+            const cv::Vec3f &p = points(j,i);
+            if (p[0] == -1)
+                continue;
+            for(int c=0;c<3;c++) {
+                lo[c] = std::min(lo[c],p[c]);
+                hi[c] = std::max(hi[c],p[c]);
+            }
+        }
+    
+    nlohmann::json header;
+    header["version"] = 1;
+    header["dtype"] = "<f4";
+    header["width"] = points.cols;
+    header["height"] = points.rows;
+    header["scale"] = {surf->_scale[0], surf->_scale[1]};
+    header["bbox"] = {{lo[0],lo[1],lo[2]},{hi[0],hi[1],hi[2]}};
+    header["data_offset"] = 0;
+    
+    //reserve room for the offset digits, then pad the header up to the aligned grid start
+    size_t prefix = sizeof(VCQS_MAGIC)+sizeof(uint64_t);
+    size_t data_offset = (prefix+header.dump().size()+32+VCQS_ALIGN-1)/VCQS_ALIGN*VCQS_ALIGN;
+    header["data_offset"] = data_offset;
+    std::string header_str = header.dump();
+    header_str.resize(data_offset-prefix, ' ');
+    uint64_t header_len = header_str.size();
+    
+    std::ofstream out(path, std::ios::binary);
+    out.write(VCQS_MAGIC, sizeof(VCQS_MAGIC));
+    out.write(reinterpret_cast<const char*>(&header_len), sizeof(header_len));
+    out.write(header_str.data(), header_str.size());
+    for(int j=0;j<points.rows;j++)
+        out.write(reinterpret_cast<const char*>(points.ptr(j)), points.cols*sizeof(cv::Vec3f));
+    
+    return out.good();
+}
+
 bool face_contains_vertex(cv::Vec3i face, int vertex)
 {
     if (face[0] == vertex)
@@ -717,11 +1035,27 @@ float DeltaSurface::pointTo(SurfacePointer *ptr, const cv::Vec3f &tgt, float th,
     return _base->pointTo(ptr, tgt, th, max_iters);
 }
 
+void DeltaSurface::changed(const cv::Vec2f &nominal, float radius)
+{
+    _changes.push_back({nominal[0], nominal[1], radius});
+}
+
+std::vector<cv::Vec3f> DeltaSurface::takeChanges()
+{
+    std::vector<cv::Vec3f> changes;
+    changes.swap(_changes);
+    return changes;
+}
+
+//output pixels around a control point which get moved
+static const int CONTROL_POINT_REACH = 40;
 
 void ControlPointSurface::addControlPoint(SurfacePointer *base_ptr, cv::Vec3f control_point)
 {
     _controls.push_back(SurfaceControlPoint(this, base_ptr, control_point));
     
+    cv::Vec3f nominal = loc(_controls.back().ptr);
+    changed({nominal[0], nominal[1]}, CONTROL_POINT_REACH);
 }
 
 void ControlPointSurface::gen(cv::Mat_<cv::Vec3f> *coords_, cv::Mat_<cv::Vec3f> *normals_, cv::Size size, SurfacePointer *ptr, float scale, const cv::Vec3f &offset)
@@ -761,10 +1095,11 @@ void ControlPointSurface::gen(cv::Mat_<cv::Vec3f> *coords_, cv::Mat_<cv::Vec3f>
     //FIXME implement z_offset
     
     for(auto p : _controls) {
-        cv::Vec3f p_loc = nominal_loc(loc(p.ptr), ptr_inst->loc, dynamic_cast<QuadSurface*>(_base)->_scale)  - upper_left_nominal;
+        //loc() is already nominal, position relative to the generated area only depends on the area
+        cv::Vec3f p_loc = loc(p.ptr) - upper_left_nominal;
         std::cout << p_loc << p_loc*scale <<  loc(p.ptr) << ptr_inst->loc << std::endl;
         p_loc *= scale;
-        cv::Rect roi(p_loc[0]-40,p_loc[1]-40,80,80);
+        cv::Rect roi(p_loc[0]-CONTROL_POINT_REACH,p_loc[1]-CONTROL_POINT_REACH,2*CONTROL_POINT_REACH,2*CONTROL_POINT_REACH);
         cv::Rect area = roi & bounds;
         
         PlaneSurface plane(p.control_point, p.normal);
@@ -822,53 +1157,22 @@ void RefineCompSurface::gen(cv::Mat_<cv::Vec3f> *coords_, cv::Mat_<cv::Vec3f> *n
     
     _base->gen(coords, normals, size, ptr, scale, offset);
     
-    cv::Mat_<cv::Vec3f> res;
-    
-    // cv::Mat_<float> integ(size, 0);
-    // cv::Mat_<float> integ_blur(size, 0);
-    cv::Mat_<float> transparent(size, 1);
-    cv::Mat_<float> blur(size, 0);
-    cv::Mat_<float> integ_z(size, 0);
+    std::vector<float> offsets;
+    for(int n=0;n<21;n++)
+        offsets.push_back(n-5);
     
-    for(int n=0;n<21;n++) {
-        cv::Mat_<uint8_t> slice;
-        float off = (n-5);
-        readInterpolated3D(slice, _ds, (*coords+*normals*off)*scale, _cache);
-        
-        cv::Mat floatslice;
-        slice.convertTo(floatslice, CV_32F, 1/255.0);
-        
-        cv::GaussianBlur(floatslice, blur, {7,7}, 0);
-        cv::Mat opaq_slice = blur;
-        
-        float low = 0.0; //map to 0
-        float up = 1.0; //map to 1
-        opaq_slice = (opaq_slice-low)/(up-low);
-        opaq_slice = cv::min(opaq_slice,1);
-        opaq_slice = cv::max(opaq_slice,0);
-        
-        // sprintf(buf, "opaq%02d.tif", n);
-        // cv::imwrite(buf, opaq_slice);
-        
-        // printf("vals %d i t o b v: %f %f %f %f\n", n, integ.at<float>(500,600), transparent.at<float>(500,600), opaq_slice.at<float>(500,600), blur.at<float>(500,600), floatslice.at<float>(500,600));
-        
-        cv::Mat joint = transparent.mul(opaq_slice);
-        // integ += joint.mul(floatslice);
-        // integ_blur += joint.mul(blur);
-        integ_z += joint * off * scale;
-        transparent = transparent-joint;
-    }
+    cv::Mat_<float> integ_z;
+    cv::Mat_<float> transparent;
+    alphaCompNormals(integ_z, transparent, _ds, _cache, *coords, *normals, offsets, scale, 1e-3);
     
-    integ_z /= (1-transparent);
+    //NOTE the opacity weighted raw values (integ) could be used as an additional output layer to improv visualization!
     
-    //NOTE could be used as an additional output layer to improv visualization!
-    // integ /= (1-transparent);
-    // integ_blur /= (1-transparent);
-    // cv::imwrite("blended_comp1.tif", integ/(integ_blur+0.5));
-
-    cv::Mat mul;
-    cv::cvtColor(integ_z, mul, cv::COLOR_GRAY2BGR);
-    *coords += (*normals).mul(mul+1+offset[2]);
+#pragma omp parallel for
+    for(int j=0;j<coords->rows;j++)
+        for(int i=0;i<coords->cols;i++) {
+            float z = integ_z(j,i)*scale/(1-transparent(j,i));
+            (*coords)(j,i) += (*normals)(j,i)*(z+1+offset[2]);
+        }
 }
 
 //TODO check if this actually works?!
@@ -901,7 +1205,7 @@ uint8_t get_block(const cv::Mat_<uint8_t> &block, const cv::Vec3f &loc, const cv
     return block(y, x);
 }
 
-void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::vector<std::vector<cv::Vec2f>> &seg_grid, const cv::Mat_<cv::Vec3f> &points, PlaneSurface *plane, const cv::Rect &plane_roi, float step)
+void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::vector<std::vector<cv::Vec2f>> &seg_grid, const cv::Mat_<cv::Vec3f> &points, PlaneSurface *plane, const cv::Rect &plane_roi, float step, const GridBoundsTree *tree)
 {
     //start with random points and search for a plane intersection
 
@@ -911,6 +1215,21 @@ void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::
 
     cv::Rect grid_bounds(1,1,points.cols-2,points.rows-2);
 
+    //local generator: this runs concurrently for several surfaces
+    std::mt19937 rng;
+    std::uniform_int_distribution<int> rand_x(0, points.cols-2);
+    std::uniform_int_distribution<int> rand_y(0, points.rows-2);
+    
+    //only seed in patches which cross the visible part of the plane
+    std::vector<cv::Rect> patches;
+    if (tree) {
+        patches = tree->planePatches(plane, 1.0, plane_roi);
+        if (patches.empty())
+            return;
+    }
+    std::uniform_int_distribution<int> rand_patch(0, std::max<int>(0, patches.size()-1));
+    std::uniform_real_distribution<float> rand_unit(0, 1);
+
     for(int r=0;r<100;r++) {
         std::vector<cv::Vec3f> seg;
         std::vector<cv::Vec2f> seg_loc;
@@ -929,7 +1248,13 @@ void find_intersect_segments(std::vector<std::vector<cv::Vec3f>> &seg_vol, std::
 
         //initial points
         for(int i=0;i<100;i++) {
-            loc = {std::rand() % (points.cols-1), std::rand() % (points.rows-1)};
+            if (tree) {
+                const cv::Rect &patch = patches[rand_patch(rng)];
+                loc = {std::clamp<float>(patch.x+rand_unit(rng)*patch.width, 0, points.cols-2),
+                       std::clamp<float>(patch.y+rand_unit(rng)*patch.height, 0, points.rows-2)};
+            }
+            else
+                loc = {rand_x(rng), rand_y(rng)};
             point = at_int(points, loc);
 
             plane_loc = plane->project(point);
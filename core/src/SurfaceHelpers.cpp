@@ -8,6 +8,9 @@
 #include "vc/core/util/Slicing.hpp"
 #include "vc/core/util/Surface.hpp"
 
+#include <random>
+#include <unordered_map>
+
 static std::ostream& operator<< (std::ostream& out, const std::vector<size_t> &v) {
     if ( !v.empty() ) {
         out << '[';
@@ -423,9 +426,12 @@ static float multi_step_search(const cv::Mat_<cv::Vec3f> &points, cv::Vec2f &loc
     
     float best_res = res3;
     cv::Vec2f best_loc = loc;
+    //seeded from the start location: deterministic no matter which thread runs the search
+    std::minstd_rand rng(std::hash<float>()(init_loc[0])*31 ^ std::hash<float>()(init_loc[1]));
+    std::uniform_int_distribution<int> rand_off(0, 99);
     for(int i=0;i<10;i++)
     {
-        cv::Vec2f off = {rand()%100,rand()%100};
+        cv::Vec2f off = {rand_off(rng),rand_off(rng)};
         off -= cv::Vec2f(50,50);
         off = mul(off, init_step)*100/50;
         loc = init_loc + off;
@@ -484,6 +490,15 @@ static float multi_step_search(const cv::Mat_<cv::Vec3f> &points, cv::Vec2f &loc
 
 //lets try again
 //FIXME mark covered regions as not available so we can't repeat them'
+//outcome of growing the cands of one tile, merged serially after each wavefront color
+struct GrowResult {
+    std::vector<cv::Vec2i> grown;
+    std::vector<cv::Vec2i> failed;
+    std::vector<cv::Vec2i> skipped;
+    std::vector<cv::Vec2f> locs;
+    int fails = 0;
+};
+
 cv::Mat_<cv::Vec3f> derive_regular_region_largesteps(const cv::Mat_<cv::Vec3f> &points, cv::Mat_<cv::Vec2f> &locs, int seed_x, int seed_y, float step_size, int w, int h)
 {
     double sx, sy;
@@ -635,170 +650,157 @@ cv::Mat_<cv::Vec3f> derive_regular_region_largesteps(const cv::Mat_<cv::Vec3f> &
         else
             break;
 
-        cv::Mat_<cv::Vec3f> curv_data(2*r+1,2*r+1);
-        cv::Mat_<uint8_t> curv_valid(2*r+1,2*r+1);
-        
+        //cands closer than r see each other (refs, curvature) so they are binned into tiles of r+1, tiles of the
+        //same color (x/y tile parity) are at least r+2 apart and get solved concurrently, each tile in order
+        int tile_size = r+1;
+        std::vector<std::vector<cv::Vec2i>> color_tiles[4];
+        std::unordered_map<uint64_t,std::pair<int,int>> tile_idx;
         for(auto p : cands) {
-            if (state(p))
-                continue;
-            
-            std::vector<cv::Vec3f> refs;
-            std::vector<float> dists;
-            std::vector<float> ws;
-            std::vector<cv::Vec2i> dbg_outp;
-            cv::Vec2f loc_sum = 0;
-            int fail = 0;
-            
-            curv_valid.setTo(0);
-            
-            // printf("run %d %d\n",p[1],p[0]);
-            
-            for(int oy=std::max(p[0]-r,0);oy<=std::min(p[0]+r,out.rows-1);oy++)
-                for(int ox=std::max(p[1]-r,0);ox<=std::min(p[1]+r,out.cols-1);ox++)
-                    if (state(oy,ox) == 1) {
-                        int dy = oy-p[0];
-                        int dx = ox-p[1];
-                        curv_valid(dy+r,dx+r) = 1;
-                        curv_data(dy+r,dx+r) = out(oy,ox);
-                    }
-            
-            float x_curve_sum = 0;
-            int x_curve_count = 0;
-            for(int j=0;j<2*r+1;j++)
-                for(int i=0;i<2*r+1-2;i++) {
-                    if (curv_valid(j,i) && curv_valid(j,i+1) && curv_valid(j,i+2)) {
-                        x_curve_sum += sqrt(sdist(curv_data(j,i),curv_data(j,i+2)))/(2*T);
-                        x_curve_count++;
-                        // printf("%f\n",sqrt(sdist(curv_data(j,i),curv_data(j,i+2)))/(2*T));
-                    }
-                }
-            if (x_curve_count)
-                x_curv(p) = sqrt(std::min(1.0f,x_curve_sum/x_curve_count));
-            
-            float y_curve_sum = 0;
-            int y_curve_count = 0;
-            for(int j=0;j<2*r+1-2;j++)
-                for(int i=0;i<2*r+1;i++) {
-                    if (curv_valid(j,i) && curv_valid(j+1,i) && curv_valid(j+2,i)) {
-                        y_curve_sum += sqrt(sdist(curv_data(j,i),curv_data(j+2,i)))/(2*T);
-                        y_curve_count++;
-                        // printf("%f\n",sqrt(sdist(curv_data(j,i),curv_data(j,i+2)))/(2*T));
-                    }
-                }
-                if (y_curve_count)
-                    y_curv(p) = sqrt(std::min(1.0f,y_curve_sum/y_curve_count));
-            
-            // printf("avg curv xy %f %f\n",x_curv(p),y_curv(p));
+            int ty = p[0]/tile_size;
+            int tx = p[1]/tile_size;
+            uint64_t key = uint64_t(ty) << 32 | uint32_t(tx);
+            if (!tile_idx.count(key)) {
+                int color = (ty % 2)*2 + tx % 2;
+                tile_idx[key] = {color, int(color_tiles[color].size())};
+                color_tiles[color].push_back({});
+            }
+            color_tiles[tile_idx[key].first][tile_idx[key].second].push_back(p);
+        }
+        
+        for(auto &tiles : color_tiles) {
+            std::vector<GrowResult> results(tiles.size());
+            int succ_start = succ;
             
-            for(int oy=std::max(p[0]-r,0);oy<=std::min(p[0]+r,out.rows-1);oy++)
-                for(int ox=std::max(p[1]-r,0);ox<=std::min(p[1]+r,out.cols-1);ox++)
-                    if (state(oy,ox) == 1) {
-                        refs.push_back(out(oy,ox));
-                        float curv_pow_x = pow(x_curv(p),abs(ox-p[1]));
-                        float curv_pow_y = pow(y_curv(p),abs(oy-p[0]));
-                        float dy = abs(oy-p[0])*curv_pow_x;
-                        float dx = abs(ox-p[1])*curv_pow_y;
-                        // float dy = (oy-p[0])*y_curv(p);
-                        // float dx = (ox-p[1])*x_curv(p);
-                        // float dy = (oy-p[0]);
-                        // float dx = (ox-p[1]);
-                        float d = sqrt(dy*dy+dx*dx);
-                        dists.push_back(T*d);
-                        loc_sum += locs(oy,ox);
-                        // float w = 1.0/(std::max(abs(dbg(oy,ox)),1.0f));
-                        float w = 1*curv_pow_x*curv_pow_y/d;
-                        ws.push_back(w);
-                        dbg_outp.push_back({dy,dx});
+#pragma omp parallel for schedule(dynamic)
+            for(int t=0;t<tiles.size();t++) {
+                cv::Mat_<cv::Vec3f> curv_data(2*r+1,2*r+1);
+                cv::Mat_<uint8_t> curv_valid(2*r+1,2*r+1);
+                GrowResult &result = results[t];
+                
+                for(auto p : tiles[t]) {
+                    if (state(p))
+                        continue;
+                    
+                    std::vector<cv::Vec3f> refs;
+                    std::vector<float> dists;
+                    std::vector<float> ws;
+                    cv::Vec2f loc_sum = 0;
+                    int fail = 0;
+                    
+                    curv_valid.setTo(0);
+                    
+                    for(int oy=std::max(p[0]-r,0);oy<=std::min(p[0]+r,out.rows-1);oy++)
+                        for(int ox=std::max(p[1]-r,0);ox<=std::min(p[1]+r,out.cols-1);ox++)
+                            if (state(oy,ox) == 1) {
+                                int dy = oy-p[0];
+                                int dx = ox-p[1];
+                                curv_valid(dy+r,dx+r) = 1;
+                                curv_data(dy+r,dx+r) = out(oy,ox);
+                            }
+                    
+                    float x_curve_sum = 0;
+                    int x_curve_count = 0;
+                    for(int j=0;j<2*r+1;j++)
+                        for(int i=0;i<2*r+1-2;i++) {
+                            if (curv_valid(j,i) && curv_valid(j,i+1) && curv_valid(j,i+2)) {
+                                x_curve_sum += sqrt(sdist(curv_data(j,i),curv_data(j,i+2)))/(2*T);
+                                x_curve_count++;
+                            }
+                        }
+                    if (x_curve_count)
+                        x_curv(p) = sqrt(std::min(1.0f,x_curve_sum/x_curve_count));
+                    
+                    float y_curve_sum = 0;
+                    int y_curve_count = 0;
+                    for(int j=0;j<2*r+1-2;j++)
+                        for(int i=0;i<2*r+1;i++) {
+                            if (curv_valid(j,i) && curv_valid(j+1,i) && curv_valid(j+2,i)) {
+                                y_curve_sum += sqrt(sdist(curv_data(j,i),curv_data(j+2,i)))/(2*T);
+                                y_curve_count++;
+                            }
+                        }
+                    if (y_curve_count)
+                        y_curv(p) = sqrt(std::min(1.0f,y_curve_sum/y_curve_count));
+                    
+                    for(int oy=std::max(p[0]-r,0);oy<=std::min(p[0]+r,out.rows-1);oy++)
+                        for(int ox=std::max(p[1]-r,0);ox<=std::min(p[1]+r,out.cols-1);ox++)
+                            if (state(oy,ox) == 1) {
+                                refs.push_back(out(oy,ox));
+                                float curv_pow_x = pow(x_curv(p),abs(ox-p[1]));
+                                float curv_pow_y = pow(y_curv(p),abs(oy-p[0]));
+                                float dy = abs(oy-p[0])*curv_pow_x;
+                                float dx = abs(ox-p[1])*curv_pow_y;
+                                float d = sqrt(dy*dy+dx*dx);
+                                dists.push_back(T*d);
+                                loc_sum += locs(oy,ox);
+                                float w = 1*curv_pow_x*curv_pow_y/d;
+                                ws.push_back(w);
+                            }
+                            else if (state(oy,ox) == 10)
+                                fail++;
+                    
+                    locs(p) = loc_sum*(1.0/dists.size());
+                    
+                    if (fail >= 2 && !ignore_failures) {
+                        result.failed.push_back(p);
+                        continue;
                     }
-                    else if (state(oy,ox) == 10)
-                        fail++;
-            // else if (state(oy,ox) == 10)
-            // fail++;
                     
-            locs(p) = loc_sum*(1.0/dists.size());
-            
-            if (fail >= 2 && !ignore_failures) {
-                setfail.push_back(p);
-                continue;
-            }
-            
-            if (!ignore_failures && succ > 200 && dists.size()-4*fail <= 12) {
-                skipped.push_back(p);
-                continue;
-            }
+                    if (!ignore_failures && succ_start+result.grown.size() > 200 && dists.size()-4*fail <= 12) {
+                        result.skipped.push_back(p);
+                        continue;
+                    }
                     
-            int failstate = 0;
-            res = multi_step_search(points, locs(p), out(p), refs, dists, nullptr, step, {}, {}, failstate, ws, th, used);
-            all_locs.push_back(locs(p));
-            
-            // printf("%f\n", res);
-
-            dbg(p) = -res;
+                    int failstate = 0;
+                    float res = multi_step_search(points, locs(p), out(p), refs, dists, nullptr, step, {}, {}, failstate, ws, th, used);
+                    result.locs.push_back(locs(p));
                     
-            if (failstate && !ignore_failures) {
-                printf("fail %f %d %d\n", res, p[1]*5, p[0]*5);
-                setfail.push_back(p);
-                total_fail++;
-                
-                // std::vector<cv::Vec3f> succ_ps;
-                // for(int j=0;j<10;j++)
-                //     for(int i=0;i<10;i++) {
-                //         cv::Vec2i l = p+cv::Vec2i(j-5,i-5);
-                //         if (state(l) == 1)
-                //             succ_ps.push_back(out(l));
-                //     }
+                    dbg(p) = -res;
                     
-                /*std::vector<cv::Vec3f> input_ps;
-                std::vector<cv::Vec3f> rounded_ps;
-                cv::Vec2i ref_loc = loc_sum*(1.0/dists.size());
-                // cv::Vec2i ref_loc = locs(some_point);
-                for(int j=0;j<50;j++)
-                    for(int i=0;i<50;i++) {
-                        cv::Vec2i l = ref_loc+cv::Vec2i(j-25,i-25);
-                        input_ps.push_back(points(l[1],l[0]));
+                    if (failstate && !ignore_failures) {
+                        printf("fail %f %d %d\n", res, p[1]*5, p[0]*5);
+                        result.failed.push_back(p);
+                        result.fails++;
+                    }
+                    else if (res < 0 && !failstate) {
+                        //image edge encountered
+                        state(p) = 11;
+                        out(p) = -1;
+                    }
+                    else {
+                        //visible right away for the rest of this tile, other tiles of this color are out of reach
+                        state(p) = 1;
+                        result.grown.push_back(p);
                     }
-                // for(auto l : dbg_outp)
-                    // input_ps.push_back(points(locs(l)[0],locs(l)[1]));
-                // for(auto l : all_locs) 
-                //     input_ps.push_back(at_int(points,l));
-                // for(auto l : all_locs) 
-                //     rounded_ps.push_back(points(l[1],l[0]));
-                
-                for(int n=0;n<refs.size();n++) {
-                    std::cout << refs[n] << dbg_outp[0] << " " << dbg_outp[1] << std::endl;
                 }
-                
-                write_ply("surf.ply", refs);
-                write_ply("points.ply", input_ps);
-                write_ply("res.ply", {out(p)});*/
-                // write_ply("points_nearest.ply", rounded_ps);
-                
-                // cv::imwrite("xcurv.tif",x_curv);
-                // cv::imwrite("ycurv.tif",y_curv);
-                // return out;
-            }
-            else if (res < 0 && !failstate) {
-                //image edge encountered
-                state(p) = 11;
-                out(p) = -1;
             }
-            else {
-                last_round_updated++;
-                succ++;
-                state(p) = 1;
-                fringe.push_back(p);
-                if (!used_area.contains({p[1],p[0]})) {
+            
+            //merge in tile order so the result does not depend on scheduling
+            std::vector<cv::Vec2f> grown_locs;
+            for(auto &result : results) {
+                setfail.insert(setfail.end(), result.failed.begin(), result.failed.end());
+                skipped.insert(skipped.end(), result.skipped.begin(), result.skipped.end());
+                all_locs.insert(all_locs.end(), result.locs.begin(), result.locs.end());
+                total_fail += result.fails;
+                for(auto p : result.grown) {
+                    last_round_updated++;
+                    succ++;
+                    fringe.push_back(p);
                     used_area = used_area | cv::Rect(p[1],p[0],1,1);
+                    grown_locs.push_back(locs(p));
                 }
-                cv::Rect roi = {locs(p)[0]-80,locs(p)[1]-80,160,160};
+            }
+            
+            //the used map is read by all searches, so it is only updated between the colors
+            for(auto &l : grown_locs) {
+                cv::Rect roi = {l[0]-80,l[1]-80,160,160};
                 roi = roi & src_bounds;
+                cv::Vec3f src = points(l[1],l[0]);
+#pragma omp parallel for
                 for(int j=roi.y;j<roi.br().y;j++)
-                    for(int i=roi.x;i<roi.br().x;i++) {
-                        // used(j,i) = std::max(used(j,i), float(1.0-1.0/T*sqrt(sdist(points(locs(p)[1],locs(p)[0]), points(j,i))+1e-2)));
-                        used(j,i) = std::min(1.0f, used(j,i) + std::max(0.0f, float(1.0-1.0/T*sqrt(sdist(points(locs(p)[1],locs(p)[0]), points(j,i))+1e-2))));
-                    }
+                    for(int i=roi.x;i<roi.br().x;i++)
+                        used(j,i) = std::min(1.0f, used(j,i) + std::max(0.0f, float(1.0-1.0/T*sqrt(sdist(src, points(j,i))+1e-2))));
             }
-            
         }
         cands.resize(0);
   
@@ -1002,7 +1004,8 @@ cv::Mat_<cv::Vec3f> upsample_with_grounding_skip(const cv::Mat_<cv::Vec3f> &smal
     
     large.setTo(-1);
     
-#pragma omp parallel for
+    //blocks write disjoint pixels, cost varies a lot (invalid corners are skipped) so balance dynamically
+#pragma omp parallel for collapse(2) schedule(dynamic, 16)
     for(int j=0;j<small.rows-1;j++)
         for(int i=0;i<small.cols-1;i++) {
             cv::Vec3f tgt1 = small(j,i);
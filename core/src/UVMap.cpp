@@ -27,24 +27,36 @@ using namespace volcart;
 
 inline auto OriginVector(const UVMap::Origin& o) -> cv::Vec2d;
 
+namespace
+{
+// Transform a UV value between the storage origin and origin o
+inline auto Transform(const cv::Vec2d& uv, const cv::Vec2d& o) -> cv::Vec2d
+{
+    return {std::abs(uv[0] - o[0]), std::abs(uv[1] - o[1])};
+}
+}  // namespace
+
 void UVMap::set(std::size_t id, const cv::Vec2d& uv, const Origin& o)
 {
+    // mark the ID as valid
+    grow_(id);
+    if (not contains(id)) {
+        auto bit = BitmapWord{1} << (id % BITMAP_WORD_BITS);
+        valid_[id / BITMAP_WORD_BITS] |= bit;
+        size_++;
+    }
+
     // transform to be relative to top-left
-    cv::Vec2d transformed;
-    cv::absdiff(uv, OriginVector(o), transformed);
-    map_[id] = transformed;
+    store_(id, ::Transform(uv, OriginVector(o)));
 }
 
 void UVMap::set(std::size_t id, const cv::Vec2d& uv) { set(id, uv, origin_); }
 
 auto UVMap::get(std::size_t id, const Origin& o) const -> cv::Vec2d
 {
-    auto it = map_.find(id);
-    if (it != map_.end()) {
+    if (contains(id)) {
         // transform to be relative to the provided origin
-        cv::Vec2d transformed;
-        cv::absdiff(it->second, OriginVector(o), transformed);
-        return transformed;
+        return ::Transform(stored_(id), OriginVector(o));
     } else {
         return NULL_MAPPING;
     }
@@ -54,14 +66,60 @@ auto UVMap::get(std::size_t id) const -> cv::Vec2d { return get(id, origin_); }
 
 auto UVMap::contains(std::size_t id) const -> bool
 {
-    return map_.count(id) > 0;
+    return id < extent_ and
+           (valid_[id / BITMAP_WORD_BITS] >> (id % BITMAP_WORD_BITS)) & 1U;
 }
 
 UVMap::UVMap(UVMap::Origin o) : origin_{o} {}
 
-auto UVMap::size() const -> std::size_t { return map_.size(); }
+auto UVMap::size() const -> std::size_t { return size_; }
+
+auto UVMap::empty() const -> bool { return size_ == 0; }
 
-auto UVMap::empty() const -> bool { return map_.empty(); }
+auto UVMap::extent() const -> std::size_t { return extent_; }
+
+void UVMap::reserve(std::size_t n)
+{
+    valid_.reserve((n + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS);
+    if (precision_ == Precision::Float64) {
+        uv64_.reserve(n);
+    } else {
+        uv32_.reserve(n);
+    }
+}
+
+void UVMap::clear()
+{
+    uv64_.clear();
+    uv32_.clear();
+    valid_.clear();
+    extent_ = 0;
+    size_ = 0;
+}
+
+void UVMap::setPrecision(Precision p)
+{
+    if (p == precision_) {
+        return;
+    }
+
+    if (p == Precision::Float32) {
+        uv32_.resize(extent_);
+        std::transform(
+            uv64_.begin(), uv64_.end(), uv32_.begin(),
+            [](const auto& uv) { return cv::Vec2f(uv); });
+        uv64_ = {};
+    } else {
+        uv64_.resize(extent_);
+        std::transform(
+            uv32_.begin(), uv32_.end(), uv64_.begin(),
+            [](const auto& uv) { return cv::Vec2d(uv); });
+        uv32_ = {};
+    }
+    precision_ = p;
+}
+
+auto UVMap::precision() const -> Precision { return precision_; }
 
 void UVMap::setOrigin(const UVMap::Origin& o) { origin_ = o; }
 
@@ -78,7 +136,36 @@ void UVMap::ratio(double w, double h)
     ratio_.aspect = w / h;
 }
 
-auto UVMap::as_map() const -> std::map<std::size_t, cv::Vec2d> { return map_; }
+auto UVMap::stored_(std::size_t id) const -> cv::Vec2d
+{
+    if (precision_ == Precision::Float64) {
+        return uv64_[id];
+    }
+    return uv32_[id];
+}
+
+void UVMap::store_(std::size_t id, const cv::Vec2d& uv)
+{
+    if (precision_ == Precision::Float64) {
+        uv64_[id] = uv;
+    } else {
+        uv32_[id] = uv;
+    }
+}
+
+void UVMap::grow_(std::size_t id)
+{
+    if (id < extent_) {
+        return;
+    }
+    extent_ = id + 1;
+    valid_.resize((extent_ + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS, 0);
+    if (precision_ == Precision::Float64) {
+        uv64_.resize(extent_, NULL_MAPPING);
+    } else {
+        uv32_.resize(extent_, NULL_MAPPING);
+    }
+}
 
 auto OriginVector(const UVMap::Origin& o) -> cv::Vec2d
 {
@@ -105,8 +192,12 @@ auto UVMap::Plot(const UVMap& uv, const Color& color) -> cv::Mat
     auto h = static_cast<int>(std::ceil(w / uv.ratio_.aspect));
     cv::Mat r = cv::Mat::zeros(h, w, CV_8UC3);
 
-    for (auto it : uv.map_) {
-        cv::Point2d p(it.second[0] * w, it.second[1] * h);
+    for (std::size_t id = 0; id < uv.extent_; id++) {
+        if (not uv.contains(id)) {
+            continue;
+        }
+        auto m = uv.stored_(id);
+        cv::Point2d p(m[0] * w, m[1] * h);
         cv::circle(r, p, 1, color, -1);
     }
 
@@ -222,7 +313,7 @@ void UVMap::AlignToAxis(
 
     // sample UV points and corresponding mesh coordinates of interest
     auto sampledUVs = UVMap::New(uv);
-    sampledUVs->map_.clear();
+    sampledUVs->clear();
     std::vector<double> meshCoords(numSamples);
     for (auto [i, idx] : enumerate(idxs)) {
         sampledUVs->set(i, uv.get(idx));
@@ -282,21 +373,21 @@ void UVMap::Rotate(UVMap& uv, Rotation rotation, cv::Mat& texture)
     }
 
     // Update each UV coordinate
-    for (auto& m : uv.map_) {
+    uv.for_each_stored_([rotation](std::size_t, cv::Vec2d& m) {
         if (rotation == Rotation::CW90) {
-            auto u = 1. - m.second[1];
-            auto v = m.second[0];
-            m.second[0] = u;
-            m.second[1] = v;
+            auto u = 1. - m[1];
+            auto v = m[0];
+            m[0] = u;
+            m[1] = v;
         } else if (rotation == Rotation::CW180) {
-            m.second = cv::Vec2d{1, 1} - m.second;
+            m = cv::Vec2d{1, 1} - m;
         } else if (rotation == Rotation::CCW90) {
-            auto u = m.second[1];
-            auto v = 1. - m.second[0];
-            m.second[0] = u;
-            m.second[1] = v;
+            auto u = m[1];
+            auto v = 1. - m[0];
+            m[0] = u;
+            m[1] = v;
         }
-    }
+    });
 
     // Update the texture
     if (not texture.empty()) {
@@ -308,18 +399,17 @@ void UVMap::Rotate(
     UVMap& uv, double theta, cv::Mat& texture, const cv::Vec2d& center)
 {
     // Setup pts matrix
-    cv::Mat pts = cv::Mat::ones(uv.map_.size(), 3, CV_64F);
+    cv::Mat pts = cv::Mat::ones(uv.size(), 3, CV_64F);
     int row = 0;
-    for (const auto& p : uv.map_) {
+    uv.for_each_stored_([&](std::size_t, cv::Vec2d& p) {
         // transform so that operation happens relative to stored origin
-        cv::Vec2d transformed;
-        cv::absdiff(p.second, OriginVector(uv.origin_), transformed);
+        auto transformed = ::Transform(p, OriginVector(uv.origin_));
 
         // Store in matrix of points
         pts.at<double>(row, 0) = transformed[0];
         pts.at<double>(row, 1) = transformed[1];
         row++;
-    }
+    });
 
     // Translate to center of rotation in UV space
     cv::Mat t1 = cv::Mat::eye(3, 3, CV_64F);
@@ -365,22 +455,17 @@ void UVMap::Rotate(
     // Update UVs within new bounds
     cv::Vec2d newPos;
     row = 0;
-    for (auto& p : uv.map_) {
+    uv.for_each_stored_([&](std::size_t, cv::Vec2d& p) {
         // rescale within bounds
         newPos[0] = (pts.at<double>(row, 0) - uMin) / (uMax - uMin);
         newPos[1] = (pts.at<double>(row, 1) - vMin) / (vMax - vMin);
 
         // transform back to storage origin
-        cv::Vec2d transformed;
-        cv::absdiff(newPos, OriginVector(uv.origin_), transformed);
-
-        // store
-        p.second[0] = transformed[0];
-        p.second[1] = transformed[1];
+        p = ::Transform(newPos, OriginVector(uv.origin_));
 
         // Advance the row counter
         row++;
-    }
+    });
 
     // Update texture
     if (not texture.empty()) {
@@ -413,17 +498,17 @@ void UVMap::Rotate(UVMap& uv, double theta, const cv::Vec2d& center)
 
 void UVMap::Flip(UVMap& uv, FlipAxis axis)
 {
-    for (auto& p : uv.map_) {
+    uv.for_each_stored_([axis](std::size_t, cv::Vec2d& p) {
         switch (axis) {
             case FlipAxis::Horizontal:
-                p.second[0] = 1 - p.second[0];
-                continue;
+                p[0] = 1 - p[0];
+                return;
             case FlipAxis::Vertical:
-                p.second[1] = 1 - p.second[1];
-                continue;
+                p[1] = 1 - p[1];
+                return;
             case FlipAxis::Both:
-                p.second = cv::Vec2d{1, 1} - p.second;
-                continue;
+                p = cv::Vec2d{1, 1} - p;
+                return;
         }
-    }
+    });
 }
@@ -24,24 +24,33 @@ void vio::WriteUVMap(const fs::path& path, const UVMap& uvMap)
     }
 
     // Header
+    auto f32 = uvMap.precision() == UVMap::Precision::Float32;
     std::stringstream ss;
     ss << "filetype: uvmap" << '\n';
-    ss << "version: 1" << '\n';
+    ss << "version: 2" << '\n';
     ss << "type: per-vertex" << '\n';
     ss << "size: " << uvMap.size() << '\n';
+    ss << "extent: " << uvMap.extent() << '\n';
+    ss << "precision: " << (f32 ? "float32" : "float64") << '\n';
     ss << "width: " << uvMap.ratio().width << '\n';
     ss << "height: " << uvMap.ratio().height << '\n';
     ss << "origin: " << static_cast<int>(uvMap.origin()) << '\n';
     ss << "<>" << '\n';
     outfile << ss.rdbuf();
 
-    // Write the mappings
-    for (const auto& mapping : uvMap.as_map()) {
-        const auto& id = mapping.first;
-        const auto& uv = mapping.second;
-        outfile.write(reinterpret_cast<const char*>(&id), sizeof(id));
-        auto nbytes = 2 * sizeof(double);
-        outfile.write(reinterpret_cast<const char*>(uv.val), nbytes);
+    // Write the validity bitmap and the mappings
+    const auto& valid = uvMap.valid_;
+    outfile.write(
+        reinterpret_cast<const char*>(valid.data()),
+        static_cast<std::streamsize>(valid.size() * sizeof(valid[0])));
+    if (f32) {
+        outfile.write(
+            reinterpret_cast<const char*>(uvMap.uv32_.data()),
+            static_cast<std::streamsize>(uvMap.extent() * sizeof(cv::Vec2f)));
+    } else {
+        outfile.write(
+            reinterpret_cast<const char*>(uvMap.uv64_.data()),
+            static_cast<std::streamsize>(uvMap.extent() * sizeof(cv::Vec2d)));
     }
 
     outfile.flush();
@@ -62,9 +71,11 @@ auto vio::ReadUVMap(const fs::path& path) -> UVMap
 
     struct Header {
         std::string fileType;
-        int version;
+        int version{1};
         std::string type;
-        std::size_t size;
+        std::size_t size{0};
+        std::size_t extent{0};
+        std::string precision{"float64"};
         double width{0};
         double height{0};
         int origin{-1};
@@ -76,6 +87,8 @@ auto vio::ReadUVMap(const fs::path& path) -> UVMap
     std::regex version{"^version"};
     std::regex type{"^type"};
     std::regex size{"^size"};
+    std::regex extent{"^extent"};
+    std::regex precision{"^precision"};
     std::regex width{"^width"};
     std::regex height{"^height"};
     std::regex origin{"^origin"};
@@ -106,10 +119,10 @@ auto vio::ReadUVMap(const fs::path& path) -> UVMap
 
         // Version
         else if (std::regex_match(strs[0], version)) {
-            auto fileVersion = std::stoi(strs[1]);
-            if (fileVersion != 1) {
+            h.version = std::stoi(strs[1]);
+            if (h.version != 1 and h.version != 2) {
                 auto msg = "Version mismatch. UVMap file version is " +
-                           strs[1] + ", processing version is 1.";
+                           strs[1] + ", processing versions are 1 and 2.";
                 throw IOException(msg);
             }
         }
@@ -127,6 +140,19 @@ auto vio::ReadUVMap(const fs::path& path) -> UVMap
             h.size = std::stoul(strs[1]);
         }
 
+        // Extent
+        else if (std::regex_match(strs[0], extent)) {
+            h.extent = std::stoul(strs[1]);
+        }
+
+        // Precision
+        else if (std::regex_match(strs[0], precision)) {
+            if (strs[1] != "float32" and strs[1] != "float64") {
+                throw IOException("Unsupported UVMap precision: " + strs[1]);
+            }
+            h.precision = strs[1];
+        }
+
         // Width
         else if (std::regex_match(strs[0], width)) {
             h.width = std::stod(strs[1]);
@@ -172,14 +198,45 @@ auto vio::ReadUVMap(const fs::path& path) -> UVMap
     map.setOrigin(static_cast<UVMap::Origin>(h.origin));
     map.ratio(h.width, h.height);
 
-    // Read all of the points
-    for (const auto& i : range(h.size)) {
-        std::ignore = i;
-        std::size_t id{0};
-        cv::Vec2d uv;
-        infile.read(reinterpret_cast<char*>(&id), sizeof(id));
-        infile.read(reinterpret_cast<char*>(uv.val), 2 * sizeof(double));
-        map.set(id, uv);
+    // Version 1: Read all of the points as ID/value pairs
+    if (h.version == 1) {
+        for (const auto& i : range(h.size)) {
+            std::ignore = i;
+            std::size_t id{0};
+            cv::Vec2d uv;
+            infile.read(reinterpret_cast<char*>(&id), sizeof(id));
+            infile.read(reinterpret_cast<char*>(uv.val), 2 * sizeof(double));
+            map.set(id, uv);
+        }
+        return map;
+    }
+
+    // Version 2: Bulk read the validity bitmap and dense storage
+    auto f32 = h.precision == "float32";
+    map.setPrecision(
+        f32 ? UVMap::Precision::Float32 : UVMap::Precision::Float64);
+    map.extent_ = h.extent;
+    map.size_ = h.size;
+    map.valid_.resize(
+        (h.extent + UVMap::BITMAP_WORD_BITS - 1) / UVMap::BITMAP_WORD_BITS);
+    infile.read(
+        reinterpret_cast<char*>(map.valid_.data()),
+        static_cast<std::streamsize>(
+            map.valid_.size() * sizeof(UVMap::BitmapWord)));
+    if (f32) {
+        map.uv32_.resize(h.extent);
+        infile.read(
+            reinterpret_cast<char*>(map.uv32_.data()),
+            static_cast<std::streamsize>(h.extent * sizeof(cv::Vec2f)));
+    } else {
+        map.uv64_.resize(h.extent);
+        infile.read(
+            reinterpret_cast<char*>(map.uv64_.data()),
+            static_cast<std::streamsize>(h.extent * sizeof(cv::Vec2d)));
+    }
+    if (infile.fail()) {
+        auto msg = "failure reading file '" + path.string() + "'";
+        throw IOException(msg);
     }
 
     return map;
@@ -226,13 +226,11 @@ auto Volume::intensityAt(int x, int y, int z) const -> std::uint16_t
 
 // Trilinear Interpolation
 // From: https://en.wikipedia.org/wiki/Trilinear_interpolation
-auto Volume::interpolateAt(double x, double y, double z) const -> std::uint16_t
+// at(x, y, z) provides the (integer) voxel intensities
+template <typename IntensityFn>
+static auto Trilinear(double x, double y, double z, const IntensityFn& at)
+    -> std::uint16_t
 {
-    // insert safety net
-    if (!isInBounds(x, y, z)) {
-        return 0;
-    }
-
     double intPart;
     double dx = std::modf(x, &intPart);
     auto x0 = static_cast<int>(intPart);
@@ -244,14 +242,10 @@ auto Volume::interpolateAt(double x, double y, double z) const -> std::uint16_t
     auto z0 = static_cast<int>(intPart);
     int z1 = z0 + 1;
 
-    auto c00 =
-        intensityAt(x0, y0, z0) * (1 - dx) + intensityAt(x1, y0, z0) * dx;
-    auto c10 =
-        intensityAt(x0, y1, z0) * (1 - dx) + intensityAt(x1, y0, z0) * dx;
-    auto c01 =
-        intensityAt(x0, y0, z1) * (1 - dx) + intensityAt(x1, y0, z1) * dx;
-    auto c11 =
-        intensityAt(x0, y1, z1) * (1 - dx) + intensityAt(x1, y1, z1) * dx;
+    auto c00 = at(x0, y0, z0) * (1 - dx) + at(x1, y0, z0) * dx;
+    auto c10 = at(x0, y1, z0) * (1 - dx) + at(x1, y0, z0) * dx;
+    auto c01 = at(x0, y0, z1) * (1 - dx) + at(x1, y0, z1) * dx;
+    auto c11 = at(x0, y1, z1) * (1 - dx) + at(x1, y1, z1) * dx;
 
     auto c0 = c00 * (1 - dy) + c10 * dy;
     auto c1 = c01 * (1 - dy) + c11 * dy;
@@ -260,12 +254,27 @@ auto Volume::interpolateAt(double x, double y, double z) const -> std::uint16_t
     return static_cast<std::uint16_t>(cvRound(c));
 }
 
-auto Volume::reslice(
+auto Volume::interpolateAt(double x, double y, double z) const -> std::uint16_t
+{
+    // insert safety net
+    if (!isInBounds(x, y, z)) {
+        return 0;
+    }
+
+    return Trilinear(x, y, z, [this](int vx, int vy, int vz) {
+        return intensityAt(vx, vy, vz);
+    });
+}
+
+// Fill a reslice image using sample(pos) for every pixel
+template <typename SampleFn>
+static auto SampleReslice(
     const cv::Vec3d& center,
     const cv::Vec3d& xvec,
     const cv::Vec3d& yvec,
     int width,
-    int height) const -> Reslice
+    int height,
+    const SampleFn& sample) -> Reslice
 {
     auto xnorm = cv::normalize(xvec);
     auto ynorm = cv::normalize(yvec);
@@ -275,13 +284,56 @@ auto Volume::reslice(
     for (int h = 0; h < height; ++h) {
         for (int w = 0; w < width; ++w) {
             m.at<std::uint16_t>(h, w) =
-                interpolateAt(origin + (h * ynorm) + (w * xnorm));
+                sample(origin + (h * ynorm) + (w * xnorm));
         }
     }
 
     return Reslice(m, origin, xnorm, ynorm);
 }
 
+auto Volume::reslice(
+    const cv::Vec3d& center,
+    const cv::Vec3d& xvec,
+    const cv::Vec3d& yvec,
+    int width,
+    int height) const -> Reslice
+{
+    return SampleReslice(
+        center, xvec, yvec, width, height,
+        [this](const cv::Vec3d& v) { return interpolateAt(v); });
+}
+
+auto Volume::reslice(
+    const cv::Vec3d& center,
+    const cv::Vec3d& xvec,
+    const cv::Vec3d& yvec,
+    const std::vector<cv::Mat>& slab,
+    const cv::Vec3i& slabOrigin,
+    int width,
+    int height) const -> Reslice
+{
+    const auto d = static_cast<int>(slab.size());
+    const auto w = slab.empty() ? 0 : slab[0].cols;
+    const auto h = slab.empty() ? 0 : slab[0].rows;
+    auto at = [&](int x, int y, int z) -> std::uint16_t {
+        const auto sx = x - slabOrigin[0];
+        const auto sy = y - slabOrigin[1];
+        const auto sz = z - slabOrigin[2];
+        if (sz >= 0 && sz < d && sx >= 0 && sx < w && sy >= 0 && sy < h) {
+            return slab[sz].at<std::uint16_t>(sy, sx);
+        }
+        return intensityAt(x, y, z);
+    };
+
+    return SampleReslice(
+        center, xvec, yvec, width, height, [&](const cv::Vec3d& v) {
+            if (!isInBounds(v)) {
+                return std::uint16_t{0};
+            }
+            return Trilinear(v[0], v[1], v[2], at);
+        });
+}
+
 void throw_run_path(const fs::path &path, const std::string msg)
 {
     throw std::runtime_error(msg + " for " + path.string());
@@ -55,7 +55,7 @@ inline void keep(const fs::path& dir)
     }
 }
 
-const std::set<std::string> supportedSegmentFileExtensions = {".vcps",".obj"};
+const std::set<std::string> supportedSegmentFileExtensions = {".vcps",".obj",".vcqs"};
 
 ////// Upgrade functions //////
 auto VolpkgV3ToV4(const Metadata& meta) -> Metadata
@@ -1,14 +1,103 @@
 #include "vc/core/types/VolumetricMask.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
 using namespace volcart;
 
-void VolumetricMask::setIn(const Voxel& v) { mask_.insert(v); }
+void VolumetricMask::setIn(const Voxel& v)
+{
+    auto [word, bit] = WordIndex(v[0], v[1], v[2]);
+    auto& block = blocks_.try_emplace(BlockKey(v[0], v[1], v[2])).first->second;
+    block[word] |= (1ULL << bit);
+}
+
+void VolumetricMask::setOut(const Voxel& v)
+{
+    auto it = blocks_.find(BlockKey(v[0], v[1], v[2]));
+    if (it == blocks_.end()) {
+        return;
+    }
+    auto [word, bit] = WordIndex(v[0], v[1], v[2]);
+    it->second[word] &= ~(1ULL << bit);
+}
+
+void VolumetricMask::setSliceIn(const cv::Mat& slice, int z)
+{
+    if (slice.empty()) {
+        return;
+    }
+    if (slice.type() != CV_8UC1) {
+        throw std::invalid_argument("slice must be single-channel, 8-bit");
+    }
 
-void VolumetricMask::setOut(const Voxel& v) { mask_.erase(v); }
+    Block* block{nullptr};
+    std::uint64_t blockKey{0};
+    for (int y = 0; y < slice.rows; ++y) {
+        const auto* row = slice.ptr<std::uint8_t>(y);
+        for (int x0 = 0; x0 < slice.cols; x0 += BLOCK_WIDTH) {
+            // Pack up to one word's worth of pixels
+            auto n = std::min(BLOCK_WIDTH, slice.cols - x0);
+            std::uint64_t bits{0};
+            for (int i = 0; i < n; ++i) {
+                bits |= static_cast<std::uint64_t>(row[x0 + i] != 0) << i;
+            }
+            if (bits == 0) {
+                continue;
+            }
+
+            // Consecutive rows mostly land in the same block
+            auto key = BlockKey(x0, y, z);
+            if (block == nullptr || key != blockKey) {
+                block = &blocks_.try_emplace(key).first->second;
+                blockKey = key;
+            }
+            (*block)[WordIndex(x0, y, z).first] |= bits;
+        }
+    }
+}
+
+auto VolumetricMask::slice(int z, const cv::Size& size) const -> cv::Mat
+{
+    cv::Mat out = cv::Mat::zeros(size, CV_8UC1);
+    const auto bz = FloorDiv(z, BLOCK_DEPTH);
+    const auto lz = z - bz * BLOCK_DEPTH;
+    for (const auto& [key, words] : blocks_) {
+        auto idx = BlockIndex(key);
+        if (idx[2] != bz) {
+            continue;
+        }
+        auto origin = BlockOrigin(key);
+        for (int ly = 0; ly < BLOCK_HEIGHT; ++ly) {
+            auto y = origin[1] + ly;
+            auto bits = words[lz * BLOCK_HEIGHT + ly];
+            if (bits == 0 || y < 0 || y >= size.height) {
+                continue;
+            }
+            auto* row = out.ptr<std::uint8_t>(y);
+            while (bits != 0) {
+                auto x = origin[0] + __builtin_ctzll(bits);
+                if (x >= 0 && x < size.width) {
+                    row[x] = 255;
+                }
+                bits &= bits - 1;
+            }
+        }
+    }
+    return out;
+}
 
 auto VolumetricMask::isIn(const Voxel& v) const -> bool
 {
-    return mask_.count(v) > 0;
+    auto it = blocks_.find(BlockKey(v[0], v[1], v[2]));
+    if (it == blocks_.end()) {
+        return false;
+    }
+    auto [word, bit] = WordIndex(v[0], v[1], v[2]);
+    return (it->second[word] >> bit) & 1ULL;
 }
 
 auto VolumetricMask::isOut(const Voxel& v) const -> bool { return not isIn(v); }
@@ -26,41 +115,143 @@ auto VolumetricMask::isOut(const cv::Vec3d& v) const -> bool
     return not isIn(v);
 }
 
-auto VolumetricMask::begin() noexcept -> VolumetricMask::iterator
+void VolumetricMask::merge(const VolumetricMask& other)
 {
-    return mask_.begin();
+    // Allocating blocks modifies the map, so do that serially and collect the
+    // blocks which have to be combined
+    std::vector<std::pair<Block*, const Block*>> shared;
+    for (const auto& [key, words] : other.blocks_) {
+        auto [it, inserted] = blocks_.try_emplace(key, words);
+        if (!inserted) {
+            shared.emplace_back(&it->second, &words);
+        }
+    }
+
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < shared.size(); ++i) {
+        auto& dst = *shared[i].first;
+        const auto& src = *shared[i].second;
+        for (std::size_t w = 0; w < BLOCK_WORDS; ++w) {
+            dst[w] |= src[w];
+        }
+    }
 }
 
 auto VolumetricMask::begin() const noexcept -> VolumetricMask::const_iterator
 {
-    return mask_.begin();
+    return {blocks_.begin(), blocks_.end()};
 }
 
 auto VolumetricMask::cbegin() const noexcept -> VolumetricMask::const_iterator
 {
-    return mask_.cbegin();
-}
-
-auto VolumetricMask::end() noexcept -> VolumetricMask::iterator
-{
-    return mask_.end();
+    return begin();
 }
 
 auto VolumetricMask::end() const noexcept -> VolumetricMask::const_iterator
 {
-    return mask_.end();
+    return {blocks_.end(), blocks_.end()};
 }
 
 auto VolumetricMask::cend() const noexcept -> VolumetricMask::const_iterator
 {
-    return mask_.end();
+    return end();
 }
 
-void VolumetricMask::clear() { mask_.clear(); }
+void VolumetricMask::clear() { blocks_.clear(); }
+
+auto VolumetricMask::empty() const -> bool { return begin() == end(); }
+
+auto VolumetricMask::size() const -> std::size_t
+{
+    std::size_t count{0};
+    for (const auto& block : blocks_) {
+        for (const auto& w : block.second) {
+            count += __builtin_popcountll(w);
+        }
+    }
+    return count;
+}
 
-auto VolumetricMask::empty() const -> bool { return mask_.empty(); }
+auto VolumetricMask::memoryUsage() const -> std::size_t
+{
+    return blocks_.size() * sizeof(BlockMap::value_type) +
+           blocks_.bucket_count() * sizeof(void*);
+}
 
 auto VolumetricMask::as_vector() const -> std::vector<VolumetricMask::Voxel>
 {
-    return {mask_.begin(), mask_.end()};
+    std::vector<Voxel> voxels;
+    voxels.reserve(size());
+    voxels.insert(voxels.end(), begin(), end());
+    return voxels;
+}
+
+auto VolumetricMask::as_runs() const -> std::vector<VolumetricMask::Run>
+{
+    // Visit blocks in (z, y, x) order so runs come out sorted and runs which
+    // continue into the next block can be joined
+    std::map<std::tuple<int, int, int>, const Block*> ordered;
+    for (const auto& [key, words] : blocks_) {
+        auto idx = BlockIndex(key);
+        ordered.emplace(std::make_tuple(idx[2], idx[1], idx[0]), &words);
+    }
+
+    std::vector<Run> runs;
+    auto emit = [&runs](int xBegin, int xEnd, int y, int z) {
+        if (!runs.empty()) {
+            auto& last = runs.back();
+            if (last.z == z && last.y == y && last.xEnd == xBegin) {
+                last.xEnd = xEnd;
+                return;
+            }
+        }
+        runs.push_back({xBegin, xEnd, y, z});
+    };
+
+    // Walk each slab of blocks one voxel slice and row at a time so the
+    // output is ordered by slice, then row
+    auto it = ordered.begin();
+    while (it != ordered.end()) {
+        const auto bz = std::get<0>(it->first);
+        auto slabEnd = it;
+        while (slabEnd != ordered.end() && std::get<0>(slabEnd->first) == bz) {
+            ++slabEnd;
+        }
+
+        for (int lz = 0; lz < BLOCK_DEPTH; ++lz) {
+            const auto z = bz * BLOCK_DEPTH + lz;
+            auto rowBegin = it;
+            while (rowBegin != slabEnd) {
+                const auto by = std::get<1>(rowBegin->first);
+                auto rowEnd = rowBegin;
+                while (rowEnd != slabEnd && std::get<1>(rowEnd->first) == by) {
+                    ++rowEnd;
+                }
+
+                for (int ly = 0; ly < BLOCK_HEIGHT; ++ly) {
+                    const auto y = by * BLOCK_HEIGHT + ly;
+                    for (auto b = rowBegin; b != rowEnd; ++b) {
+                        const auto x0 = std::get<2>(b->first) * BLOCK_WIDTH;
+                        auto bits = (*b->second)[lz * BLOCK_HEIGHT + ly];
+                        while (bits != 0) {
+                            int start = __builtin_ctzll(bits);
+                            // Length of the run of ones beginning at start
+                            auto shifted = bits >> start;
+                            int len = (~shifted == 0)
+                                          ? BLOCK_WIDTH - start
+                                          : __builtin_ctzll(~shifted);
+                            emit(x0 + start, x0 + start + len, y, z);
+                            if (start + len >= BLOCK_WIDTH) {
+                                break;
+                            }
+                            bits &= ~(((1ULL << len) - 1) << start);
+                        }
+                    }
+                }
+                rowBegin = rowEnd;
+            }
+        }
+        it = slabEnd;
+    }
+    return runs;
 }
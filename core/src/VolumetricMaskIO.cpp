@@ -0,0 +1,155 @@
+#include "vc/core/io/VolumetricMaskIO.hpp"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#include "vc/core/types/Exceptions.hpp"
+#include "vc/core/util/String.hpp"
+
+using namespace volcart;
+
+namespace fs = volcart::filesystem;
+namespace vio = volcart::io;
+
+namespace
+{
+// One presence bit per block row
+constexpr std::size_t PRESENCE_WORDS = VolumetricMask::BLOCK_WORDS / 64;
+using Presence = std::array<std::uint64_t, PRESENCE_WORDS>;
+}  // namespace
+
+void vio::WriteVolumetricMask(
+    const fs::path& path, const VolumetricMask& mask)
+{
+    std::ofstream outfile{path.string(), std::ios::binary};
+    if (!outfile.is_open()) {
+        auto msg = "could not open file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+
+    // Header
+    std::stringstream ss;
+    ss << "filetype: volumetricmask" << '\n';
+    ss << "version: 1" << '\n';
+    ss << "block width: " << VolumetricMask::BLOCK_WIDTH << '\n';
+    ss << "block height: " << VolumetricMask::BLOCK_HEIGHT << '\n';
+    ss << "block depth: " << VolumetricMask::BLOCK_DEPTH << '\n';
+    ss << "blocks: " << mask.blocks_.size() << '\n';
+    ss << "<>" << '\n';
+    outfile << ss.rdbuf();
+
+    // Blocks: index, row presence bitmap, non-empty rows
+    std::vector<std::uint64_t> rows;
+    rows.reserve(VolumetricMask::BLOCK_WORDS);
+    for (const auto& [key, words] : mask.blocks_) {
+        auto idx = VolumetricMask::BlockIndex(key);
+        std::array<std::int32_t, 3> index{idx[0], idx[1], idx[2]};
+
+        Presence presence{};
+        rows.clear();
+        for (std::size_t w = 0; w < words.size(); ++w) {
+            if (words[w] != 0) {
+                presence[w / 64] |= 1ULL << (w % 64);
+                rows.push_back(words[w]);
+            }
+        }
+
+        outfile.write(
+            reinterpret_cast<const char*>(index.data()), sizeof(index));
+        outfile.write(
+            reinterpret_cast<const char*>(presence.data()), sizeof(presence));
+        outfile.write(
+            reinterpret_cast<const char*>(rows.data()),
+            static_cast<std::streamsize>(rows.size() * sizeof(rows[0])));
+    }
+
+    outfile.flush();
+    outfile.close();
+    if (outfile.fail()) {
+        auto msg = "failure writing file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+}
+
+auto vio::ReadVolumetricMask(const fs::path& path) -> VolumetricMask::Pointer
+{
+    std::ifstream infile{path.string(), std::ios::binary};
+    if (!infile.is_open()) {
+        auto msg = "could not open file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+
+    std::string fileType;
+    int version{0};
+    std::array<int, 3> blockSize{0, 0, 0};
+    std::size_t numBlocks{0};
+    bool terminated{false};
+    std::string line;
+    while (std::getline(infile, line)) {
+        trim(line);
+        if (line == "<>") {
+            terminated = true;
+            break;
+        }
+        auto strs = split(line, ':');
+        if (strs.size() != 2) {
+            continue;
+        }
+        trim(strs[0]);
+        trim(strs[1]);
+
+        if (strs[0] == "filetype") {
+            fileType = strs[1];
+        } else if (strs[0] == "version") {
+            version = std::stoi(strs[1]);
+        } else if (strs[0] == "block width") {
+            blockSize[0] = std::stoi(strs[1]);
+        } else if (strs[0] == "block height") {
+            blockSize[1] = std::stoi(strs[1]);
+        } else if (strs[0] == "block depth") {
+            blockSize[2] = std::stoi(strs[1]);
+        } else if (strs[0] == "blocks") {
+            numBlocks = std::stoul(strs[1]);
+        }
+    }
+
+    // Sanity check. Do we have a valid header?
+    if (!terminated or fileType != "volumetricmask") {
+        throw IOException("File mismatch. File is not VolumetricMask.");
+    } else if (version != 1) {
+        auto msg = "Version mismatch. VolumetricMask file version is " +
+                   std::to_string(version) + ", processing version is 1.";
+        throw IOException(msg);
+    } else if (
+        blockSize[0] != VolumetricMask::BLOCK_WIDTH or
+        blockSize[1] != VolumetricMask::BLOCK_HEIGHT or
+        blockSize[2] != VolumetricMask::BLOCK_DEPTH) {
+        throw IOException("Unsupported VolumetricMask block size");
+    }
+
+    auto mask = VolumetricMask::New();
+    mask->blocks_.reserve(numBlocks);
+    for (std::size_t b = 0; b < numBlocks; ++b) {
+        std::array<std::int32_t, 3> index{};
+        Presence presence{};
+        infile.read(reinterpret_cast<char*>(index.data()), sizeof(index));
+        infile.read(reinterpret_cast<char*>(presence.data()), sizeof(presence));
+        auto key = VolumetricMask::BlockKeyFromIndex(
+            index[0], index[1], index[2]);
+        auto& words = mask->blocks_[key];
+        for (std::size_t w = 0; w < words.size(); ++w) {
+            if ((presence[w / 64] >> (w % 64)) & 1ULL) {
+                infile.read(
+                    reinterpret_cast<char*>(&words[w]), sizeof(words[w]));
+            }
+        }
+        if (infile.fail()) {
+            auto msg = "failure reading file '" + path.string() + "'";
+            throw IOException(msg);
+        }
+    }
+
+    return mask;
+}
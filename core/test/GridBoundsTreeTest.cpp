@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "vc/core/util/Surface.hpp"
+
+namespace
+{
+// Grid size, not a multiple of the patch size
+constexpr int GRID_W = 37;
+constexpr int GRID_H = 23;
+// Small patches so the tree has several levels
+constexpr int PATCH_SIZE = 4;
+
+// Wavy grid with a hole of invalid (-1) points
+auto MakeGrid() -> cv::Mat_<cv::Vec3f>
+{
+    cv::Mat_<cv::Vec3f> points(GRID_H, GRID_W);
+    for (int y = 0; y < GRID_H; ++y) {
+        for (int x = 0; x < GRID_W; ++x) {
+            points(y, x) = {
+                100.0f + 2.5f * x, 200.0f + 1.5f * y,
+                300.0f + 10.0f * std::sin(0.3f * x + 0.2f * y)};
+        }
+    }
+    points(cv::Rect(5, 4, 3, 2)) = cv::Vec3f(-1, -1, -1);
+    return points;
+}
+
+// Patches cover their border points, so a rect contains br() as well
+auto Covers(const cv::Rect& patch, int x, int y) -> bool
+{
+    return x >= patch.x && x <= patch.br().x && y >= patch.y &&
+           y <= patch.br().y;
+}
+
+// Signed distance range of the bounding box of the valid points in a patch
+auto BoxRange(
+    const cv::Mat_<cv::Vec3f>& points,
+    const cv::Rect& patch,
+    const PlaneSurface& plane,
+    float& lo,
+    float& hi) -> bool
+{
+    cv::Vec3f boxLo{FLT_MAX, FLT_MAX, FLT_MAX};
+    cv::Vec3f boxHi{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    bool any = false;
+    for (int y = patch.y; y <= patch.br().y; ++y) {
+        for (int x = patch.x; x <= patch.br().x; ++x) {
+            const auto& p = points(y, x);
+            if (p[0] == -1) {
+                continue;
+            }
+            any = true;
+            for (int c = 0; c < 3; ++c) {
+                boxLo[c] = std::min(boxLo[c], p[c]);
+                boxHi[c] = std::max(boxHi[c], p[c]);
+            }
+        }
+    }
+    lo = FLT_MAX;
+    hi = -FLT_MAX;
+    for (int i = 0; i < 8; ++i) {
+        cv::Vec3f corner{
+            i & 1 ? boxHi[0] : boxLo[0], i & 2 ? boxHi[1] : boxLo[1],
+            i & 4 ? boxHi[2] : boxLo[2]};
+        auto d = plane.scalarp(corner);
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    return any;
+}
+}  // namespace
+
+// planePatches returns exactly the patches a brute-force scan finds near
+// the plane: every point close to the plane is covered, and every returned
+// patch has a box that reaches the plane
+TEST(GridBoundsTree, PlanePatchesMatchBruteForce)
+{
+    const auto points = ::MakeGrid();
+    GridBoundsTree tree(points, PATCH_SIZE);
+    EXPECT_EQ(tree.patchSize(), PATCH_SIZE);
+
+    constexpr float dist = 2;
+    std::vector<PlaneSurface> planes{
+        {{0, 0, 305}, {0, 0, 1}},
+        {{140, 215, 300}, {1, 0, 1}},
+        {{120, 210, 295}, {0.2f, 1, 0.5f}},
+        {{0, 0, 400}, {0, 0, 1}}};
+    for (auto& plane : planes) {
+        auto patches = tree.planePatches(&plane, dist);
+
+        // Patches are unique and inside the grid
+        for (std::size_t i = 0; i < patches.size(); ++i) {
+            const auto& patch = patches[i];
+            EXPECT_EQ(
+                patch & cv::Rect(0, 0, GRID_W - 1, GRID_H - 1), patch);
+            for (std::size_t j = i + 1; j < patches.size(); ++j) {
+                EXPECT_NE(patch, patches[j]);
+            }
+
+            // The box of the valid points in a patch reaches the plane
+            float lo{0};
+            float hi{0};
+            ASSERT_TRUE(::BoxRange(points, patch, plane, lo, hi))
+                << "patch " << patch << " has no valid points";
+            EXPECT_LE(lo, dist + 1e-3f) << "patch " << patch;
+            EXPECT_GE(hi, -dist - 1e-3f) << "patch " << patch;
+        }
+
+        // Every point close to the plane lies in a returned patch
+        int close = 0;
+        for (int y = 0; y < GRID_H; ++y) {
+            for (int x = 0; x < GRID_W; ++x) {
+                const auto& p = points(y, x);
+                if (p[0] == -1 || std::abs(plane.scalarp(p)) >= dist) {
+                    continue;
+                }
+                ++close;
+                auto covered = std::any_of(
+                    patches.begin(), patches.end(),
+                    [&](const cv::Rect& r) { return ::Covers(r, x, y); });
+                EXPECT_TRUE(covered) << "point (" << x << ", " << y << ")";
+            }
+        }
+
+        // The far plane touches nothing
+        if (close == 0) {
+            EXPECT_TRUE(patches.empty());
+        }
+    }
+}
+
+// pointTo finds a surface point at least as close as the nearest grid point
+TEST(GridBoundsTree, PointToMatchesBruteForce)
+{
+    const auto points = ::MakeGrid();
+    QuadSurface surf(points, {1, 1});
+
+    // Interior grid points away from the hole, on and off the surface
+    std::vector<cv::Vec3f> targets;
+    for (const cv::Point p :
+         {cv::Point{2, 2}, cv::Point{33, 3}, cv::Point{10, 18},
+          cv::Point{30, 19}, cv::Point{20, 11}}) {
+        targets.push_back(points(p));
+        targets.push_back(points(p) + cv::Vec3f{0, 0, 3});
+    }
+
+    for (const auto& tgt : targets) {
+        float bruteForce = FLT_MAX;
+        for (const auto& p : points) {
+            if (p[0] != -1) {
+                bruteForce = std::min(
+                    bruteForce, static_cast<float>(cv::norm(p - tgt)));
+            }
+        }
+
+        // th of 0 never stops early, so the whole tree is searched
+        auto* ptr = surf.pointer();
+        auto dist = surf.pointTo(ptr, tgt, 0);
+        EXPECT_LE(dist, bruteForce + 1e-3f) << "target " << tgt;
+        EXPECT_GE(dist, 0) << "target " << tgt;
+
+        // The pointer is left at the returned point
+        auto found = surf.coord(ptr);
+        EXPECT_NEAR(cv::norm(found - tgt), dist, 1e-3f) << "target " << tgt;
+        delete ptr;
+    }
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <nlohmann/json.hpp>
+#include <opencv2/core.hpp>
+
+#include "vc/core/filesystem.hpp"
+#include "vc/core/util/Surface.hpp"
+
+namespace fs = volcart::filesystem;
+
+namespace
+{
+// Grid size, not a multiple of anything the format aligns to
+constexpr int GRID_W = 37;
+constexpr int GRID_H = 23;
+
+// Wavy grid with a hole of invalid (-1) points
+auto MakeGrid() -> cv::Mat_<cv::Vec3f>
+{
+    cv::Mat_<cv::Vec3f> points(GRID_H, GRID_W);
+    for (int y = 0; y < GRID_H; ++y) {
+        for (int x = 0; x < GRID_W; ++x) {
+            points(y, x) = {
+                100.0f + 2.5f * x, 200.0f + 1.5f * y,
+                300.0f + 10.0f * std::sin(0.3f * x + 0.2f * y)};
+        }
+    }
+    points(cv::Rect(5, 4, 3, 2)) = cv::Vec3f(-1, -1, -1);
+    return points;
+}
+
+// Read the json header of a vcqs file
+auto ReadHeader(const fs::path& path) -> nlohmann::json
+{
+    std::ifstream in(path.string(), std::ios::binary);
+    char magic[8];
+    in.read(magic, sizeof(magic));
+    EXPECT_EQ(std::string(magic, sizeof(magic)), "VCQS0001");
+    std::uint64_t headerLen;
+    in.read(reinterpret_cast<char*>(&headerLen), sizeof(headerLen));
+    std::string header(headerLen, '\0');
+    in.read(&header[0], headerLen);
+    EXPECT_TRUE(in.good());
+    return nlohmann::json::parse(header);
+}
+}  // namespace
+
+// Points, scale and header metadata survive writing and loading a vcqs file
+TEST(QuadSurfaceVcqs, RoundTrip)
+{
+    const fs::path path("vc_core_QuadSurfaceVcqs_RoundTrip.vcqs");
+    fs::remove(path);
+
+    const auto points = ::MakeGrid();
+    const cv::Vec2f scale{0.05f, 0.1f};
+    QuadSurface surf(points, scale);
+    ASSERT_TRUE(write_quad_to_vcqs(&surf, path.string()));
+
+    std::unique_ptr<QuadSurface> loaded(load_quad_from_vcqs(path.string()));
+    ASSERT_NE(loaded, nullptr);
+
+    // Points
+    auto result = loaded->rawPoints();
+    ASSERT_EQ(result.size(), points.size());
+    for (int y = 0; y < GRID_H; ++y) {
+        for (int x = 0; x < GRID_W; ++x) {
+            EXPECT_EQ(result(y, x), points(y, x))
+                << "at (" << x << ", " << y << ")";
+        }
+    }
+
+    // Scale
+    EXPECT_EQ(loaded->scale(), scale);
+
+    // Metadata
+    cv::Vec3f lo{FLT_MAX, FLT_MAX, FLT_MAX};
+    cv::Vec3f hi{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (const auto& p : points) {
+        if (p[0] == -1) {
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+    auto header = ::ReadHeader(path);
+    EXPECT_EQ(header["version"].get<int>(), 1);
+    EXPECT_EQ(header["dtype"].get<std::string>(), "<f4");
+    EXPECT_EQ(header["width"].get<int>(), GRID_W);
+    EXPECT_EQ(header["height"].get<int>(), GRID_H);
+    EXPECT_EQ(header["scale"][0].get<float>(), scale[0]);
+    EXPECT_EQ(header["scale"][1].get<float>(), scale[1]);
+    for (int c = 0; c < 3; ++c) {
+        EXPECT_EQ(header["bbox"][0][c].get<float>(), lo[c]);
+        EXPECT_EQ(header["bbox"][1][c].get<float>(), hi[c]);
+    }
+
+    // The grid starts page aligned and ends the file
+    auto dataOffset = header["data_offset"].get<std::size_t>();
+    EXPECT_EQ(dataOffset % 4096, 0u);
+    EXPECT_EQ(
+        fs::file_size(path), dataOffset + GRID_W * GRID_H * sizeof(cv::Vec3f));
+
+    // The loaded surface maps the same surface positions
+    auto* ptr = surf.pointer();
+    auto* loadedPtr = loaded->pointer();
+    for (const cv::Vec3f offset : {cv::Vec3f{0, 0, 0}, cv::Vec3f{-120, 50, 0},
+                                   cv::Vec3f{200, -80, 0}}) {
+        EXPECT_EQ(loaded->coord(loadedPtr, offset), surf.coord(ptr, offset))
+            << "at offset " << offset;
+    }
+    delete ptr;
+    delete loadedPtr;
+}
+
+// Shared grids of a mapped surface stay readable after the surface is freed
+TEST(QuadSurfaceVcqs, SharedPointsOutliveSurface)
+{
+    const fs::path path("vc_core_QuadSurfaceVcqs_Shared.vcqs");
+    fs::remove(path);
+
+    const auto points = ::MakeGrid();
+    QuadSurface surf(points, {0.05f, 0.1f});
+    ASSERT_TRUE(write_quad_to_vcqs(&surf, path.string()));
+
+    std::unique_ptr<QuadSurface> loaded(load_quad_from_vcqs(path.string()));
+    ASSERT_NE(loaded, nullptr);
+    auto shared = loaded->sharedPoints();
+    loaded.reset();
+
+    ASSERT_EQ(shared->size(), points.size());
+    EXPECT_EQ(cv::norm(*shared, points, cv::NORM_INF), 0);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "vc/core/filesystem.hpp"
+#include "vc/core/math/StructureTensor.hpp"
+#include "vc/core/math/StructureTensorField.hpp"
+#include "vc/core/types/Volume.hpp"
+
+using namespace volcart;
+namespace fs = volcart::filesystem;
+
+namespace
+{
+// Edge length of the synthetic volume
+constexpr int VOL_SIZE = 40;
+// Block size of the field, small enough for queries to span several blocks
+constexpr int BLOCK_SIZE = 16;
+// Wavelength of the synthetic sheets in voxels
+constexpr double WAVELENGTH = 10.0;
+
+// Normal of the synthetic sheets
+auto SheetNormal() -> cv::Vec3d { return cv::normalize(cv::Vec3d{1, 2, 0.5}); }
+
+// Write a volume of parallel, sinusoidal sheets and load it back from disk
+auto MakeSheetVolume() -> Volume::Pointer
+{
+    const fs::path volPath("vc_core_StructureTensorField_Sheets");
+    fs::remove_all(volPath);
+    fs::create_directories(volPath);
+
+    auto vol = Volume::New(volPath, "sheets", "Sheets");
+    vol->setSliceWidth(VOL_SIZE);
+    vol->setSliceHeight(VOL_SIZE);
+    vol->setNumberOfSlices(VOL_SIZE);
+    vol->setVoxelSize(1);
+    vol->setMin(0);
+    vol->setMax(65535);
+
+    const auto n = SheetNormal();
+    for (int z = 0; z < VOL_SIZE; ++z) {
+        cv::Mat_<std::uint16_t> slice(VOL_SIZE, VOL_SIZE);
+        for (int y = 0; y < VOL_SIZE; ++y) {
+            for (int x = 0; x < VOL_SIZE; ++x) {
+                auto d = cv::Vec3d(x, y, z).dot(n);
+                slice(y, x) = static_cast<std::uint16_t>(
+                    32768 + 20000 * std::sin(2 * M_PI * d / WAVELENGTH));
+            }
+        }
+        vol->setSliceData(z, slice, false);
+    }
+    vol->saveMetadata();
+
+    return Volume::New(volPath);
+}
+
+// Absolute cosine between two directions
+auto AbsCos(const cv::Vec3d& a, const cv::Vec3d& b) -> double
+{
+    return std::abs(cv::normalize(a).dot(cv::normalize(b)));
+}
+}  // namespace
+
+// Dominant eigenvectors of the field agree with the per-voxel functions
+TEST(StructureTensorField, MatchesComputeEigenPairs)
+{
+    auto vol = ::MakeSheetVolume();
+    constexpr int radius = 2;
+    auto field = StructureTensorField::New(vol, radius, 3, ::BLOCK_SIZE);
+
+    // Interior positions on and off block boundaries
+    for (int z = 8; z < ::VOL_SIZE - 8; z += 5) {
+        for (int y = 8; y < ::VOL_SIZE - 8; y += 7) {
+            for (int x = 8; x < ::VOL_SIZE - 8; x += 3) {
+                auto expected = ComputeVoxelEigenPairs(vol, x, y, z, radius);
+                auto result = field->eigenPairsAt(cv::Vec3d(x, y, z));
+                EXPECT_GT(AbsCos(result[0].second, expected[0].second), 0.98)
+                    << "at (" << x << ", " << y << ", " << z << ")";
+                EXPECT_GT(AbsCos(result[0].second, ::SheetNormal()), 0.98)
+                    << "at (" << x << ", " << y << ", " << z << ")";
+
+                cv::Vec3d p(x + 0.3, y + 0.6, z + 0.45);
+                expected = ComputeSubvoxelEigenPairs(vol, p, radius);
+                result = field->eigenPairsAt(p);
+                EXPECT_GT(AbsCos(result[0].second, expected[0].second), 0.98)
+                    << "at " << p;
+            }
+        }
+    }
+}
+
+// Subvoxel queries interpolate the voxel tensors
+TEST(StructureTensorField, SubvoxelInterpolation)
+{
+    auto vol = ::MakeSheetVolume();
+    auto field = StructureTensorField::New(vol, 1, 3, ::BLOCK_SIZE);
+
+    // Integer positions, including the last voxel of a block
+    for (int x : {10, ::BLOCK_SIZE - 1, ::BLOCK_SIZE}) {
+        auto voxel = field->structureTensorAt(x, 12, 20);
+        auto subvoxel = field->structureTensorAt(cv::Vec3d(x, 12, 20));
+        EXPECT_LT(cv::norm(voxel - subvoxel), 1e-6 * cv::norm(voxel));
+    }
+
+    // Midpoint across a block boundary
+    auto a = field->structureTensorAt(::BLOCK_SIZE - 1, 12, 20);
+    auto b = field->structureTensorAt(::BLOCK_SIZE, 12, 20);
+    auto mid = field->structureTensorAt(cv::Vec3d(::BLOCK_SIZE - 0.5, 12, 20));
+    EXPECT_LT(cv::norm(0.5 * (a + b) - mid), 1e-5 * cv::norm(mid));
+
+    // Outside of the volume
+    auto outside = field->structureTensorAt(cv::Vec3d(-1, 12, 20));
+    EXPECT_EQ(cv::norm(outside), 0);
+}
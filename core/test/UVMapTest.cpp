@@ -162,10 +162,37 @@ TEST(UVMapTest, WriteAndRead)
     EXPECT_EQ(uvMapClone.ratio().height, uvMap.ratio().height);
     EXPECT_EQ(uvMapClone.ratio().aspect, uvMap.ratio().aspect);
 
-    for (const auto& m : uvMapClone.as_map()) {
-        const auto& id = m.first;
-        const auto& uv = m.second;
-        EXPECT_EQ(uv, uvMap.get(id));
+    EXPECT_EQ(uvMapClone.extent(), uvMap.extent());
+    for (std::size_t id = 0; id < uvMap.extent(); id++) {
+        EXPECT_EQ(uvMapClone.contains(id), uvMap.contains(id));
+        EXPECT_EQ(uvMapClone.get(id), uvMap.get(id));
+    }
+}
+
+TEST(UVMapTest, Float32IO)
+{
+    // Fill a single-precision UVMap
+    UVMap uvMap;
+    uvMap.setPrecision(UVMap::Precision::Float32);
+    uvMap.ratio(10, 5);
+    for (std::size_t id = 0; id < 100; id += 2) {
+        uvMap.set(id, {id / 100., 1. - id / 100.});
+    }
+    EXPECT_EQ(uvMap.size(), 50);
+    EXPECT_EQ(uvMap.extent(), 99);
+    EXPECT_FALSE(uvMap.contains(1));
+    EXPECT_EQ(uvMap.get(1), NULL_MAPPING);
+
+    // Write and read the UVMap
+    io::WriteUVMap("WriteUVMapFloat32.uvm", uvMap);
+    auto uvMapClone = io::ReadUVMap("WriteUVMapFloat32.uvm");
+
+    EXPECT_EQ(uvMapClone.precision(), UVMap::Precision::Float32);
+    EXPECT_EQ(uvMapClone.size(), uvMap.size());
+    EXPECT_EQ(uvMapClone.extent(), uvMap.extent());
+    for (std::size_t id = 0; id < uvMap.extent(); id++) {
+        EXPECT_EQ(uvMapClone.contains(id), uvMap.contains(id));
+        EXPECT_EQ(uvMapClone.get(id), uvMap.get(id));
     }
 }
 
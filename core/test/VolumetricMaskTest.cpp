@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "vc/core/io/VolumetricMaskIO.hpp"
+#include "vc/core/types/VolumetricMask.hpp"
+
+using namespace volcart;
+
+using Voxel = VolumetricMask::Voxel;
+
+static auto Sorted(std::vector<Voxel> v) -> std::vector<Voxel>
+{
+    std::sort(v.begin(), v.end(), [](const auto& a, const auto& b) {
+        return std::tie(a[2], a[1], a[0]) < std::tie(b[2], b[1], b[0]);
+    });
+    return v;
+}
+
+TEST(VolumetricMask, SetAndTest)
+{
+    VolumetricMask mask;
+    EXPECT_TRUE(mask.empty());
+
+    // Include voxels on block edges and at negative positions
+    std::vector<Voxel> voxels{
+        {0, 0, 0}, {63, 31, 31}, {64, 32, 32}, {-1, -1, -1}, {100, 5, 70}};
+    mask.setIn(voxels);
+
+    EXPECT_FALSE(mask.empty());
+    EXPECT_EQ(mask.size(), voxels.size());
+    for (const auto& v : voxels) {
+        EXPECT_TRUE(mask.isIn(v));
+    }
+    EXPECT_TRUE(mask.isOut(Voxel{1, 0, 0}));
+    EXPECT_TRUE(mask.isOut(Voxel{-2, -1, -1}));
+    EXPECT_TRUE(mask.isIn(cv::Vec3d{100.5, 5.9, 70.1}));
+
+    mask.setOut(Voxel{63, 31, 31});
+    EXPECT_TRUE(mask.isOut(Voxel{63, 31, 31}));
+    EXPECT_EQ(mask.size(), voxels.size() - 1);
+
+    mask.clear();
+    EXPECT_TRUE(mask.empty());
+}
+
+TEST(VolumetricMask, Iteration)
+{
+    std::vector<Voxel> voxels;
+    for (int z = 30; z < 35; ++z) {
+        for (int x = 60; x < 70; ++x) {
+            voxels.emplace_back(x, z % 3, z);
+        }
+    }
+    VolumetricMask mask(voxels);
+
+    std::vector<Voxel> iterated(mask.begin(), mask.end());
+    EXPECT_EQ(Sorted(iterated), Sorted(voxels));
+    EXPECT_EQ(Sorted(mask.as_vector()), Sorted(voxels));
+}
+
+TEST(VolumetricMask, Slices)
+{
+    cv::Mat slice = cv::Mat::zeros(100, 150, CV_8UC1);
+    cv::rectangle(slice, {10, 20}, {140, 25}, cv::Scalar::all(255), -1);
+
+    VolumetricMask mask;
+    mask.setSliceIn(slice, 7);
+    EXPECT_EQ(mask.size(), static_cast<std::size_t>(cv::countNonZero(slice)));
+    EXPECT_TRUE(mask.isIn(Voxel{70, 22, 7}));
+    EXPECT_TRUE(mask.isOut(Voxel{70, 22, 8}));
+
+    cv::Mat diff = mask.slice(7, slice.size()) != slice;
+    EXPECT_EQ(cv::countNonZero(diff), 0);
+    EXPECT_EQ(cv::countNonZero(mask.slice(8, slice.size())), 0);
+}
+
+TEST(VolumetricMask, Runs)
+{
+    VolumetricMask mask;
+    // One run which crosses a block boundary and one single voxel
+    for (int x = 50; x < 80; ++x) {
+        mask.setIn(Voxel{x, 3, 40});
+    }
+    mask.setIn(Voxel{5, 2, 40});
+    mask.setIn(Voxel{1, 1, 1});
+
+    auto runs = mask.as_runs();
+    ASSERT_EQ(runs.size(), 3U);
+    EXPECT_EQ(runs[0].z, 1);
+    EXPECT_EQ(runs[0].xBegin, 1);
+    EXPECT_EQ(runs[0].xEnd, 2);
+    EXPECT_EQ(runs[1].y, 2);
+    EXPECT_EQ(runs[1].xBegin, 5);
+    EXPECT_EQ(runs[1].xEnd, 6);
+    EXPECT_EQ(runs[2].y, 3);
+    EXPECT_EQ(runs[2].z, 40);
+    EXPECT_EQ(runs[2].xBegin, 50);
+    EXPECT_EQ(runs[2].xEnd, 80);
+}
+
+TEST(VolumetricMask, Merge)
+{
+    VolumetricMask a(std::vector<Voxel>{{0, 0, 0}, {1, 0, 0}});
+    VolumetricMask b(std::vector<Voxel>{{1, 0, 0}, {2, 0, 0}, {500, 0, 0}});
+    a.merge(b);
+
+    EXPECT_EQ(a.size(), 4U);
+    EXPECT_TRUE(a.isIn(Voxel{0, 0, 0}));
+    EXPECT_TRUE(a.isIn(Voxel{2, 0, 0}));
+    EXPECT_TRUE(a.isIn(Voxel{500, 0, 0}));
+    EXPECT_EQ(b.size(), 3U);
+}
+
+TEST(VolumetricMask, WriteRead)
+{
+    VolumetricMask mask;
+    for (int z = 0; z < 40; ++z) {
+        for (int x = 0; x < 200; x += 3) {
+            mask.setIn(Voxel{x, z * 2, z});
+        }
+    }
+    mask.setIn(Voxel{-5, -10, -20});
+
+    io::WriteVolumetricMask("vc_core_VolumetricMask.vcvm", mask);
+    auto read = io::ReadVolumetricMask("vc_core_VolumetricMask.vcvm");
+
+    EXPECT_EQ(read->size(), mask.size());
+    EXPECT_EQ(Sorted(read->as_vector()), Sorted(mask.as_vector()));
+}
@@ -718,9 +718,9 @@ public:
 };
 
 /**
- * @brief Load a VolumetricMask from a .vcps file
+ * @brief Load a VolumetricMask from a .vcvm or .vcps file
  *
- * Given file must be of type=int, dim=3.
+ * A .vcps file must be of type=int, dim=3.
  *
  * @ingroup Graph
  */
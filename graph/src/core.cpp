@@ -2,8 +2,10 @@
 
 #include <nlohmann/json.hpp>
 
+#include "vc/core/io/FileFilters.hpp"
 #include "vc/core/io/PointSetIO.hpp"
 #include "vc/core/io/UVMapIO.hpp"
+#include "vc/core/io/VolumetricMaskIO.hpp"
 #include "vc/core/util/FloatComparison.hpp"
 #include "vc/core/util/Logging.hpp"
 
@@ -593,6 +595,16 @@ PPMPropertiesNode::PPMPropertiesNode()
     registerOutputPort("cellMap", cellMap);
 }
 
+// Load a mask from either a .vcvm mask or a .vcps point set
+static auto ReadMask(const fs::path& path) -> VolumetricMask::Pointer
+{
+    if (io::FileExtensionFilter(path, {"vcvm"})) {
+        return io::ReadVolumetricMask(path);
+    }
+    using psio = PointSetIO<cv::Vec3i>;
+    return VolumetricMask::New(psio::ReadPointSet(path));
+}
+
 LoadVolumetricMaskNode::LoadVolumetricMaskNode()
     : smgl::Node{true}
     , path{&path_}
@@ -605,8 +617,7 @@ LoadVolumetricMaskNode::LoadVolumetricMaskNode()
     compute = [&]() {
         Logger()->debug(
             "[graph.core] loading volumetric mask: {}", path_.string());
-        using psio = PointSetIO<cv::Vec3i>;
-        mask_ = VolumetricMask::New(psio::ReadPointSet(path_));
+        mask_ = ReadMask(path_);
     };
     usesCacheDir = [&]() { return cacheArgs_; };
 }
@@ -616,12 +627,8 @@ auto LoadVolumetricMaskNode::serialize_(bool useCache, const fs::path& cacheDir)
 {
     smgl::Metadata meta{{"path", path_.string()}, {"cacheArgs", cacheArgs_}};
     if (useCache and cacheArgs_ and mask_) {
-        using psio = PointSetIO<cv::Vec3i>;
-        PointSet<cv::Vec3i> ps;
-        ps.append(*mask_);
-
-        auto file = path_.filename().replace_extension(".vcps");
-        psio::WritePointSet(cacheDir / file, ps);
+        auto file = path_.filename().replace_extension(".vcvm");
+        io::WriteVolumetricMask(cacheDir / file, *mask_);
         meta["cachedFile"] = file.string();
     }
     return meta;
@@ -634,9 +641,8 @@ void LoadVolumetricMaskNode::deserialize_(
     cacheArgs_ = meta["cacheArgs"].get<bool>();
 
     if (meta.contains("cachedFile")) {
-        using psio = PointSetIO<cv::Vec3i>;
         auto file = meta["cachedFile"].get<std::string>();
-        mask_ = VolumetricMask::New(psio::ReadPointSet(cacheDir / file));
+        mask_ = ReadMask(cacheDir / file);
     }
 }
 
@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <iostream>
 
+#include "vc/core/math/StructureTensorField.hpp"
 #include "vc/core/types/OrderedPointSet.hpp"
 #include "vc/core/types/VolumePkg.hpp"
 #include "vc/segmentation/ChainSegmentationAlgorithm.hpp"
@@ -103,6 +104,34 @@ public:
      */
     void setMaterialThickness(double m) { materialThickness_ = m; }
 
+    /**
+     * @brief Estimate normals from a cached StructureTensorField
+     *
+     * Off by default. When enabled, compute() builds a StructureTensorField
+     * of the input Volume with the structure tensor radius derived from the
+     * material thickness, and the per-particle normals are taken from it
+     * instead of from ComputeSubvoxelEigenPairs(). Neighboring particles and
+     * consecutive iterations then share the tensors of a block instead of
+     * each rebuilding its own neighborhood. The field works on raw
+     * intensities and computes gradients at the window edge from the real
+     * neighboring voxels, so the normals can differ slightly from the
+     * default path.
+     */
+    void setUseStructureTensorField(bool b) { useStructureTensorField_ = b; }
+
+    /**
+     * @brief Score candidate moves with an incrementally updated ChainEnergy
+     *
+     * Off by default. When disabled, every candidate position is scored by
+     * refitting a FittedCurve to the whole chain and evaluating
+     * EnergyMetrics::TotalEnergy() on it. When enabled, the energy of the
+     * unfitted chain is kept in a ChainEnergy and a candidate is scored by
+     * recomputing only the terms around the moved particle. Since the chain
+     * is not refit, the optimizer can settle on different positions than
+     * with the default scoring.
+     */
+    void setUseIncrementalEnergy(bool b) { useIncrementalEnergy_ = b; }
+
     /** @brief Set the reslice window size */
     void setResliceSize(int s) { resliceSize_ = s; }
 
@@ -134,6 +163,20 @@ private:
     auto estimate_normal_at_index_(const FittedCurve& currentCurve, int index)
         -> cv::Vec3d;
 
+    /**
+     * @brief Copy the voxels sampled by the reslice of a particle
+     *
+     * Returns the bounding box of the reslice as a run of slice regions,
+     * @p origin receives the voxel position of its first element. See
+     * Volume::reslice().
+     */
+    auto load_reslice_slab_(
+        const Voxel& center, const cv::Vec3d& normal, cv::Vec3i& origin) const
+        -> std::vector<cv::Mat>;
+
+    /** @brief Radius of the structure tensor window, from the thickness */
+    [[nodiscard]] auto structure_tensor_radius_() const -> int;
+
     /**
      * @brief Debug: Draw curve on slice image
      * @param curve Input curve
@@ -178,6 +221,12 @@ private:
     bool visualize_{false};
     /** Number of curve optimization iterations */
     int numIters_{15};
+    /** Estimate normals from a StructureTensorField */
+    bool useStructureTensorField_{false};
+    /** Structure tensor field used when useStructureTensorField_ is set */
+    StructureTensorField::Pointer stField_;
+    /** Score candidate moves with a ChainEnergy */
+    bool useIncrementalEnergy_{false};
     /** Estimated material thickness in um */
     double materialThickness_{100};
     /** Window size for reslice */
@@ -7,7 +7,15 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core.hpp>
 
 #include "vc/core/types/OrderedPointSet.hpp"
 #include "vc/core/types/VolumePkg.hpp"
@@ -30,6 +38,14 @@ namespace volcart::segmentation
  *
  * Warning: This Algorithm is not deterministic and yields slightly different results each run.
  *
+ * Optical flow is computed on regions of interest which are snapped outward to
+ * a fixed grid. The normalized slice regions and flow fields of each run are
+ * cached, so neighboring curve segments which map to the same region share one
+ * flow computation, and the normalized region of the "next" slice is reused
+ * as the "current" region of the following step. While one step is being
+ * computed, the flow fields of the next step are computed in the background
+ * for the regions of the current curve.
+ *
  * @ingroup ofsc
  */
 class OpticalFlowSegmentationClass : public ChainSegmentationAlgorithm
@@ -236,6 +252,45 @@ private:
     auto create_final_pointset_(const std::vector<std::vector<Voxel>>& points)
         -> PointSet;
 
+    /** Normalized slice regions and the dense optical flow between them */
+    struct FlowField {
+        /** Pointer type */
+        using Pointer = std::shared_ptr<const FlowField>;
+        /** Normalized region of the current slice */
+        cv::Mat gray1;
+        /** Normalized region of the next slice */
+        cv::Mat gray2;
+        /** Optical flow from gray1 to gray2 */
+        cv::Mat flow;
+    };
+
+    /**
+     * @brief Get the optical flow region of interest of a set of points
+     *
+     * The bounding box of the points is padded and snapped outward to a grid
+     * so that nearby requests share cache entries.
+     */
+    auto flow_roi_(const std::vector<Voxel>& vs) const -> cv::Rect;
+
+    /** @brief Get the normalized, 8-bit region of a slice. Cached per run. */
+    auto normalized_roi_(int z, const cv::Rect& roi) -> cv::Mat;
+
+    /** @brief Get the optical flow between two slices. Cached per run. */
+    auto flow_field_(int z1, int z2, const cv::Rect& roi) -> FlowField::Pointer;
+
+    /**
+     * @brief Compute the flow fields of a slice pair in the background
+     *
+     * Waits for the previous background computation to finish first.
+     */
+    void prefetch_flow_fields_(int z1, int z2, std::vector<cv::Rect> rois);
+
+    /** @brief Drop cached data which does not involve the given slices */
+    void prune_flow_cache_(int z1, int z2);
+
+    /** @brief Wait for background computations and clear the flow cache */
+    void clear_flow_cache_();
+
     /** Default minimum energy gradient */
     constexpr static double DEFAULT_MIN_ENERGY_GRADIENT = 1e-7;
 
@@ -283,5 +338,18 @@ private:
     Chain reSegStartingChain_;
     volcart::OrderedPointSet<cv::Vec3d> masterCloud_;
     mutable std::shared_mutex display_mutex_;
+
+    /** Flow cache key: z1, z2, and the region's x, y, width, and height */
+    using FlowKey = std::tuple<int, int, int, int, int, int>;
+    /** Normalized region cache key: z, and the region's x, y, width, height */
+    using RoiKey = std::tuple<int, int, int, int, int>;
+    /** Flow fields of the current run */
+    std::map<FlowKey, std::shared_future<FlowField::Pointer>> flowCache_;
+    /** Normalized slice regions of the current run */
+    std::map<RoiKey, std::shared_future<cv::Mat>> roiCache_;
+    /** Guards flowCache_ and roiCache_ */
+    std::mutex flowCacheMutex_;
+    /** Background flow computation for the next step */
+    std::future<void> prefetch_;
 };
 }  // namespace volcart::segmentation
\ No newline at end of file
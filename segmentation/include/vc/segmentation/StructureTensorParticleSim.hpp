@@ -79,11 +79,18 @@ private:
      */
     double rkStepSize_{0.5};
 
-    /** Calculate the propagation force direction for each point in the chain */
-    ForceChain calc_prop_forces_(ParticleChain c);
+    /** Calculate the propagation force direction of the i-th point */
+    Force prop_force_(const ParticleChain& c, std::size_t i) const;
 
-    /** Calculate the corrective spring force for each point in the chain */
-    ForceChain calc_spring_forces_(ParticleChain c);
+    /** Calculate the corrective spring force of the i-th point */
+    Force spring_force_(const ParticleChain& c, std::size_t i) const;
+
+    /**
+     * Calculate the normalized sum of the propagation and spring forces for
+     * each point in the chain. This is the derivative of one Runge-Kutta
+     * stage. Points are evaluated in parallel.
+     */
+    ForceChain calc_stage_forces_(const ParticleChain& c) const;
 
     /** Add the current chain to the final result point set */
     void add_chain_to_result_();
@@ -41,8 +41,6 @@
 #include <cmath>
 #include <utility>
 #include <numeric>
-#include <thread>
-#include <mutex>
 #include "vc/segmentation/lrps/Common.hpp"
 
 using Eigen::VectorXd;
@@ -55,8 +53,7 @@ private:
     VectorXd range_xy_;
     Eigen::VectorXd subsegment_lengths_;
     Eigen::VectorXd cumulative_lengths_;
-    std::mutex mtx;
-    int nr_points;
+    int nr_points{0};
 
     void cubic_spline_interpolation(const VectorXd& x, const VectorXd& y,
                                     VectorXd& a, VectorXd& b,
@@ -92,66 +89,26 @@ std::pair<Eigen::VectorXd, Eigen::VectorXd> compute_subsegment_lengths_2D(
         const Eigen::VectorXd& d_y,
         int subseg_count = 10);
 
-std::pair<double, double> evaluate_spline_at_t_2D(
-        double t,
-        const Eigen::VectorXd& range_xy,
-        const Eigen::VectorXd& a_x,
-        const Eigen::VectorXd& b_x,
-        const Eigen::VectorXd& c_x,
-        const Eigen::VectorXd& d_x,
-        const Eigen::VectorXd& a_y,
-        const Eigen::VectorXd& b_y,
-        const Eigen::VectorXd& c_y,
-        const Eigen::VectorXd& d_y,
-        const Eigen::VectorXd& subsegment_lengths,
-        const Eigen::VectorXd& cumulative_lengths) const;
+std::pair<double, double> evaluate_spline_at_t_2D(double t) const;
+
+// Evaluate the spline at target_length along the curve, which lies in subsegment idx
+std::pair<double, double> evaluate_subsegment_2D(int idx, double target_length) const;
 
 public:
     CubicMultithreadedSpline() = default;
     CubicMultithreadedSpline(const VectorXd& x, const VectorXd& y);
     CubicMultithreadedSpline(const std::vector<Voxel>& vs);
     ~CubicMultithreadedSpline();
-    // Custom copy constructor
-    CubicMultithreadedSpline(const CubicMultithreadedSpline& other) {
-        a_x_ = other.a_x_;
-        b_x_ = other.b_x_;
-        c_x_ = other.c_x_;
-        d_x_ = other.d_x_;
-        a_y_ = other.a_y_;
-        b_y_ = other.b_y_;
-        c_y_ = other.c_y_;
-        d_y_ = other.d_y_;
-        range_xy_ = other.range_xy_;
-        subsegment_lengths_ = other.subsegment_lengths_;
-        cumulative_lengths_ = other.cumulative_lengths_;
-        nr_points = other.nr_points;
-        
-        // mtx is deliberately not copied
-    }
-    
-    // Custom copy assignment operator
-    CubicMultithreadedSpline& operator=(const CubicMultithreadedSpline& other) {
-        if (this != &other) {
-            a_x_ = other.a_x_;
-            b_x_ = other.b_x_;
-            c_x_ = other.c_x_;
-            d_x_ = other.d_x_;
-            a_y_ = other.a_y_;
-            b_y_ = other.b_y_;
-            c_y_ = other.c_y_;
-            d_y_ = other.d_y_;
-            range_xy_ = other.range_xy_;
-            subsegment_lengths_ = other.subsegment_lengths_;
-            cumulative_lengths_ = other.cumulative_lengths_;
-            nr_points = other.nr_points;
-            
-            // mtx is deliberately not copied
-        }
-        
-        return *this;
-    }
+    CubicMultithreadedSpline(const CubicMultithreadedSpline& other) = default;
+    CubicMultithreadedSpline(CubicMultithreadedSpline&& other) noexcept = default;
+    CubicMultithreadedSpline& operator=(const CubicMultithreadedSpline& other) = default;
+    CubicMultithreadedSpline& operator=(CubicMultithreadedSpline&& other) noexcept = default;
+
     // Evaluate the spline at a given value of t
     Pixel operator()(double t) const;
+
+    // Evaluate the spline at ascending values of t, writing x and y to separate arrays
+    void operator()(const std::vector<double>& ts, double* xs, double* ys) const;
 };
 
 #endif
\ No newline at end of file
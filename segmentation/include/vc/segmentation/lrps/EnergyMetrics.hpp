@@ -2,6 +2,9 @@
 
 /** @file */
 
+#include <cstddef>
+#include <vector>
+
 #include "vc/segmentation/lrps/FittedCurve.hpp"
 
 namespace volcart::segmentation
@@ -10,6 +13,10 @@ namespace volcart::segmentation
  * @class EnergyMetrics
  * @brief A collection of energy metrics for evaluating a FittedCurve
  *
+ * The metrics are evaluated over the curve's resampled points, which are
+ * copied into per-thread structure-of-arrays buffers so the derivative and
+ * segment length kernels vectorize and repeated calls do not allocate.
+ *
  * @ingroup lrps
  */
 class EnergyMetrics
@@ -66,6 +73,20 @@ public:
         double beta,
         double delta);
 
+    /**
+     * @brief Combinatorial energy metric for a chain of points
+     *
+     * Same as TotalEnergy(const FittedCurve&, ...), but evaluated directly on
+     * @p points without fitting a curve to them first.
+     */
+    static double TotalEnergy(
+        const std::vector<Voxel>& points,
+        double alpha,
+        double k1,
+        double k2,
+        double beta,
+        double delta);
+
     /**
      * @brief Sum of the absolute value of local curvature at each point along
      * the curve
@@ -90,4 +111,98 @@ public:
      */
     static double WindowedArcLength(const FittedCurve& curve, int windowSize);
 };
+
+/**
+ * @class ChainEnergy
+ * @brief Incrementally updated EnergyMetrics::TotalEnergy() of a chain of
+ * points
+ *
+ * Caches the per-point terms of the energy so that the energy of the chain
+ * after moving a single point can be evaluated by recomputing only the terms
+ * whose derivative stencils or segments contain that point. The global
+ * normalizations (curvature range and average point distance) are kept as
+ * running sums. A full scan is only needed when a move removes the current
+ * curvature minimum or maximum.
+ *
+ * The energy matches EnergyMetrics::TotalEnergy(const std::vector<Voxel>&,
+ * ...) up to floating-point rounding. Unlike the FittedCurve overload, no
+ * curve is refit after a move.
+ *
+ * @ingroup lrps
+ */
+class ChainEnergy
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @throws std::invalid_argument if @p points is not empty and has fewer
+     * than 4 points, the minimum for EnergyMetrics::WindowedArcLength() with
+     * a window size of 3
+     */
+    ChainEnergy(
+        const std::vector<Voxel>& points,
+        double alpha,
+        double k1,
+        double k2,
+        double beta,
+        double delta);
+
+    /** @brief Get the number of points in the chain */
+    std::size_t size() const { return x_.size(); }
+
+    /** @brief Get the current position of a point */
+    Voxel point(std::size_t index) const;
+
+    /** @brief Get the current positions of all points */
+    std::vector<Voxel> points() const;
+
+    /** @brief Get the total energy of the current chain */
+    double energy() const { return energy_; }
+
+    /** @brief Get the total energy of the chain if a point were moved */
+    double energyIfMoved(std::size_t index, const Voxel& v) const;
+
+    /**
+     * @brief Move a point and update the cached energy
+     *
+     * @return The new total energy
+     */
+    double move(std::size_t index, const Voxel& v);
+
+private:
+    /** Changes to the cached terms caused by moving one point */
+    struct Update;
+
+    /** Evaluate the move of point @p index to @p v */
+    void evaluate_move_(std::size_t index, const Voxel& v, Update& u) const;
+    /** Combine the running sums into the total energy */
+    double combine_(
+        double internalSum,
+        double absKSum,
+        double minK,
+        double maxK,
+        double length,
+        double windowSum) const;
+
+    /** Energy weights */
+    double alpha_, k1_, k2_, beta_, delta_;
+    /** Point coordinates */
+    std::vector<double> x_, y_, z_;
+    /** Per-point active contour internal energy terms */
+    std::vector<double> internal_;
+    /** Per-point absolute curvatures */
+    std::vector<double> absK_;
+    /** Segment lengths between consecutive points */
+    std::vector<double> seg_;
+    /** Number of arc length windows which include each segment */
+    std::vector<double> segWeight_;
+    /** Running sums of the cached terms */
+    double internalSum_{0}, absKSum_{0}, length_{0}, windowSum_{0};
+    /** Curvature range and where it is attained */
+    double minK_{0}, maxK_{0};
+    std::size_t minKIdx_{0}, maxKIdx_{0};
+    /** Cached total energy */
+    double energy_{0};
+};
 }  // namespace volcart::segmentation
@@ -84,5 +84,9 @@ public:
 
     /**@brief Calculate the arc length of the curve  */
     double arclength() const;
+
+private:
+    /** Evaluate the spline at ascending t-values */
+    std::vector<Voxel> sample_at_(const std::vector<double>& ts) const;
 };
 }  // namespace volcart::segmentation
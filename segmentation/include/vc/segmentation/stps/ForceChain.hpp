@@ -32,6 +32,9 @@ public:
     /** @brief Constructor with chain initialization */
     explicit ForceChain(Chain c) : data_{std::move(c)} {}
 
+    /** @brief Constructor with a chain of `n` default elements */
+    explicit ForceChain(std::size_t n) : data_(n) {}
+
     /**
      * @brief Add a list of offset vectors to each element in the chain
      *
@@ -45,10 +48,16 @@ public:
     auto operator*=(const double& rhs) -> ForceChain&;
 
     /** @brief Element access operator */
-    auto operator[](std::size_t i) { return data_[i]; }
+    auto operator[](std::size_t i) -> Force& { return data_[i]; }
 
     /** @copydoc operator[](std::size_t) */
-    auto operator[](std::size_t i) const { return data_[i]; }
+    auto operator[](std::size_t i) const -> const Force& { return data_[i]; }
+
+    /** @brief Get a pointer to the contiguous element storage */
+    auto data() -> Force* { return data_.data(); }
+
+    /** @copydoc data() */
+    auto data() const -> const Force* { return data_.data(); }
 
     /** @brief Returns an iterator to the beginning of the chain */
     auto begin() { return data_.begin(); }
@@ -81,6 +90,12 @@ public:
     /** @brief Empties and resets the chain */
     void clear() { data_.clear(); }
 
+    /** @brief Reserve storage for `n` elements */
+    void reserve(std::size_t n) { data_.reserve(n); }
+
+    /** @brief Resize the chain to `n` elements */
+    void resize(std::size_t n) { data_.resize(n); }
+
     /**
      * @brief Normalize the magnitude of each Force in the chain
      *
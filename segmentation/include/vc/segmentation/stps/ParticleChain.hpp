@@ -31,6 +31,9 @@ public:
     /** @brief Constructor with chain initialization */
     explicit ParticleChain(Chain c) : data_{std::move(c)} {}
 
+    /** @brief Constructor with a chain of `n` default elements */
+    explicit ParticleChain(std::size_t n) : data_(n) {}
+
     /**
      * @brief Add a list of offset vectors to each element in the chain
      *
@@ -44,10 +47,16 @@ public:
     auto operator*=(const double& rhs) -> ParticleChain&;
 
     /** @brief Element access operator */
-    auto operator[](std::size_t i) { return data_[i]; }
+    auto operator[](std::size_t i) -> Particle& { return data_[i]; }
 
     /** @copydoc operator[](std::size_t) */
-    auto operator[](std::size_t i) const { return data_[i]; }
+    auto operator[](std::size_t i) const -> const Particle& { return data_[i]; }
+
+    /** @brief Get a pointer to the contiguous element storage */
+    auto data() -> Particle* { return data_.data(); }
+
+    /** @copydoc data() */
+    auto data() const -> const Particle* { return data_.data(); }
 
     /** @brief Returns an iterator to the beginning of the chain */
     auto begin() { return data_.begin(); }
@@ -80,6 +89,12 @@ public:
     /** @brief Empties and resets the chain */
     void clear() { data_.clear(); }
 
+    /** @brief Reserve storage for `n` elements */
+    void reserve(std::size_t n) { data_.reserve(n); }
+
+    /** @brief Resize the chain to `n` elements */
+    void resize(std::size_t n) { data_.resize(n); }
+
 private:
     /** Data storage vector */
     Chain data_;
@@ -2,6 +2,7 @@
 
 /** @file */
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -14,7 +15,7 @@ namespace volcart::segmentation
 {
 
 /** Get the list of a voxel's eight neighbors */
-std::vector<cv::Vec3i> GetNeighbors(const cv::Vec3i& v);
+std::array<cv::Vec3i, 8> GetNeighbors(const cv::Vec3i& v);
 
 /** Calculate the Euclidean distance between two voxels */
 int EuclideanDistance(const cv::Vec3i& start, const cv::Vec3i& end);
@@ -46,7 +47,10 @@ auto Median(Container c)
  * Run flood fill using the provided set of seed points
  *
  * Returns the contiguous set of points which fall within the range [low, high]
- * and which are no more than `bound` distance from an initial seed.
+ * and which are no more than `bound` distance from an initial seed. Each point
+ * belongs to the seed whose fill reaches it first and is only accepted if it is
+ * within `bound` of that seed. The fill grows horizontal spans and tracks
+ * visited pixels in a dense per-slice map.
  */
 std::vector<cv::Vec3i> DoFloodFill(
     const std::vector<cv::Vec3i>& pts,
@@ -3,7 +3,6 @@
 #include <map>
 #include <opencv2/imgproc.hpp>
 
-#include "vc/core/util/Iteration.hpp"
 #include "vc/segmentation/tff/FloodFill.hpp"
 
 using namespace volcart;
@@ -47,64 +46,80 @@ auto ComputeVolumetricMask::compute() -> VolumetricMask::Pointer
         seedsBySlice[sliceIdx].emplace_back(pt[0], pt[1], pt[2]);
     }
 
+    // Only slices with seeds produce any output
+    std::vector<std::size_t> slices;
+    slices.reserve(seedsBySlice.size());
+    for (const auto& [zIndex, seeds] : seedsBySlice) {
+        slices.push_back(zIndex);
+    }
+
     // Signal progress has begun
     progressStarted();
+    const auto sliceRange = endSlice + 1 - startSlice;
+    std::size_t done{0};
+
+    // Every slice depends only on its own seeds, so slices are processed in
+    // parallel. Each thread loads its own slices and fills a private mask
+    // which is merged into the output once the thread runs out of work.
+#pragma omp parallel
+    {
+        VolumetricMask localMask;
+
+#pragma omp for schedule(dynamic) nowait
+        for (std::size_t idx = 0; idx < slices.size(); ++idx) {
+            const auto zIndex = slices[idx];
+            const auto& seedPoints = seedsBySlice.at(zIndex);
+
+            // Get the current (single) slice image (Of type Mat)
+            auto slice = vol_->getSliceDataCopy(static_cast<int>(zIndex));
+
+            // Estimate thickness of page from every seed point.
+            std::vector<std::size_t> estimates;
+            for (const auto& v : seedPoints) {
+                estimates.emplace_back(MeasureThickness(
+                    v, slice, low_, high_, measureVertically_, maxRadius_));
+            }
 
-    // Iterate over z-slices
-    for (auto zIndex : range(startSlice, endSlice + 1)) {
-        // Update progress
-        progressUpdated(zIndex - startSlice);
-
-        // Get this slice's seed points
-        VoxelList seedPoints;
-        try {
-            seedPoints = seedsBySlice.at(zIndex);
-        } catch (const std::out_of_range& e) {
-            // No seeds for this slice. Skip.
-            continue;
-        }
-
-        // Get the current (single) slice image (Of type Mat)
-        auto slice = vol_->getSliceDataCopy(zIndex);
-
-        // Estimate thickness of page from every seed point.
-        std::vector<std::size_t> estimates;
-        for (const auto& v : seedPoints) {
-            estimates.emplace_back(MeasureThickness(
-                v, slice, low_, high_, measureVertically_, maxRadius_));
-        }
-
-        // Calculate the median thickness.
-        // Choose the median of the measurements to be the boundary for every
-        // point.
-        auto bound = Median(estimates);
+            // Calculate the median thickness.
+            // Choose the median of the measurements to be the boundary for
+            // every point.
+            auto bound = Median(estimates);
+
+            // Do flood-fill with the given seed points to the estimated
+            // thickness.
+            auto sliceMask =
+                DoFloodFill(seedPoints, bound, slice, low_, high_);
+
+            // Apply closing to fill holes and gaps.
+            if (enableClosing_) {
+                // Convert mask to a binary image so we can apply closing
+                cv::Mat binaryImg = cv::Mat::zeros(slice.size(), CV_8UC1);
+                for (const Voxel& v : sliceMask) {
+                    binaryImg.at<std::uint8_t>(v[1], v[0]) = 255;
+                }
 
-        // Do flood-fill with the given seed points to the estimated thickness.
-        auto sliceMask = DoFloodFill(seedPoints, bound, slice, low_, high_);
+                cv::Mat kernel = cv::Mat::ones(kernel_, kernel_, CV_8U);
+                cv::Mat closedImg;
+                cv::morphologyEx(
+                    binaryImg, closedImg, cv::MORPH_CLOSE, kernel);
 
-        // Apply closing to fill holes and gaps.
-        if (enableClosing_) {
-            // Convert mask to a binary image so we can apply closing
-            cv::Mat binaryImg = cv::Mat::zeros(slice.size(), CV_8UC1);
-            for (const Voxel& v : sliceMask) {
-                binaryImg.at<std::uint8_t>(v[1], v[0]) = 255;
+                // Save to this thread's mask
+                localMask.setSliceIn(closedImg, static_cast<int>(zIndex));
+            } else {
+                localMask.setIn(sliceMask);
             }
 
-            cv::Mat kernel = cv::Mat::ones(kernel_, kernel_, CV_8U);
-            cv::Mat closedImg;
-            cv::morphologyEx(binaryImg, closedImg, cv::MORPH_CLOSE, kernel);
-
-            // Save to the full volume mask
-            for (const auto p : range2D(closedImg.rows, closedImg.cols)) {
-                const auto& x = p.second;
-                const auto& y = p.first;
-                if (closedImg.at<std::uint8_t>(y, x) > 0) {
-                    mask_->setIn({x, y, zIndex});
-                }
+            // Update progress. Slices finish out of order, so report the
+            // completed fraction of the slice range.
+#pragma omp critical(progress)
+            {
+                ++done;
+                progressUpdated(done * sliceRange / slices.size());
             }
-        } else {
-            mask_->setIn(sliceMask);
         }
+
+#pragma omp critical(merge)
+        mask_->merge(localMask);
     }
     progressComplete();
     return mask_;
@@ -35,10 +35,11 @@
 #include <algorithm>
 #include <cmath>
 #include <utility>
+#include <tuple>
 #include <numeric>
-#include <thread>
-#include <mutex>
+#include <memory>
 #include <gsl/gsl_integration.h>
+#include <omp.h>
 
 
 #include "vc/segmentation/lrps/CubicMultithreadedSpline.hpp"
@@ -77,10 +78,31 @@ CubicMultithreadedSpline::~CubicMultithreadedSpline() {}
 
 // Evaluate the spline at a given value of t
 Pixel CubicMultithreadedSpline::operator()(double t) const {
-    auto [x, y] = evaluate_spline_at_t_2D(t, range_xy_, a_x_, b_x_, c_x_, d_x_, a_y_, b_y_, c_y_, d_y_, subsegment_lengths_, cumulative_lengths_);
+    auto [x, y] = evaluate_spline_at_t_2D(t);
     return Pixel(x, y); 
 }
 
+// Evaluate the spline at ascending values of t
+void CubicMultithreadedSpline::operator()(const std::vector<double>& ts, double* xs, double* ys) const {
+    if (ts.empty()) {
+        return;
+    }
+
+    // The target lengths ascend as well, so the subsegment search continues
+    // where the previous one ended instead of a binary search per t
+    const double* cumulative = cumulative_lengths_.data();
+    const int n = cumulative_lengths_.size();
+    double total_length = cumulative[n - 1];
+    int pos = 0;
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+        double target_length = total_length * ts[i];
+        while (pos < n && cumulative[pos] < target_length) {
+            ++pos;
+        }
+        std::tie(xs[i], ys[i]) = evaluate_subsegment_2D(std::max(pos - 1, 0), target_length);
+    }
+}
+
 void CubicMultithreadedSpline::cubic_spline_interpolation(const VectorXd& x, const VectorXd& y,
                                 VectorXd& a, VectorXd& b,
                                 VectorXd& c, VectorXd& d) {
@@ -140,7 +162,7 @@ void CubicMultithreadedSpline::windowed_spline_worker(const VectorXd& x, const V
         int idx_start = i - wnd_start_idx;
         int idx_end = std::min(i + window_size, (int)x.size()) - wnd_start_idx;
 
-        std::lock_guard<std::mutex> lock(mtx);
+        // Windows write disjoint ranges, so no locking is needed
         std::copy(a.data() + idx_start, a.data() + idx_end, a_vec.begin() + i);
         std::copy(b.data() + idx_start, b.data() + idx_end, b_vec.begin() + i);
         std::copy(c.data() + idx_start, c.data() + idx_end, c_vec.begin() + i);
@@ -158,39 +180,22 @@ void CubicMultithreadedSpline::windowed_spline_with_buffer_multithreaded(const V
     int n = x.size();
     std::vector<double> a_vec(n, 0.0), b_vec(n, 0.0), c_vec(n, 0.0), d_vec(n, 0.0);
 
-    std::vector<std::thread> threads;
-
-    if (num_threads == -1) {
-        int num_available_threads = static_cast<int>(std::thread::hardware_concurrency());
-        num_threads = num_available_threads;
-    }
-
+    // Single windows, e.g. all chains of up to window_size points, are fit on
+    // the calling thread. Otherwise the windows are distributed over the
+    // OpenMP worker pool, which persists between calls, instead of spawning
+    // new threads for every spline.
     int steps = std::ceil(((double)n) / ((double)window_size));
-    int steps_per_thread = steps / num_threads;
-    int remainder = steps % num_threads;
-    int current_step = 0;
-    for (int i = 0; i < num_threads; ++i) {
-        int start_idx = current_step * window_size;
-        int end_idx = (current_step + steps_per_thread) * window_size;
-        if (i < remainder) {
-            end_idx += window_size;
-            current_step += 1;
-        }
-        end_idx = std::min(end_idx, n);
-        
-        current_step += steps_per_thread;
-        if (start_idx >= end_idx) {
-            continue;
-        }
-
-        threads.emplace_back(std::thread(&CubicMultithreadedSpline::windowed_spline_worker, this, std::ref(x), std::ref(y),
-                                        std::ref(a_vec), std::ref(b_vec), std::ref(c_vec),
-                                        std::ref(d_vec), start_idx, end_idx,
-                                        window_size, buffer_size));
+    bool parallel = steps > 1 && num_threads != 1 && !omp_in_parallel();
+    if (num_threads == -1) {
+        num_threads = omp_get_max_threads();
     }
 
-    for (auto& t : threads) {
-        t.join();
+#pragma omp parallel for schedule(dynamic) num_threads(std::max(num_threads, 1)) if(parallel)
+    for (int step = 0; step < steps; ++step) {
+        int start_idx = step * window_size;
+        int end_idx = std::min(start_idx + window_size, n);
+        windowed_spline_worker(x, y, a_vec, b_vec, c_vec, d_vec, start_idx,
+                               end_idx, window_size, buffer_size);
     }
 
     a_total = Eigen::Map<VectorXd>(a_vec.data(), a_vec.size());
@@ -210,14 +215,17 @@ double CubicMultithreadedSpline::integrand2D(double t, void *params) {
 }
 
 double CubicMultithreadedSpline::spline_length_2D(double b_x, double c_x, double d_x, double b_y, double c_y, double d_y, double t0, double t_sub0, double t_sub1) {
-    gsl_integration_workspace *w = gsl_integration_workspace_alloc(1000);
+    // Reuse one integration workspace per thread instead of allocating one
+    // for each of the many subsegments
+    thread_local std::unique_ptr<gsl_integration_workspace, decltype(&gsl_integration_workspace_free)> workspace(
+        gsl_integration_workspace_alloc(1000), &gsl_integration_workspace_free);
+    auto* w = workspace.get();
     double result, error;
     double coeffs[7] = {b_x, c_x, d_x, b_y, c_y, d_y, t0};
     gsl_function F;
     F.function = &CubicMultithreadedSpline::integrand2D;
     F.params = &coeffs;
     gsl_integration_qags(&F, t_sub0, t_sub1, 0, 1e-8, 1000, w, &result, &error);
-    gsl_integration_workspace_free(w);
     return fabs(result);
 }
 
@@ -248,49 +256,41 @@ std::pair<Eigen::VectorXd, Eigen::VectorXd> CubicMultithreadedSpline::compute_su
             Eigen::Map<Eigen::VectorXd>(cumulative_lengths.data(), cumulative_lengths.size())};
 }
 
-std::pair<double, double> CubicMultithreadedSpline::evaluate_spline_at_t_2D(
-        double t,
-        const Eigen::VectorXd& range_xy,
-        const Eigen::VectorXd& a_x,
-        const Eigen::VectorXd& b_x,
-        const Eigen::VectorXd& c_x,
-        const Eigen::VectorXd& d_x,
-        const Eigen::VectorXd& a_y,
-        const Eigen::VectorXd& b_y,
-        const Eigen::VectorXd& c_y,
-        const Eigen::VectorXd& d_y,
-        const Eigen::VectorXd& subsegment_lengths,
-        const Eigen::VectorXd& cumulative_lengths) const {
+std::pair<double, double> CubicMultithreadedSpline::evaluate_spline_at_t_2D(double t) const {
 
-    double total_length = cumulative_lengths[cumulative_lengths.size() - 1];
+    double total_length = cumulative_lengths_[cumulative_lengths_.size() - 1];
     double target_length = total_length * t;
     
     // Find the correct subsegment using binary search
-    auto it = std::lower_bound(cumulative_lengths.data(), cumulative_lengths.data() + cumulative_lengths.size(), target_length);
-    int idx = std::distance(cumulative_lengths.data(), it) - 1;
+    auto it = std::lower_bound(cumulative_lengths_.data(), cumulative_lengths_.data() + cumulative_lengths_.size(), target_length);
+    int idx = std::distance(cumulative_lengths_.data(), it) - 1;
     if (idx == -1) {
         idx = 0;
     }
     
-    int seg_count = range_xy.size() - 1;
-    int subseg_count = subsegment_lengths.size() / seg_count;
+    return evaluate_subsegment_2D(idx, target_length);
+}
+
+std::pair<double, double> CubicMultithreadedSpline::evaluate_subsegment_2D(int idx, double target_length) const {
+    int seg_count = range_xy_.size() - 1;
+    int subseg_count = subsegment_lengths_.size() / seg_count;
     int segment_idx = idx / subseg_count;
     int subseg_idx = idx % subseg_count;
     
     // Calculate the remaining length to target within this subsegment
-    double remaining_length = target_length - cumulative_lengths[idx];
+    double remaining_length = target_length - cumulative_lengths_[idx];
     
     // Compute the x position at t
-    double range_xy0 = range_xy[segment_idx], range_xy1 = range_xy[segment_idx + 1];
+    double range_xy0 = range_xy_[segment_idx], range_xy1 = range_xy_[segment_idx + 1];
     double range_xy_sub0 = range_xy0 + (range_xy1 - range_xy0) * (static_cast<double>(subseg_idx) / subseg_count);
     double range_xy_sub1 = range_xy0 + (range_xy1 - range_xy0) * (static_cast<double>(subseg_idx + 1) / subseg_count);
-    double range_xy_t = range_xy_sub0 + (range_xy_sub1 - range_xy_sub0) * (remaining_length / subsegment_lengths[idx]);
+    double range_xy_t = range_xy_sub0 + (range_xy_sub1 - range_xy_sub0) * (remaining_length / subsegment_lengths_[idx]);
     
     double d_range_xy = range_xy_t - range_xy0;
     // Compute the x position at range_xy_t
-    double x_t = a_x[segment_idx] + b_x[segment_idx]*d_range_xy + c_x[segment_idx]*pow(d_range_xy, 2) + d_x[segment_idx]*pow(d_range_xy, 3);
+    double x_t = a_x_[segment_idx] + b_x_[segment_idx]*d_range_xy + c_x_[segment_idx]*pow(d_range_xy, 2) + d_x_[segment_idx]*pow(d_range_xy, 3);
     // Compute the y position at range_xy_t
-    double y_t = a_y[segment_idx] + b_y[segment_idx]*d_range_xy + c_y[segment_idx]*pow(d_range_xy, 2) + d_y[segment_idx]*pow(d_range_xy, 3);
+    double y_t = a_y_[segment_idx] + b_y_[segment_idx]*d_range_xy + c_y_[segment_idx]*pow(d_range_xy, 2) + d_y_[segment_idx]*pow(d_range_xy, 3);
 
     
     return {x_t, y_t};
@@ -1,12 +1,313 @@
 #include "vc/segmentation/lrps/EnergyMetrics.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
-#include <iostream>
-
-#include "vc/segmentation/lrps/Derivative.hpp"
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 using namespace volcart::segmentation;
 
+namespace
+{
+// Window size of the arc length term of TotalEnergy()
+constexpr int TOTAL_ENERGY_WINDOW = 3;
+
+// Structure-of-arrays copy of a chain of points and its per-point terms
+struct ChainBuffer {
+    std::vector<double> x, y, z;
+    std::vector<double> internal, absK;
+    std::vector<double> seg;
+
+    void assign(const std::vector<Voxel>& vs)
+    {
+        const auto n = vs.size();
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        internal.resize(n);
+        absK.resize(n);
+        seg.resize(std::max<std::size_t>(n, 1) - 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = vs[i][0];
+            y[i] = vs[i][1];
+            z[i] = vs[i][2];
+        }
+    }
+};
+
+// Per-thread buffer which is reused between calls so evaluating a metric
+// does not allocate once the buffer has grown to the chain size
+auto Scratch(const std::vector<Voxel>& vs) -> ChainBuffer&
+{
+    thread_local ChainBuffer buffer;
+    buffer.assign(vs);
+    return buffer;
+}
+
+// Read access to one coordinate of a chain in which one point was moved
+struct MovedCoords {
+    const double* v;
+    int moved;
+    double value;
+    auto operator[](int j) const -> double
+    {
+        return (j == moved) ? value : v[j];
+    }
+};
+
+// First and second derivative using the five-point stencils. See
+// D1FivePointStencil() and D2FivePointStencil().
+template <class Get>
+inline void FivePoint(const Get& v, int i, double& d1, double& d2)
+{
+    // clang-format off
+    d1 = (1.0/12) * v[i - 2] +
+         (-2.0/3) * v[i - 1] +
+          (2.0/3) * v[i + 1] +
+        (-1.0/12) * v[i + 2];
+    d2 = (-1.0/12) * v[i - 2] +
+          (4.0/3) * v[i - 1] +
+         (-5.0/2) * v[i] +
+          (4.0/3) * v[i + 1] +
+        (-1.0/12) * v[i + 2];
+    // clang-format on
+}
+
+// First and second derivative with the stencils D1At() and D2At() select
+// for hstep = 1. D2At() reads out of bounds on chains with fewer than three
+// points, so the second derivative is zero there.
+template <class Get>
+inline void DerivativesAt(const Get& v, int i, int n, double& d1, double& d2)
+{
+    if (n < 2) {
+        d1 = d2 = 0;
+    } else if (i == 0) {
+        d1 = -v[0] + v[1];
+        d2 = (n < 3) ? 0 : v[0] + (-2.0) * v[1] + v[2];
+    } else if (i == n - 1) {
+        d1 = -v[i - 1] + v[i];
+        d2 = (n < 3) ? 0 : v[i - 2] + (-2.0) * v[i - 1] + v[i];
+    } else if (i == 1 || i == n - 2) {
+        d1 = (-0.5) * v[i - 1] + 0.5 * v[i + 1];
+        d2 = v[i - 1] + (-2.0) * v[i] + v[i + 1];
+    } else {
+        FivePoint(v, i, d1, d2);
+    }
+}
+
+// Squared norm of a derivative after NormalizeVector(), which leaves vectors
+// with a norm below 1e-5 unchanged. Written as a blend instead of a branch so
+// that the interior loop of ComputeTerms() vectorizes.
+inline auto NormalizedSq(double x, double y, double z) -> double
+{
+    auto sq = x * x + y * y + z * z;
+    return 1.0 + double(sq < 1e-10) * (sq - 1.0);
+}
+
+// The terms of a single point
+struct PointTerms {
+    // Active contour internal energy
+    double internal;
+    // Absolute curvature of the xy-projection, see FittedCurve::curvature()
+    double absK;
+};
+
+inline auto Terms(
+    double dx1,
+    double dy1,
+    double dz1,
+    double dx2,
+    double dy2,
+    double dz2,
+    double k1,
+    double k2) -> PointTerms
+{
+    auto s = dx1 * dx1 + dy1 * dy1;
+    return {
+        k1 * NormalizedSq(dx1, dy1, dz1) + k2 * NormalizedSq(dx2, dy2, dz2),
+        std::abs((dx1 * dy2 - dy1 * dx2) / (s * std::sqrt(s)))};
+}
+
+template <class Get>
+inline auto TermsAt(
+    const Get& x,
+    const Get& y,
+    const Get& z,
+    int i,
+    int n,
+    double k1,
+    double k2) -> PointTerms
+{
+    double dx1, dy1, dz1, dx2, dy2, dz2;
+    DerivativesAt(x, i, n, dx1, dx2);
+    DerivativesAt(y, i, n, dy1, dy2);
+    DerivativesAt(z, i, n, dz1, dz2);
+    return Terms(dx1, dy1, dz1, dx2, dy2, dz2, k1, k2);
+}
+
+// Compute the terms of every point in a chain. Only the two points at each
+// end need a different stencil, so the interior runs as a single SIMD loop.
+void ComputeTerms(
+    const double* x,
+    const double* y,
+    const double* z,
+    int n,
+    double k1,
+    double k2,
+    double* internal,
+    double* absK)
+{
+    auto boundary = [&](int i) {
+        auto t = TermsAt(x, y, z, i, n, k1, k2);
+        internal[i] = t.internal;
+        absK[i] = t.absK;
+    };
+
+    for (int i = 0; i < std::min(2, n); ++i) {
+        boundary(i);
+    }
+    const int interiorEnd = n - 2;
+#pragma omp simd
+    for (int i = 2; i < interiorEnd; ++i) {
+        double dx1, dy1, dz1, dx2, dy2, dz2;
+        FivePoint(x, i, dx1, dx2);
+        FivePoint(y, i, dy1, dy2);
+        FivePoint(z, i, dz1, dz2);
+        auto t = Terms(dx1, dy1, dz1, dx2, dy2, dz2, k1, k2);
+        internal[i] = t.internal;
+        absK[i] = t.absK;
+    }
+    for (int i = std::max(2, n - 2); i < n; ++i) {
+        boundary(i);
+    }
+}
+
+inline auto SegmentLength(
+    double x0, double y0, double z0, double x1, double y1, double z1)
+    -> double
+{
+    auto dx = x1 - x0;
+    auto dy = y1 - y0;
+    auto dz = z1 - z0;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Compute the distance between every pair of consecutive points
+void ComputeSegments(
+    const double* x, const double* y, const double* z, int n, double* seg)
+{
+#pragma omp simd
+    for (int i = 0; i < n - 1; ++i) {
+        seg[i] =
+            SegmentLength(x[i], y[i], z[i], x[i + 1], y[i + 1], z[i + 1]);
+    }
+}
+
+auto Sum(const double* v, int n) -> double
+{
+    double sum{0};
+#pragma omp simd reduction(+ : sum)
+    for (int i = 0; i < n; ++i) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+// Range of the values in v, skipping the indices [skipLo, skipHi]
+struct Range {
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+    std::size_t minIdx{0};
+    std::size_t maxIdx{0};
+};
+
+auto FindRange(const double* v, int n, int skipLo = 0, int skipHi = -1)
+    -> Range
+{
+    Range r;
+    for (int i = 0; i < n; ++i) {
+        if (i == skipLo && skipHi >= skipLo) {
+            i = skipHi;
+            continue;
+        }
+        if (v[i] < r.min) {
+            r.min = v[i];
+            r.minIdx = i;
+        }
+        if (v[i] > r.max) {
+            r.max = v[i];
+            r.maxIdx = i;
+        }
+    }
+    return r;
+}
+
+// Mean of the absolute curvatures after NormalizeVector()
+auto MeanNormalizedCurvature(double sum, double min, double max, std::size_t n)
+    -> double
+{
+    // A single value which is not already in range is mapped to 1
+    if (n == 1) {
+        return (sum <= 1) ? sum : 1.0;
+    }
+    // Values which are already in [0, 1] are not rescaled
+    if (max <= 1) {
+        return sum / n;
+    }
+    return (sum - n * min) / (max - min) / n;
+}
+
+// Index of the segment covered by step k of an arc length window. Windows are
+// mirrored at the ends of the chain.
+inline auto WindowSegment(int k, int n) -> int
+{
+    if (k < 0) {
+        return -k - 1;
+    }
+    if (k + 1 >= n) {
+        return 2 * (n - 1) - k - 1;
+    }
+    return k;
+}
+
+// Sum of the segment lengths in the window centered at index
+inline auto WindowSum(const double* seg, int n, int index, int windowSize)
+    -> double
+{
+    const int windowRadius = windowSize / 2;
+    double sum = 0;
+    for (int k = index - windowRadius; k < index + windowRadius; ++k) {
+        sum += seg[WindowSegment(k, n)];
+    }
+    return sum;
+}
+
+void CheckWindow(int n, int index, int windowSize)
+{
+    if (index < 0 || index >= n) {
+        auto msg = "index '" + std::to_string(index) + "' outside curve range";
+        throw std::invalid_argument(msg);
+    } else if (windowSize < 0 || windowSize >= n) {
+        auto msg = "invalid windowSize";
+        throw std::invalid_argument(msg);
+    }
+}
+
+// Average windowed arc length of a chain, given its segment lengths
+auto MeanWindowedArcLength(const double* seg, int n, int windowSize) -> double
+{
+    double windowSum = 0;
+    for (int i = 0; i < n; ++i) {
+        windowSum += WindowSum(seg, n, i, windowSize);
+    }
+    double avgDist = Sum(seg, n - 1) / (n - 1);
+    return windowSum / avgDist / n;
+}
+}  // namespace
+
 // Calculates the active contour internal energy. See:
 // https://en.wikipedia.org/wiki/Active_contour_model#Internal_energy
 // Note: k1 and k2 are constant for all particles in the curve
@@ -17,16 +318,12 @@ auto EnergyMetrics::ActiveContourInternal(
         return 0;
     }
 
-    auto d1Current = NormalizeVector(D1(curve.points()));
-    auto d2Current = NormalizeVector(D2(curve.points()));
-
-    double intE = 0;
-    for (auto p : Zip(d1Current, d2Current)) {
-        intE += k1 * std::pow(cv::norm(p.first), 2) +
-                k2 * std::pow(cv::norm(p.second), 2);
-    }
-
-    return intE / (2 * curve.size());
+    auto& b = Scratch(curve.points());
+    const int n = b.x.size();
+    ComputeTerms(
+        b.x.data(), b.y.data(), b.z.data(), n, k1, k2, b.internal.data(),
+        b.absK.data());
+    return Sum(b.internal.data(), n) / (2 * curve.size());
 }
 
 // Amalgamation of energy metrics used parameterized by their coefficients.
@@ -39,9 +336,35 @@ auto EnergyMetrics::TotalEnergy(
     double beta,
     double delta) -> double
 {
-    auto intE = EnergyMetrics::ActiveContourInternal(curve, k1, k2);
-    auto kE = EnergyMetrics::AbsCurvatureSum(curve);
-    auto sE = EnergyMetrics::WindowedArcLength(curve, 3);
+    return TotalEnergy(curve.points(), alpha, k1, k2, beta, delta);
+}
+
+auto EnergyMetrics::TotalEnergy(
+    const std::vector<Voxel>& points,
+    double alpha,
+    double k1,
+    double k2,
+    double beta,
+    double delta) -> double
+{
+    if (points.empty()) {
+        return 0;
+    }
+
+    // All three metrics share one pass over the chain
+    const int n = points.size();
+    CheckWindow(n, 0, TOTAL_ENERGY_WINDOW);
+    auto& b = Scratch(points);
+    ComputeTerms(
+        b.x.data(), b.y.data(), b.z.data(), n, k1, k2, b.internal.data(),
+        b.absK.data());
+    ComputeSegments(b.x.data(), b.y.data(), b.z.data(), n, b.seg.data());
+
+    auto intE = Sum(b.internal.data(), n) / (2 * n);
+    auto range = FindRange(b.absK.data(), n);
+    auto kE = MeanNormalizedCurvature(
+        Sum(b.absK.data(), n), range.min, range.max, n);
+    auto sE = MeanWindowedArcLength(b.seg.data(), n, TOTAL_ENERGY_WINDOW);
     return alpha * intE + beta * kE + delta * sE;
 }
 
@@ -52,15 +375,14 @@ auto EnergyMetrics::AbsCurvatureSum(const FittedCurve& curve) -> double
         return 0;
     }
 
-    auto k = curve.curvature();
-    std::transform(std::begin(k), std::end(k), std::begin(k), [](auto e) {
-        return std::abs(e);
-    });
-    k = NormalizeVector(k);
-    return std::accumulate(
-               begin(k), end(k), 0.0,
-               [](double sum, double d) { return sum + d; }) /
-           curve.size();
+    auto& b = Scratch(curve.points());
+    const int n = b.x.size();
+    ComputeTerms(
+        b.x.data(), b.y.data(), b.z.data(), n, 0, 0, b.internal.data(),
+        b.absK.data());
+    auto range = FindRange(b.absK.data(), n);
+    return MeanNormalizedCurvature(
+        Sum(b.absK.data(), n), range.min, range.max, n);
 }
 
 // Determine arc length across a window of size 'windowSize' centered at
@@ -72,32 +394,14 @@ auto EnergyMetrics::LocalWindowedArcLength(
         return 0;
     }
 
-    if (index < 0 || index >= int(curve.size())) {
-        auto msg = "index '" + std::to_string(index) + "' outside curve range";
-        throw std::invalid_argument(msg);
-    } else if (windowSize < 0 || windowSize >= int(curve.size())) {
-        auto msg = "invalid windowSize";
-        throw std::invalid_argument(msg);
-    }
-
-    int windowRadius = windowSize / 2;
-    double sum = 0;
-    int lastIdx = curve.size() - 1;
-    for (int i = index - windowRadius; i < index + windowRadius; ++i) {
-        if (i < 0) {
-            sum += cv::norm(curve(-i), curve(-(i + 1)));
-        } else if (i >= int(curve.size()) || i + 1 >= int(curve.size())) {
-            int iDiff = i - lastIdx;
-            sum +=
-                cv::norm(curve(lastIdx - iDiff), curve(lastIdx - (iDiff + 1)));
-        } else {
-            sum += cv::norm(curve(i), curve(i + 1));
-        }
-    }
+    const int n = curve.size();
+    CheckWindow(n, index, windowSize);
+    auto& b = Scratch(curve.points());
+    ComputeSegments(b.x.data(), b.y.data(), b.z.data(), n, b.seg.data());
 
     // Average distance between 2 points on curve
-    double avgDist = curve.arclength() / (curve.size() - 1);
-    return sum / avgDist;
+    double avgDist = Sum(b.seg.data(), n - 1) / (n - 1);
+    return WindowSum(b.seg.data(), n, index, windowSize) / avgDist;
 }
 
 // Apply LocalWindowedArcLength across the entire curve
@@ -109,9 +413,225 @@ auto EnergyMetrics::WindowedArcLength(const FittedCurve& curve, int windowSize)
         return 0;
     }
 
-    double sum = 0;
-    for (std::size_t i = 0; i < curve.size(); ++i) {
-        sum += EnergyMetrics::LocalWindowedArcLength(curve, i, windowSize);
+    const int n = curve.size();
+    CheckWindow(n, 0, windowSize);
+    auto& b = Scratch(curve.points());
+    ComputeSegments(b.x.data(), b.y.data(), b.z.data(), n, b.seg.data());
+    return MeanWindowedArcLength(b.seg.data(), n, windowSize);
+}
+
+struct ChainEnergy::Update {
+    // Point terms [lo, hi] which change
+    int lo{0}, hi{-1};
+    std::array<double, 5> internal{};
+    std::array<double, 5> absK{};
+    // Segments [segLo, segHi] which change
+    int segLo{0}, segHi{-1};
+    std::array<double, 2> seg{};
+    // New running sums
+    double internalSum{0}, absKSum{0}, length{0}, windowSum{0};
+    Range range;
+    double energy{0};
+};
+
+ChainEnergy::ChainEnergy(
+    const std::vector<Voxel>& points,
+    double alpha,
+    double k1,
+    double k2,
+    double beta,
+    double delta)
+    : alpha_{alpha}, k1_{k1}, k2_{k2}, beta_{beta}, delta_{delta}
+{
+    if (points.empty()) {
+        return;
     }
-    return sum / curve.size();
+
+    const int n = points.size();
+    CheckWindow(n, 0, TOTAL_ENERGY_WINDOW);
+    x_.resize(n);
+    y_.resize(n);
+    z_.resize(n);
+    for (int i = 0; i < n; ++i) {
+        x_[i] = points[i][0];
+        y_[i] = points[i][1];
+        z_[i] = points[i][2];
+    }
+
+    internal_.resize(n);
+    absK_.resize(n);
+    ComputeTerms(
+        x_.data(), y_.data(), z_.data(), n, k1_, k2_, internal_.data(),
+        absK_.data());
+    seg_.resize(n - 1);
+    ComputeSegments(x_.data(), y_.data(), z_.data(), n, seg_.data());
+
+    // Every segment contributes to the arc length sum once for each window
+    // which covers it
+    segWeight_.assign(n - 1, 0);
+    const int windowRadius = TOTAL_ENERGY_WINDOW / 2;
+    for (int i = 0; i < n; ++i) {
+        for (int k = i - windowRadius; k < i + windowRadius; ++k) {
+            segWeight_[WindowSegment(k, n)] += 1;
+        }
+    }
+
+    internalSum_ = Sum(internal_.data(), n);
+    absKSum_ = Sum(absK_.data(), n);
+    length_ = Sum(seg_.data(), n - 1);
+    for (int i = 0; i < n - 1; ++i) {
+        windowSum_ += segWeight_[i] * seg_[i];
+    }
+    auto range = FindRange(absK_.data(), n);
+    minK_ = range.min;
+    maxK_ = range.max;
+    minKIdx_ = range.minIdx;
+    maxKIdx_ = range.maxIdx;
+    energy_ = combine_(
+        internalSum_, absKSum_, minK_, maxK_, length_, windowSum_);
+}
+
+auto ChainEnergy::point(std::size_t index) const -> Voxel
+{
+    return {x_.at(index), y_.at(index), z_.at(index)};
+}
+
+auto ChainEnergy::points() const -> std::vector<Voxel>
+{
+    std::vector<Voxel> vs;
+    vs.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+        vs.emplace_back(x_[i], y_[i], z_[i]);
+    }
+    return vs;
+}
+
+auto ChainEnergy::energyIfMoved(std::size_t index, const Voxel& v) const
+    -> double
+{
+    Update u;
+    evaluate_move_(index, v, u);
+    return u.energy;
+}
+
+auto ChainEnergy::move(std::size_t index, const Voxel& v) -> double
+{
+    Update u;
+    evaluate_move_(index, v, u);
+
+    x_[index] = v[0];
+    y_[index] = v[1];
+    z_[index] = v[2];
+    for (int j = u.lo; j <= u.hi; ++j) {
+        internal_[j] = u.internal[j - u.lo];
+        absK_[j] = u.absK[j - u.lo];
+    }
+    for (int j = u.segLo; j <= u.segHi; ++j) {
+        seg_[j] = u.seg[j - u.segLo];
+    }
+    internalSum_ = u.internalSum;
+    absKSum_ = u.absKSum;
+    length_ = u.length;
+    windowSum_ = u.windowSum;
+    minK_ = u.range.min;
+    maxK_ = u.range.max;
+    minKIdx_ = u.range.minIdx;
+    maxKIdx_ = u.range.maxIdx;
+    energy_ = u.energy;
+    return energy_;
+}
+
+void ChainEnergy::evaluate_move_(
+    std::size_t index, const Voxel& v, Update& u) const
+{
+    if (index >= size()) {
+        auto msg = "index '" + std::to_string(index) + "' outside chain range";
+        throw std::out_of_range(msg);
+    }
+
+    const int n = size();
+    const int i = index;
+    const MovedCoords cx{x_.data(), i, v[0]};
+    const MovedCoords cy{y_.data(), i, v[1]};
+    const MovedCoords cz{z_.data(), i, v[2]};
+
+    // The stencils of the points within two of the moved point include it
+    u.lo = std::max(0, i - 2);
+    u.hi = std::min(n - 1, i + 2);
+    u.internalSum = internalSum_;
+    u.absKSum = absKSum_;
+    Range window;
+    for (int j = u.lo; j <= u.hi; ++j) {
+        auto t = TermsAt(cx, cy, cz, j, n, k1_, k2_);
+        u.internal[j - u.lo] = t.internal;
+        u.absK[j - u.lo] = t.absK;
+        u.internalSum += t.internal - internal_[j];
+        u.absKSum += t.absK - absK_[j];
+        if (t.absK < window.min) {
+            window.min = t.absK;
+            window.minIdx = j;
+        }
+        if (t.absK > window.max) {
+            window.max = t.absK;
+            window.maxIdx = j;
+        }
+    }
+
+    // The curvature range of the unchanged points is only known without a
+    // scan if neither extreme was in the changed range
+    auto inWindow = [&u](std::size_t j) {
+        return int(j) >= u.lo && int(j) <= u.hi;
+    };
+    Range rest;
+    if (inWindow(minKIdx_) || inWindow(maxKIdx_)) {
+        rest = FindRange(absK_.data(), n, u.lo, u.hi);
+    } else {
+        rest = {minK_, maxK_, minKIdx_, maxKIdx_};
+    }
+    u.range = rest;
+    if (window.min < rest.min) {
+        u.range.min = window.min;
+        u.range.minIdx = window.minIdx;
+    }
+    if (window.max > rest.max) {
+        u.range.max = window.max;
+        u.range.maxIdx = window.maxIdx;
+    }
+
+    // Segments on either side of the moved point
+    u.segLo = std::max(0, i - 1);
+    u.segHi = std::min(n - 2, i);
+    u.length = length_;
+    u.windowSum = windowSum_;
+    for (int j = u.segLo; j <= u.segHi; ++j) {
+        auto len = SegmentLength(
+            cx[j], cy[j], cz[j], cx[j + 1], cy[j + 1], cz[j + 1]);
+        u.seg[j - u.segLo] = len;
+        u.length += len - seg_[j];
+        u.windowSum += segWeight_[j] * (len - seg_[j]);
+    }
+
+    u.energy = combine_(
+        u.internalSum, u.absKSum, u.range.min, u.range.max, u.length,
+        u.windowSum);
+}
+
+auto ChainEnergy::combine_(
+    double internalSum,
+    double absKSum,
+    double minK,
+    double maxK,
+    double length,
+    double windowSum) const -> double
+{
+    const auto n = size();
+    if (n == 0) {
+        return 0;
+    }
+
+    auto intE = internalSum / (2 * n);
+    auto kE = MeanNormalizedCurvature(absKSum, minK, maxK, n);
+    auto avgDist = length / (n - 1);
+    auto sE = windowSum / avgDist / n;
+    return alpha_ * intE + beta_ * kE + delta_ * sE;
 }
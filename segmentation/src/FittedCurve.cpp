@@ -15,11 +15,7 @@ FittedCurve::FittedCurve(const std::vector<Voxel>& vs, int zIndex) :
     spline_(CubicMultithreadedSpline(vs))
 {
     // Calculate new voxel positions from the spline
-    points_.reserve(vs.size());
-    for (const auto t : ts_) {
-        auto p = spline_(t);
-        points_.emplace_back(p(0), p(1), zIndex_);
-    }
+    points_ = sample_at_(ts_);
 }
 
 auto FittedCurve::resample(double resamplePerc) -> std::vector<Voxel>
@@ -32,22 +28,31 @@ auto FittedCurve::resample(double resamplePerc) -> std::vector<Voxel>
     }
 
     // Get new voxel positions
-    points_ = sample(npoints_);
+    points_ = sample_at_(ts_);
     return points_;
 }
 
 auto FittedCurve::sample(std::size_t numPoints) const -> std::vector<Voxel>
 {
-    std::vector<Voxel> newPoints(numPoints);
-    newPoints.reserve(numPoints);
-    auto ts = GenerateTVals(numPoints);
-    std::transform(
-        std::begin(ts), std::end(ts), std::begin(newPoints),
-        [this](auto t) -> Voxel {
-            auto p = spline_(t);
-            return {p(0), p(1), zIndex_};
-        });
-    return newPoints;
+    return sample_at_(GenerateTVals(numPoints));
+}
+
+auto FittedCurve::sample_at_(const std::vector<double>& ts) const
+    -> std::vector<Voxel>
+{
+    // Evaluate all t-values in one pass into per-thread coordinate arrays,
+    // which are reused between calls
+    thread_local std::vector<double> xs, ys;
+    xs.resize(ts.size());
+    ys.resize(ts.size());
+    spline_(ts, xs.data(), ys.data());
+
+    std::vector<Voxel> points(ts.size());
+    const auto z = static_cast<double>(zIndex_);
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+        points[i] = {xs[i], ys[i], z};
+    }
+    return points;
 }
 
 auto FittedCurve::operator()(int index) const -> Voxel
@@ -1,7 +1,6 @@
 #include "vc/segmentation/tff/FloodFill.hpp"
 
-#include <queue>
-#include <unordered_set>
+#include <array>
 
 using namespace volcart;
 using namespace volcart::segmentation;
@@ -10,24 +9,28 @@ namespace vcs = volcart::segmentation;
 
 using Voxel = cv::Vec3i;
 using VoxelList = std::vector<cv::Vec3i>;
-using VoxelSet = std::unordered_set<Voxel, Vec3iHash>;
 
-struct VoxelPair {
-    VoxelPair() = default;
-    VoxelPair(const Voxel& v, const Voxel& parent) : v{v}, parent{parent} {}
-
-    Voxel v;
-    Voxel parent;
+namespace
+{
+// A horizontal span to grow from (x, y), owned by seed index `seed`
+struct SpanSeed {
+    int x;
+    int y;
+    std::size_t seed;
 };
+}  // namespace
 
-auto vcs::GetNeighbors(const cv::Vec3i& v) -> std::vector<cv::Vec3i>
+auto vcs::GetNeighbors(const cv::Vec3i& v) -> std::array<cv::Vec3i, 8>
 {
-    return {{v[0] - 1, v[1] - 1, v[2]}, {v[0], v[1] - 1, v[2]},
-            {v[0] + 1, v[1] - 1, v[2]}, {v[0] - 1, v[1], v[2]},
-            {v[0] + 1, v[1], v[2]},     {v[0] - 1, v[1] + 1, v[2]},
-            {v[0], v[1] + 1, v[2]},     {v[0] + 1, v[1] + 1, v[2]}};
+    return {{{v[0] - 1, v[1] - 1, v[2]},
+             {v[0], v[1] - 1, v[2]},
+             {v[0] + 1, v[1] - 1, v[2]},
+             {v[0] - 1, v[1], v[2]},
+             {v[0] + 1, v[1], v[2]},
+             {v[0] - 1, v[1] + 1, v[2]},
+             {v[0], v[1] + 1, v[2]},
+             {v[0] + 1, v[1] + 1, v[2]}}};
 }
-
 auto vcs::EuclideanDistance(const cv::Vec3i& start, const cv::Vec3i& end) -> int
 {
     return static_cast<int>(cv::norm(end - start));
@@ -97,53 +100,86 @@ auto vcs::DoFloodFill(
     std::uint16_t low,
     std::uint16_t high) -> VoxelList
 {
-    std::queue<VoxelPair> q;
     VoxelList mask;
-    VoxelSet visited;
+    if (img.empty()) {
+        return mask;
+    }
 
-    // Push all the initial points onto the queue.
-    // Initial points are their own 'parents'.
-    for (const auto& pt : pts) {
+    // Dense visited map for the slice
+    cv::Mat_<std::uint8_t> visited = cv::Mat_<std::uint8_t>::zeros(img.size());
+
+    // EuclideanDistance() truncates, so dist <= bound is equivalent to
+    // squared distance < (bound + 1)^2
+    const auto maxDist2 = (bound < 0) ? std::int64_t{0}
+                                      : std::int64_t(bound + 1) * (bound + 1);
+
+    // Whether (x, y) should be added to the mask on behalf of seed s
+    auto fillable = [&](int x, int y, std::size_t s) {
+        if (x < 0 or x >= img.cols or y < 0 or y >= img.rows or
+            visited(y, x) != 0) {
+            return false;
+        }
+        auto val = img.at<std::uint16_t>(y, x);
+        if (val < low or val > high) {
+            return false;
+        }
+        std::int64_t dx = x - pts[s][0];
+        std::int64_t dy = y - pts[s][1];
+        return dx * dx + dy * dy < maxDist2;
+    };
+    auto fill = [&](int x, int y, std::size_t s) {
+        visited(y, x) = 1;
+        mask.emplace_back(x, y, pts[s][2]);
+    };
+
+    // Initial points are their own 'parents' and are kept regardless of the
+    // distance bound
+    std::vector<SpanSeed> stack;
+    for (std::size_t s = 0; s < pts.size(); ++s) {
+        const auto& pt = pts[s];
+        if (pt[0] < 0 or pt[0] >= img.cols or pt[1] < 0 or pt[1] >= img.rows or
+            visited(pt[1], pt[0]) != 0) {
+            continue;
+        }
         auto greyVal = img.at<std::uint16_t>(pt[1], pt[0]);
         if (greyVal >= low && greyVal <= high) {
-            q.emplace(pt, pt);
-            visited.insert(pt);
+            fill(pt[0], pt[1], s);
+            stack.push_back({pt[0], pt[1], s});
         }
     }
 
-    while (!q.empty()) {
-        // Pick a VoxelPair off the queue
-        auto pair = q.front();
-        q.pop();
-
-        //'color'/record that cv::Vec3i as part of the mask
-        mask.push_back(pair.v);
-
-        // check neighbors; if they're valid according to the user-defined
-        // threshold AND they are not outside the original(/parent) seed point's
-        // boundary, add them to the queue
-        for (const auto& neighbor : GetNeighbors(pair.v)) {
-            // Make sure this cv::Vec3i hasn't already been added to the
-            // visited list: (We don't want to add it to the queue
-            // twice...)
-            if (visited.find(neighbor) != visited.end()) {
-                continue;
-            }
+    // Every popped position is already filled. Grow it into a horizontal span,
+    // then queue one position for each fillable run in the rows above and
+    // below, including the diagonal neighbors of the span's ends.
+    while (!stack.empty()) {
+        auto [x, y, s] = stack.back();
+        stack.pop_back();
 
-            // Make sure this neighbor is in the image bounds
-            if (neighbor[0] < 0 or neighbor[0] >= img.cols or neighbor[1] < 0 or
-                neighbor[1] >= img.rows) {
-                continue;
-            }
+        auto xl = x;
+        while (fillable(xl - 1, y, s)) {
+            fill(--xl, y, s);
+        }
+        auto xr = x;
+        while (fillable(xr + 1, y, s)) {
+            fill(++xr, y, s);
+        }
 
-            // Add the valid neighbor to the queue and mark it as visited.
-            auto val = img.at<std::uint16_t>(neighbor[1], neighbor[0]);
-            auto dist = EuclideanDistance(neighbor, pair.parent);
-            if (val >= low && val <= high && dist <= bound) {
-                q.emplace(neighbor, pair.parent);
-                visited.insert(neighbor);
+        for (auto ny : {y - 1, y + 1}) {
+            auto nx = xl - 1;
+            while (nx <= xr + 1) {
+                if (!fillable(nx, ny, s)) {
+                    ++nx;
+                    continue;
+                }
+                fill(nx, ny, s);
+                stack.push_back({nx, ny, s});
+                // The rest of this run is filled when the new span grows
+                while (nx <= xr + 1 and fillable(nx + 1, ny, s)) {
+                    ++nx;
+                }
+                nx += 2;
             }
         }
     }
     return mask;
-}
\ No newline at end of file
+}
@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <deque>
 #include <iomanip>
 #include <limits>
 #include <list>
+#include <optional>
 #include <tuple>
 
 #include <opencv2/core.hpp>
@@ -12,6 +15,7 @@
 
 #include "vc/core/filesystem.hpp"
 #include "vc/core/math/StructureTensor.hpp"
+#include "vc/core/math/StructureTensorField.hpp"
 #include "vc/segmentation/LocalResliceParticleSim.hpp"
 #include "vc/segmentation/lrps/Common.hpp"
 #include "vc/segmentation/lrps/Derivative.hpp"
@@ -54,6 +58,12 @@ auto LocalResliceSegmentation::compute() -> LocalResliceSegmentation::PointSet
         return create_final_pointset_({currentVs});
     }
 
+    // Tensors are shared by all normal estimates of this run
+    stField_.reset();
+    if (useStructureTensorField_) {
+        stField_ = StructureTensorField::New(vol_, structure_tensor_radius_());
+    }
+
     const fs::path outputDir("debugvis");
     const fs::path wholeChainDir(outputDir / "whole_chain");
     if (dumpVis_) {
@@ -108,20 +118,23 @@ auto LocalResliceSegmentation::compute() -> LocalResliceSegmentation::PointSet
 
         /////////////////////////////////////////////////////////
         // 1. Generate all candidate positions for all particles
-        std::vector<std::deque<Voxel>> nextPositions;
-        nextPositions.reserve(currentCurve.size());
-        // XXX DEBUG
-        std::vector<IntensityMap> maps;
-        std::vector<Reslice> reslices;
-        maps.reserve(currentCurve.size());
-        reslices.reserve(currentCurve.size());
-        // XXX DEBUG
-        for (int i = 0; i < int(currentCurve.size()); ++i) {
-            // Estimate normal and reslice along it
+        // Particles are independent in this step, so each one is handled in
+        // parallel. Every particle copies the voxels its reslice covers out
+        // of the slice cache once and samples the reslice from that copy.
+        const auto numParticles = static_cast<int>(currentCurve.size());
+        std::vector<std::deque<Voxel>> nextPositions(numParticles);
+        std::vector<std::optional<IntensityMap>> partialMaps(numParticles);
+        std::vector<std::optional<Reslice>> partialReslices(numParticles);
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < numParticles; ++i) {
+            // Reslice along the estimated normal
             const auto normal = estimate_normal_at_index_(currentCurve, i);
+            cv::Vec3i slabOrigin;
+            const auto slab =
+                load_reslice_slab_(currentCurve(i), normal, slabOrigin);
             const auto reslice = vol_->reslice(
-                currentCurve(i), normal, {0, 0, 1}, resliceSize_, resliceSize_);
-            reslices.push_back(reslice);
+                currentCurve(i), normal, {0, 0, 1}, slab, slabOrigin,
+                resliceSize_, resliceSize_);
             auto resliceIntensities = reslice.sliceData();
 
             // Make the intensity map `stepSize_` layers down from current
@@ -133,24 +146,33 @@ auto LocalResliceSegmentation::compute() -> LocalResliceSegmentation::PointSet
                 resliceIntensities, static_cast<int>(stepSize_),
                 peakDistanceWeight_, considerPrevious_);
             const auto allMaxima = map.sortedMaxima();
-            maps.push_back(map);
 
             // Handle case where there's no maxima - go straight down
             if (allMaxima.empty()) {
-                nextPositions.emplace_back(
-                    std::deque<Voxel>{reslice.sliceToVoxelCoord<int>(
-                        {center.x, nextLayerIndex})});
-                continue;
+                nextPositions[i].emplace_back(reslice.sliceToVoxelCoord<int>(
+                    {center.x, nextLayerIndex}));
+            } else {
+                // Convert maxima to voxel positions
+                for (auto&& maxima : allMaxima) {
+                    nextPositions[i].emplace_back(
+                        reslice.sliceToVoxelCoord<double>(
+                            {maxima.first, nextLayerIndex}));
+                }
             }
+            partialMaps[i].emplace(std::move(map));
+            partialReslices[i].emplace(reslice);
+        }
 
-            // Convert maxima to voxel positions
-            std::deque<Voxel> maximaQueue;
-            for (auto&& maxima : allMaxima) {
-                maximaQueue.emplace_back(reslice.sliceToVoxelCoord<double>(
-                    {maxima.first, nextLayerIndex}));
-            }
-            nextPositions.push_back(maximaQueue);
+        // XXX DEBUG
+        std::vector<IntensityMap> maps;
+        std::vector<Reslice> reslices;
+        maps.reserve(numParticles);
+        reslices.reserve(numParticles);
+        for (int i = 0; i < numParticles; ++i) {
+            maps.push_back(std::move(*partialMaps[i]));
+            reslices.push_back(std::move(*partialReslices[i]));
         }
+        // XXX DEBUG
 
         /////////////////////////////////////////////////////////
         // 2. Construct initial guess using top maxima for each next position
@@ -171,6 +193,12 @@ auto LocalResliceSegmentation::compute() -> LocalResliceSegmentation::PointSet
         std::deque<double> dEnergy;
         dEnergy.push_back(minEnergy);
 
+        // Energy of the unfitted chain, if candidates are scored incrementally
+        std::optional<ChainEnergy> chainEnergy;
+        if (useIncrementalEnergy_) {
+            chainEnergy.emplace(nextVs, alpha_, k1_, k2_, beta_, delta_);
+        }
+
         /////////////////////////////////////////////////////////
         // 3. Optimize
         std::vector<int> indices(currentVs.size());
@@ -212,9 +240,24 @@ auto LocalResliceSegmentation::compute() -> LocalResliceSegmentation::PointSet
                 // particle, iterate until you find a new optimum or don't find
                 // anything.
                 while (!nextPositions[maxDiffIdx].empty()) {
-                    std::vector<Voxel> combVs(begin(nextVs), end(nextVs));
-                    combVs[maxDiffIdx] = nextPositions[maxDiffIdx].front();
+                    const auto candidate = nextPositions[maxDiffIdx].front();
                     nextPositions[maxDiffIdx].pop_front();
+
+                    // Only the terms around the moved particle change
+                    if (chainEnergy) {
+                        double newE =
+                            chainEnergy->energyIfMoved(maxDiffIdx, candidate);
+                        if (newE < minEnergy) {
+                            minEnergy =
+                                chainEnergy->move(maxDiffIdx, candidate);
+                            maps[maxDiffIdx].incrementMaximaIndex();
+                            nextVs[maxDiffIdx] = candidate;
+                        }
+                        continue;
+                    }
+
+                    std::vector<Voxel> combVs(begin(nextVs), end(nextVs));
+                    combVs[maxDiffIdx] = candidate;
                     FittedCurve combCurve(combVs, zIndex + 1);
 
                     // Found a new optimum?
@@ -337,9 +380,10 @@ auto LocalResliceSegmentation::estimate_normal_at_index_(
     const FittedCurve& currentCurve, int index) -> cv::Vec3d
 {
     auto currentVoxel = currentCurve(index);
-    auto radius = static_cast<int>(
-        std::ceil(materialThickness_ / vol_->voxelSize()) * 0.5);
-    auto eigenPairs = ComputeSubvoxelEigenPairs(vol_, currentVoxel, radius);
+    auto eigenPairs =
+        (stField_) ? stField_->eigenPairsAt(currentVoxel)
+                   : ComputeSubvoxelEigenPairs(
+                         vol_, currentVoxel, structure_tensor_radius_());
     double exp0 = std::log10(eigenPairs[0].first);
     double exp1 = std::log10(eigenPairs[1].first);
     if (std::abs(exp0 - exp1) > 2.0) {
@@ -349,6 +393,58 @@ auto LocalResliceSegmentation::estimate_normal_at_index_(
     return tan3d.cross(cv::Vec3d{0, 0, 1});
 }
 
+auto LocalResliceSegmentation::load_reslice_slab_(
+    const Voxel& center, const cv::Vec3d& normal, cv::Vec3i& origin) const
+    -> std::vector<cv::Mat>
+{
+    // Corners of the reslice, placed like in Volume::reslice()
+    const auto xnorm = cv::normalize(normal);
+    const cv::Vec3d ynorm{0, 0, 1};
+    const auto extent = static_cast<double>(resliceSize_ - 1);
+    const cv::Vec3d corner =
+        center - (resliceSize_ / 2) * xnorm - (resliceSize_ / 2) * ynorm;
+    auto lo = corner;
+    auto hi = corner;
+    for (const auto& c :
+         {corner + extent * xnorm, corner + extent * ynorm,
+          corner + extent * (xnorm + ynorm)}) {
+        for (int d = 0; d < 3; ++d) {
+            lo[d] = std::min(lo[d], c[d]);
+            hi[d] = std::max(hi[d], c[d]);
+        }
+    }
+
+    // Trilinear sampling also reads the voxels after the lower corners
+    const cv::Rect roi =
+        cv::Rect(
+            cv::Point(
+                static_cast<int>(std::floor(lo[0])),
+                static_cast<int>(std::floor(lo[1]))),
+            cv::Point(
+                static_cast<int>(std::floor(hi[0])) + 2,
+                static_cast<int>(std::floor(hi[1])) + 2)) &
+        cv::Rect(0, 0, vol_->sliceWidth(), vol_->sliceHeight());
+    const auto zStart = std::max(0, static_cast<int>(std::floor(lo[2])));
+    const auto zEnd = std::min(
+        vol_->numSlices() - 1, static_cast<int>(std::floor(hi[2])) + 1);
+
+    origin = {roi.x, roi.y, zStart};
+    std::vector<cv::Mat> slab;
+    if (roi.empty()) {
+        return slab;
+    }
+    for (int z = zStart; z <= zEnd; ++z) {
+        slab.push_back(vol_->getSliceDataRectCopy(z, roi));
+    }
+    return slab;
+}
+
+auto LocalResliceSegmentation::structure_tensor_radius_() const -> int
+{
+    return static_cast<int>(
+        std::ceil(materialThickness_ / vol_->voxelSize()) * 0.5);
+}
+
 auto LocalResliceSegmentation::create_final_pointset_(
     const std::vector<std::vector<Voxel>>& points)
     -> LocalResliceSegmentation::PointSet
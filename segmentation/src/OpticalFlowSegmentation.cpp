@@ -1,6 +1,7 @@
 // Author: Julian Shilliger, contribution to Volume Cartographer as part of the 2023 "Vesuvius Challenge", MIT License
 
 #include <deque>
+#include <future>
 #include <iomanip>
 #include <limits>
 #include <list>
@@ -237,61 +238,169 @@ std::vector<std::vector<Voxel>> OpticalFlowSegmentationClass::interpolateGaps(st
     return points;
 }
 
-// Multithreaded computation of splitted curve segment
-std::vector<Voxel> OpticalFlowSegmentationClass::computeCurve(
-    FittedCurve currentCurve,
-    Chain& currentVs,
-    int zIndex,
-    int nextZIndex,
-    int startIndexChain,
-    bool backwards)
+namespace
 {
-    bool visualize = false;
-    // Extract 2D image slices at zIndex and zIndex+1
-    // cv::Mat slice1 = vol_->getSliceDataCopy(zIndex);
+// Margin around a curve's bounding box to avoid optical flow edge effects
+constexpr int FLOW_ROI_MARGIN = 15;
+// Optical flow regions are snapped outward to multiples of this size
+constexpr int FLOW_ROI_GRID = 32;
+
+// Look up a value in a per-run cache, computing it in this thread if no other
+// thread has started to
+template <class Key, class T, class Fn>
+auto GetOrCompute(
+    std::map<Key, std::shared_future<T>>& cache,
+    std::mutex& mutex,
+    const Key& key,
+    Fn compute) -> T
+{
+    std::promise<T> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            auto future = it->second;
+            lock.unlock();
+            return future.get();
+        }
+        cache.emplace(key, promise.get_future().share());
+    }
+
+    try {
+        auto value = compute();
+        promise.set_value(value);
+        return value;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+}  // namespace
 
+auto OpticalFlowSegmentationClass::flow_roi_(const std::vector<Voxel>& vs) const
+    -> cv::Rect
+{
     // Calculate the bounding box of the curve to define the region of interest
     int x_min = std::numeric_limits<int>::max();
     int y_min = std::numeric_limits<int>::max();
     int x_max = std::numeric_limits<int>::min();
     int y_max = std::numeric_limits<int>::min();
+    for (const auto& v : vs) {
+        x_min = std::min(x_min, static_cast<int>(v[0]));
+        y_min = std::min(y_min, static_cast<int>(v[1]));
+        x_max = std::max(x_max, static_cast<int>(v[0]));
+        y_max = std::max(y_max, static_cast<int>(v[1]));
+    }
 
-    for (int i = 0; i < int(currentCurve.size()); ++i) {
-        // Get the current point
-        Voxel pt_ = currentCurve(i);
-        x_min = std::min(x_min, static_cast<int>(pt_[0]));
-        y_min = std::min(y_min, static_cast<int>(pt_[1]));
-        x_max = std::max(x_max, static_cast<int>(pt_[0]));
-        y_max = std::max(y_max, static_cast<int>(pt_[1]));
+    // Add a margin and snap to the grid, so that slightly different curves
+    // use the same region
+    x_min = std::max(0, x_min - FLOW_ROI_MARGIN) / FLOW_ROI_GRID * FLOW_ROI_GRID;
+    y_min = std::max(0, y_min - FLOW_ROI_MARGIN) / FLOW_ROI_GRID * FLOW_ROI_GRID;
+    x_max = (x_max + FLOW_ROI_MARGIN) / FLOW_ROI_GRID * FLOW_ROI_GRID +
+            FLOW_ROI_GRID - 1;
+    y_max = (y_max + FLOW_ROI_MARGIN) / FLOW_ROI_GRID * FLOW_ROI_GRID +
+            FLOW_ROI_GRID - 1;
+    x_max = std::min(vol_->sliceWidth() - 1, x_max);
+    y_max = std::min(vol_->sliceHeight() - 1, y_max);
+
+    return {x_min, y_min, x_max - x_min + 1, y_max - y_min + 1};
+}
+
+auto OpticalFlowSegmentationClass::normalized_roi_(int z, const cv::Rect& roi)
+    -> cv::Mat
+{
+    RoiKey key{z, roi.x, roi.y, roi.width, roi.height};
+    return GetOrCompute(roiCache_, flowCacheMutex_, key, [&]() {
+        // Convert to grayscale and normalize the slice
+        cv::Mat gray;
+        cv::normalize(
+            vol_->getSliceDataRect(z, roi), gray, 0, 255, cv::NORM_MINMAX,
+            CV_8UC1);
+        return gray;
+    });
+}
+
+auto OpticalFlowSegmentationClass::flow_field_(
+    int z1, int z2, const cv::Rect& roi) -> FlowField::Pointer
+{
+    FlowKey key{z1, z2, roi.x, roi.y, roi.width, roi.height};
+    return GetOrCompute(flowCache_, flowCacheMutex_, key, [&]() {
+        auto field = std::make_shared<FlowField>();
+        field->gray1 = normalized_roi_(z1, roi);
+        field->gray2 = normalized_roi_(z2, roi);
+
+        // Compute dense optical flow using Farneback method
+        cv::calcOpticalFlowFarneback(
+            field->gray1, field->gray2, field->flow, 0.5, 3, 15, 3, 7, 1.2, 0);
+        return FlowField::Pointer(field);
+    });
+}
+
+void OpticalFlowSegmentationClass::prefetch_flow_fields_(
+    int z1, int z2, std::vector<cv::Rect> rois)
+{
+    if (prefetch_.valid()) {
+        prefetch_.get();
     }
+    prefetch_ = std::async(std::launch::async, [this, z1, z2, rois]() {
+        for (const auto& roi : rois) {
+            // Failures resurface when the step requests the same flow field
+            try {
+                flow_field_(z1, z2, roi);
+            } catch (...) {
+            }
+        }
+    });
+}
 
-    // Add a margin to the bounding box to avoid edge effects
-    int margin = 15;
-    x_min = std::max(0, x_min - margin);
-    y_min = std::max(0, y_min - margin);
-    x_max = std::min(vol_->sliceWidth() - 1, x_max + margin);
-    y_max = std::min(vol_->sliceHeight() - 1, y_max + margin);
+void OpticalFlowSegmentationClass::prune_flow_cache_(int z1, int z2)
+{
+    std::unique_lock<std::mutex> lock(flowCacheMutex_);
+    for (auto it = flowCache_.begin(); it != flowCache_.end();) {
+        auto z = std::get<0>(it->first);
+        it = (z == z1 || z == z2) ? std::next(it) : flowCache_.erase(it);
+    }
+    for (auto it = roiCache_.begin(); it != roiCache_.end();) {
+        auto z = std::get<0>(it->first);
+        it = (z == z1 || z == z2) ? std::next(it) : roiCache_.erase(it);
+    }
+}
 
-    // Extract the region of interest
-    cv::Rect roi(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+void OpticalFlowSegmentationClass::clear_flow_cache_()
+{
+    if (prefetch_.valid()) {
+        prefetch_.get();
+    }
+    std::unique_lock<std::mutex> lock(flowCacheMutex_);
+    flowCache_.clear();
+    roiCache_.clear();
+}
 
-    cv::Mat roiSlice1;
-    roiSlice1 = vol_->getSliceDataRect(zIndex, roi);
-    // Select the next slice depending on backwards and step size
-    cv::Mat roiSlice2 = vol_->getSliceDataRect(nextZIndex, roi);
+// Multithreaded computation of splitted curve segment
+std::vector<Voxel> OpticalFlowSegmentationClass::computeCurve(
+    FittedCurve currentCurve,
+    Chain& currentVs,
+    int zIndex,
+    int nextZIndex,
+    int startIndexChain,
+    bool backwards)
+{
+    bool visualize = false;
+    // Extract 2D image slices at zIndex and zIndex+1
+    // cv::Mat slice1 = vol_->getSliceDataCopy(zIndex);
 
-    // Convert to grayscale and normalize the slices
-    cv::Mat gray1, gray2;
-    cv::normalize(roiSlice1, gray1, 0, 255, cv::NORM_MINMAX, CV_8UC1);
-    cv::normalize(roiSlice2, gray2, 0, 255, cv::NORM_MINMAX, CV_8UC1);
+    // Get the region of interest around the curve and its optical flow
+    const auto roi = flow_roi_(currentCurve.points());
+    const int x_min = roi.x;
+    const int y_min = roi.y;
+    const auto flowField = flow_field_(zIndex, nextZIndex, roi);
+    const cv::Mat& gray1 = flowField->gray1;
+    const cv::Mat& gray2 = flowField->gray2;
+    const cv::Mat& flow = flowField->flow;
 
     cv::Mat integral_img;
     cv::integral(gray2, integral_img, CV_32S);
 
-    // Compute dense optical flow using Farneback method
-    cv::Mat flow;
-    cv::calcOpticalFlowFarneback(gray1, gray2, flow, 0.5, 3, 15, 3, 7, 1.2, 0);
-
     // Canny edge detection
     cv::Mat edges2;
     // Calculate the mean of the whole grayscale image using the integral image
@@ -970,6 +1079,7 @@ ChainSegmentationAlgorithm::Status OpticalFlowSegmentationClass::computeSub(std:
         if (backwards
             ? nextZIndex <= endChainIndex || nextZIndex >= startChainIndex
             : nextZIndex >= endChainIndex || nextZIndex <= startChainIndex)  {
+            clear_flow_cache_();
             return status_;
         }
 
@@ -1017,32 +1127,49 @@ ChainSegmentationAlgorithm::Status OpticalFlowSegmentationClass::computeSub(std:
 
         std::vector<std::vector<Voxel>> subsegment_points(num_threads);
 
+        // Split the curve into overlapping subsegments
+        std::vector<std::vector<Voxel>> subsegment_vectors(num_threads);
+        int start_idx = 0;
+        for (int i = 0; i < num_threads; ++i)
+        {
+            int segment_length = base_segment_length + (i < num_threads_with_extra_point ? 1 : 0);
+            int end_idx = start_idx + segment_length;
+            // Change start_idx and end_idx to include overlap
+            int start_idx_padded = (i == 0) ? 0 : (start_idx - 2);
+            int end_idx_padded = (i == num_threads - 1) ? total_points : (end_idx + 2);
+            subsegment_vectors[i].assign(currentVs.begin() + start_idx_padded, currentVs.begin() + end_idx_padded);
+            start_idx = end_idx;
+        }
+
+        // Drop cached flow fields of earlier steps. While this step is being
+        // computed, compute the next step's flow fields in the background,
+        // assuming the curve stays within the current regions.
+        prune_flow_cache_(zIndex, nextZIndex);
+        int nextNextZIndex = static_cast<int>(nextZIndex + (backwards ? -stepSize_ : stepSize_));
+        if ((backwards ? nextZIndex > endIndex : nextZIndex < endIndex) &&
+            nextNextZIndex >= 0 && nextNextZIndex < vol_->numSlices()) {
+            std::vector<cv::Rect> rois;
+            for (const auto& subsegment : subsegment_vectors) {
+                auto roi = flow_roi_(subsegment);
+                if (std::find(rois.begin(), rois.end(), roi) == rois.end()) {
+                    rois.push_back(roi);
+                }
+            }
+            prefetch_flow_fields_(nextZIndex, nextNextZIndex, rois);
+        }
+
         // Parallel computation of curve segments
         // Dispatch at most num_available_threads jobs at once. Repeat until all num_threads jobs are done.
-        int start_idx = 0;
         for (int job = 0; job < num_threads; job += num_concurrent_threads)
         {
             int num_threads_to_dispatch = std::min(num_concurrent_threads, num_threads - job);
             std::vector<std::thread> threads(num_threads_to_dispatch);
 
-            std::vector<std::vector<Voxel>> subsegment_vectors(num_threads_to_dispatch);
-            for (int i = job; i < job+num_threads_to_dispatch; ++i)
-            {
-                int segment_length = base_segment_length + (i < num_threads_with_extra_point ? 1 : 0);
-                int end_idx = start_idx + segment_length;
-                // Change start_idx and end_idx to include overlap
-                int start_idx_padded = (i == 0) ? 0 : (start_idx - 2);
-                int end_idx_padded = (i == num_threads - 1) ? total_points : (end_idx + 2);
-                std::vector<Voxel> subsegment(currentVs.begin() + start_idx_padded, currentVs.begin() + end_idx_padded);
-                subsegment_vectors[i-job] = subsegment;
-                start_idx = end_idx;
-            }
-
             for (int i = job; i < job+num_threads_to_dispatch; ++i)
             {
-                threads[i-job] = std::thread([&, i, job]()
+                threads[i-job] = std::thread([&, i]()
                 {
-                    Chain subsegment_chain(subsegment_vectors[i-job]);
+                    Chain subsegment_chain(subsegment_vectors[i]);
                     FittedCurve subsegmentCurve(subsegment_chain, zIndex);
                     std::vector<Voxel> subsegmentNextVs = computeCurve(subsegmentCurve, subsegment_chain, zIndex, nextZIndex, startChainIndex, backwards);
                     subsegment_points[i] = subsegmentNextVs;
@@ -1083,6 +1210,7 @@ ChainSegmentationAlgorithm::Status OpticalFlowSegmentationClass::computeSub(std:
             })) {
             std::cout << "Returned early due to out-of-bounds points" << std::endl;
             status_ = Status::ReturnedEarly;
+            clear_flow_cache_();
             return status_;
         }
 
@@ -1111,6 +1239,7 @@ ChainSegmentationAlgorithm::Status OpticalFlowSegmentationClass::computeSub(std:
         loopCounter++;
     }
 
+    clear_flow_cache_();
     return status_;
 }
 
@@ -58,21 +58,15 @@ auto StructureTensorParticleSim::compute()
         // Run Runge-Kutta multiple times to accumulate one full output step
         for (std::size_t rkIt = 0; rkIt < rkIters; rkIt++) {
             // K1
-            auto chainK1 = currentChain_;
-            auto k1 = calc_prop_forces_(chainK1) + calc_spring_forces_(chainK1);
-            ForceChain::Normalize(k1);
+            auto k1 = calc_stage_forces_(currentChain_);
             // K2
-            auto chainK2 = currentChain_ + (rkStepSize_ * 0.5 * k1);
-            auto k2 = calc_prop_forces_(chainK2) + calc_spring_forces_(chainK2);
-            ForceChain::Normalize(k2);
+            auto k2 =
+                calc_stage_forces_(currentChain_ + (rkStepSize_ * 0.5 * k1));
             // K3
-            auto chainK3 = currentChain_ + (rkStepSize_ * 0.5 * k2);
-            auto k3 = calc_prop_forces_(chainK3) + calc_spring_forces_(chainK3);
-            ForceChain::Normalize(k3);
+            auto k3 =
+                calc_stage_forces_(currentChain_ + (rkStepSize_ * 0.5 * k2));
             // K4
-            auto chainK4 = currentChain_ + (rkStepSize_ * k3);
-            auto k4 = calc_prop_forces_(chainK4) + calc_spring_forces_(chainK4);
-            ForceChain::Normalize(k4);
+            auto k4 = calc_stage_forces_(currentChain_ + (rkStepSize_ * k3));
 
             currentChain_ +=
                 (rkStepSize_ * RK_STEP_SCALE * (k1 + (2 * k2) + (2 * k3) + k4));
@@ -109,49 +103,54 @@ void StructureTensorParticleSim::add_chain_to_result_()
     result_.pushRow(row);
 }
 
-auto StructureTensorParticleSim::calc_prop_forces_(ParticleChain c)
-    -> ForceChain
+auto StructureTensorParticleSim::calc_stage_forces_(
+    const ParticleChain& c) const -> ForceChain
 {
-    ForceChain res;
-    Force zDir{0, 0, 1};
-
-    for (const auto& p : c) {
-        auto ep = ComputeSubvoxelEigenPairs(vol_, p.pos(), radius_);
-        auto offset = ep[0].second;
-        offset = zDir - (zDir.dot(offset)) / (offset.dot(offset)) * offset;
-        cv::normalize(offset, offset);
-        res.push_back(offset * propagationScaleFactor_);
+    // The eigen solve of each point's propagation force dominates, so
+    // compute each point's total force independently
+    ForceChain res(c.size());
+    const auto n = static_cast<std::ptrdiff_t>(c.size());
+#pragma omp parallel for schedule(dynamic)
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        auto f = prop_force_(c, i) + spring_force_(c, i);
+        cv::normalize(f, f);
+        res[i] = f;
     }
-
     return res;
 }
 
-auto StructureTensorParticleSim::calc_spring_forces_(ParticleChain c)
-    -> ForceChain
+auto StructureTensorParticleSim::prop_force_(
+    const ParticleChain& c, std::size_t i) const -> Force
 {
-    ForceChain res;
-    for (auto it = c.begin(); it != c.end(); it++) {
-        // Setup an empty force vector
-        Force f{0, 0, 0};
-
-        // Calculate left spring
-        if (it != c.begin()) {
-            auto vec = it->pos() - std::prev(it)->pos();
-            auto dist = cv::norm(vec);
-            cv::normalize(vec, vec, springConstantK_ * (dist - it->restingL()));
-            f += vec;
-        }
+    Force zDir{0, 0, 1};
+    auto ep = ComputeSubvoxelEigenPairs(vol_, c[i].pos(), radius_);
+    auto offset = ep[0].second;
+    offset = zDir - (zDir.dot(offset)) / (offset.dot(offset)) * offset;
+    cv::normalize(offset, offset);
+    return offset * propagationScaleFactor_;
+}
 
-        // Calculate right resting
-        if (it != c.end() - 1) {
-            auto vec = std::next(it)->pos() - it->pos();
-            auto dist = cv::norm(vec);
-            cv::normalize(vec, vec, springConstantK_ * (dist - it->restingR()));
-            f += vec;
-        }
+auto StructureTensorParticleSim::spring_force_(
+    const ParticleChain& c, std::size_t i) const -> Force
+{
+    // Setup an empty force vector
+    Force f{0, 0, 0};
+
+    // Calculate left spring
+    if (i > 0) {
+        auto vec = c[i].pos() - c[i - 1].pos();
+        auto dist = cv::norm(vec);
+        cv::normalize(vec, vec, springConstantK_ * (dist - c[i].restingL()));
+        f += vec;
+    }
 
-        res.push_back(f);
+    // Calculate right resting
+    if (i + 1 < c.size()) {
+        auto vec = c[i + 1].pos() - c[i].pos();
+        auto dist = cv::norm(vec);
+        cv::normalize(vec, vec, springConstantK_ * (dist - c[i].restingR()));
+        f += vec;
     }
 
-    return res;
-}
\ No newline at end of file
+    return f;
+}
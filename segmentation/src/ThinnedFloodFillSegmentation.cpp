@@ -1,5 +1,6 @@
 #include "vc/segmentation/ThinnedFloodFillSegmentation.hpp"
 
+#include <future>
 #include <iomanip>
 #include <queue>
 #include <unordered_set>
@@ -266,6 +267,19 @@ auto TFF::compute() -> TFF::PointSet
         seedPoints.emplace_back(pt[0], pt[1], pt[2]);
     }
 
+    // Each slice is seeded by the previous slice's skeleton, so slices are
+    // processed in order. The next slice is loaded in the background while
+    // the current one is processed.
+    auto loadSlice = [this](std::size_t z) {
+        return std::async(std::launch::async, [this, z]() {
+            if (z >= static_cast<std::size_t>(vol_->numSlices())) {
+                return cv::Mat();
+            }
+            return vol_->getSliceDataCopy(static_cast<int>(z));
+        });
+    };
+    auto nextSlice = loadSlice(startSlice);
+
     // Iterate over z-slices
     for (auto it : range(iterations_)) {
         // Update progress
@@ -284,13 +298,16 @@ auto TFF::compute() -> TFF::PointSet
         }
 
         // Get the current (single) slice image (Of type Mat)
-        auto slice = vol_->getSliceDataCopy(zIndex);
+        auto slice = nextSlice.get();
+        nextSlice = loadSlice(zIndex + 1);
 
         // Estimate thickness of page from every seed point.
-        std::vector<std::size_t> estimates;
-        for (const auto& v : seedPoints) {
-            estimates.emplace_back(MeasureThickness(
-                v, slice, low_, high_, measureVertically_, maxRadius_));
+        std::vector<std::size_t> estimates(seedPoints.size());
+#pragma omp parallel for schedule(dynamic, 16)
+        for (std::size_t i = 0; i < seedPoints.size(); ++i) {
+            estimates[i] = MeasureThickness(
+                seedPoints[i], slice, low_, high_, measureVertically_,
+                maxRadius_);
         }
 
         // Calculate the median thickness.
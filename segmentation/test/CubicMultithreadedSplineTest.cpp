@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "vc/segmentation/lrps/CubicMultithreadedSpline.hpp"
+
+using namespace volcart::segmentation;
+
+// Number of chains fit by the tests
+static constexpr std::size_t NUM_CHAINS = 24;
+// Number of threads fitting chains concurrently
+static constexpr std::size_t NUM_THREADS = 4;
+// t-values at which the splines are compared
+static constexpr int NUM_SAMPLES = 50;
+
+// Wavy chains of varying length. Chains of more than 100 points are fit in
+// several windows.
+static auto MakeChains() -> std::vector<std::vector<Voxel>>
+{
+    std::vector<std::vector<Voxel>> chains;
+    for (std::size_t c = 0; c < NUM_CHAINS; ++c) {
+        auto numPoints = 10 + 23 * c;
+        std::vector<Voxel> chain;
+        for (std::size_t i = 0; i < numPoints; ++i) {
+            auto x = static_cast<double>(i);
+            chain.emplace_back(
+                x, 20 * std::sin(0.1 * x + static_cast<double>(c)), 0);
+        }
+        chains.push_back(chain);
+    }
+    return chains;
+}
+
+static void ExpectSameSpline(
+    const CubicMultithreadedSpline& result,
+    const CubicMultithreadedSpline& expected)
+{
+    for (int i = 0; i <= NUM_SAMPLES; ++i) {
+        auto t = static_cast<double>(i) / NUM_SAMPLES;
+        auto r = result(t);
+        auto e = expected(t);
+        EXPECT_DOUBLE_EQ(r(0), e(0)) << "t = " << t;
+        EXPECT_DOUBLE_EQ(r(1), e(1)) << "t = " << t;
+    }
+}
+
+// Splines fit concurrently, with every thread reusing its arc length
+// integration workspace for several chains, match splines fit one by one
+TEST(CubicMultithreadedSpline, ConcurrentFitsMatchSequentialFits)
+{
+    auto chains = MakeChains();
+
+    std::vector<CubicMultithreadedSpline> expected;
+    for (const auto& chain : chains) {
+        expected.emplace_back(chain);
+    }
+
+    std::vector<CubicMultithreadedSpline> results(chains.size());
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&chains, &results, t]() {
+            for (auto c = t; c < chains.size(); c += NUM_THREADS) {
+                results[c] = CubicMultithreadedSpline(chains[c]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t c = 0; c < chains.size(); ++c) {
+        SCOPED_TRACE("chain " + std::to_string(c));
+        ExpectSameSpline(results[c], expected[c]);
+    }
+}
+
+// Refitting on the same thread, i.e. with a workspace used before, gives the
+// same spline
+TEST(CubicMultithreadedSpline, RepeatedFitsMatch)
+{
+    auto chains = MakeChains();
+    const auto& chain = chains.back();
+
+    CubicMultithreadedSpline first(chain);
+    for (const auto& other : chains) {
+        CubicMultithreadedSpline unused(other);
+    }
+    CubicMultithreadedSpline second(chain);
+
+    ExpectSameSpline(second, first);
+}
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
 #include <cstddef>
 #include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include "vc/segmentation/lrps/EnergyMetrics.hpp"
 #include "vc/testing/TestingUtils.hpp"
@@ -268,4 +272,93 @@ TEST_F(ConstantFittedCurve, TotalEnergyWithConstantCurveAndDefaultValues)
         _curve, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
         kDefaultDelta);
     volcart::testing::ExpectNear(result, expected, tolperc);
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Test incremental energy updates against full recomputation
+
+// Fixture for a sinusoidal chain of points
+class SinusoidalChain : public ::testing::Test
+{
+public:
+    std::vector<Voxel> _points;
+
+    SinusoidalChain()
+    {
+        for (int i = 0; i < 25; ++i) {
+            _points.emplace_back(2.0 * i, 5.0 * std::sin(0.3 * i), 7);
+        }
+    }
+
+    auto totalEnergy(const std::vector<Voxel>& points) const -> double
+    {
+        return EnergyMetrics::TotalEnergy(
+            points, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+            kDefaultDelta);
+    }
+};
+
+TEST_F(SinusoidalChain, TotalEnergyOfCurveMatchesItsPoints)
+{
+    FittedCurve curve(_points, 7);
+    auto expected = totalEnergy(curve.points());
+    auto result = EnergyMetrics::TotalEnergy(
+        curve, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+        kDefaultDelta);
+    EXPECT_DOUBLE_EQ(result, expected);
+}
+
+TEST_F(SinusoidalChain, ChainEnergyMatchesTotalEnergy)
+{
+    ChainEnergy chain(
+        _points, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+        kDefaultDelta);
+    EXPECT_EQ(chain.size(), _points.size());
+    EXPECT_NEAR(chain.energy(), totalEnergy(_points), tol);
+}
+
+TEST_F(SinusoidalChain, ChainEnergyMovesMatchFullRecomputation)
+{
+    ChainEnergy chain(
+        _points, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+        kDefaultDelta);
+
+    // Include both ends, their neighbors, and a move large enough to change
+    // the curvature range
+    const std::vector<std::pair<std::size_t, Voxel>> moves{
+        {0, {0.5, 1, 7}},  {1, {2, -1.5, 7}},  {12, {24, 30, 7}},
+        {12, {24.5, -2, 7}}, {13, {26, 4, 7}}, {2, {4, 3, 7}},
+        {23, {46, -3, 7}}, {24, {49, 0, 7}},   {11, {22, 0.5, 7}}};
+    auto points = _points;
+    for (const auto& [index, v] : moves) {
+        auto before = chain.energy();
+        points[index] = v;
+        auto expected = totalEnergy(points);
+
+        EXPECT_NEAR(chain.energyIfMoved(index, v), expected, tol);
+        EXPECT_DOUBLE_EQ(chain.energy(), before);
+        EXPECT_NEAR(chain.move(index, v), expected, tol);
+        EXPECT_NEAR(chain.energy(), expected, tol);
+    }
+    EXPECT_EQ(chain.points(), points);
+}
+
+TEST(ChainEnergy, EmptyChain)
+{
+    ChainEnergy chain(
+        {}, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+        kDefaultDelta);
+    EXPECT_EQ(chain.size(), 0U);
+    EXPECT_PRED_FORMAT2(::testing::DoubleLE, chain.energy(), tol);
+    EXPECT_THROW(chain.energyIfMoved(0, {0, 0, 0}), std::out_of_range);
+}
+
+TEST(ChainEnergy, TooFewPoints)
+{
+    std::vector<Voxel> points{{0, 0, 0}, {1, 0, 0}, {2, 0, 0}};
+    EXPECT_THROW(
+        ChainEnergy(
+            points, kDefaultAlpha, kDefaultK1, kDefaultK2, kDefaultBeta,
+            kDefaultDelta),
+        std::invalid_argument);
+}
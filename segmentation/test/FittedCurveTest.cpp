@@ -189,6 +189,24 @@ TEST(CircleFittedCurve, EvenlySampledCircleCurveHasEvenlySpacedPoints)
     }
 }
 
+// The batched spline evaluation behind sample() matches evaluating each
+// t-value on its own
+TEST(CircleFittedCurve, SampledPointsMatchEval)
+{
+    auto curve = CircleFittedCurve(25, 7)._curve;
+    for (std::size_t count : {2, 17, 100, 333}) {
+        auto points = curve.sample(count);
+        auto ts = makeTVals(count);
+        ASSERT_EQ(points.size(), count);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto p = curve.eval(ts[i]);
+            EXPECT_DOUBLE_EQ(points[i](0), p(0)) << "t = " << ts[i];
+            EXPECT_DOUBLE_EQ(points[i](1), p(1)) << "t = " << ts[i];
+            EXPECT_DOUBLE_EQ(points[i](2), -1);
+        }
+    }
+}
+
 auto makeTVals(std::size_t count) -> std::vector<double>
 {
     std::vector<double> ts(count);
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "vc/segmentation/tff/FloodFill.hpp"
+
+using namespace volcart::segmentation;
+
+static constexpr std::uint16_t LOW{500};
+static constexpr std::uint16_t HIGH{2000};
+
+// Count the points of the image within bound of seed, as measured by
+// EuclideanDistance()
+static auto CountWithinBound(
+    const cv::Mat& img, const cv::Vec3i& seed, int bound, int maxX)
+    -> std::size_t
+{
+    std::size_t count{0};
+    for (int y = 0; y < img.rows; ++y) {
+        for (int x = 0; x < maxX; ++x) {
+            if (EuclideanDistance({x, y, seed[2]}, seed) <= bound) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+TEST(FloodFillTest, DistanceBound)
+{
+    cv::Mat img(50, 60, CV_16UC1, cv::Scalar::all(1000));
+    cv::Vec3i seed{25, 20, 7};
+    auto mask = DoFloodFill({seed}, 6, img, LOW, HIGH);
+
+    EXPECT_EQ(mask.size(), CountWithinBound(img, seed, 6, img.cols));
+    for (const auto& v : mask) {
+        EXPECT_LE(EuclideanDistance(v, seed), 6);
+        EXPECT_EQ(v[2], seed[2]);
+    }
+}
+
+TEST(FloodFillTest, ThresholdBarrier)
+{
+    cv::Mat img(50, 60, CV_16UC1, cv::Scalar::all(1000));
+    img.col(28).setTo(0);
+    cv::Vec3i seed{25, 20, 0};
+    auto mask = DoFloodFill({seed}, 10, img, LOW, HIGH);
+
+    EXPECT_EQ(mask.size(), CountWithinBound(img, seed, 10, 28));
+    for (const auto& v : mask) {
+        EXPECT_LT(v[0], 28);
+    }
+}
+
+TEST(FloodFillTest, MultipleSeeds)
+{
+    cv::Mat img(50, 60, CV_16UC1, cv::Scalar::all(1000));
+    std::vector<cv::Vec3i> seeds{{10, 10, 0}, {12, 10, 0}, {50, 40, 0}};
+    auto mask = DoFloodFill(seeds, 4, img, LOW, HIGH);
+
+    // Each point is filled once and is near at least one seed
+    cv::Mat counts = cv::Mat::zeros(img.size(), CV_32SC1);
+    for (const auto& v : mask) {
+        counts.at<int>(v[1], v[0])++;
+        auto near = false;
+        for (const auto& s : seeds) {
+            near = near || EuclideanDistance(v, s) <= 4;
+        }
+        EXPECT_TRUE(near);
+    }
+    double maxCount;
+    cv::minMaxLoc(counts, nullptr, &maxCount);
+    EXPECT_EQ(maxCount, 1);
+    EXPECT_GE(mask.size(), 2 * CountWithinBound(img, seeds[2], 4, img.cols));
+}
+
+TEST(FloodFillTest, SeedOutsideThreshold)
+{
+    cv::Mat img(20, 20, CV_16UC1, cv::Scalar::all(100));
+    auto mask = DoFloodFill({{5, 5, 0}}, 4, img, LOW, HIGH);
+    EXPECT_TRUE(mask.empty());
+}
@@ -3,6 +3,7 @@
 /** @file */
 
 #include <cstdint>
+#include <vector>
 
 #include "vc/core/neighborhood/NeighborhoodGenerator.hpp"
 #include "vc/texturing/TexturingAlgorithm.hpp"
@@ -188,8 +189,11 @@ private:
     /** Setup the selected weighting method */
     void setup_weights_();
 
-    /** Apply the selected weighting method */
-    auto apply_weights_(NDArray<double>& n) -> NDArray<double>;
+    /**
+     * Clamp, weight, and sum a neighborhood in a single pass using the
+     * selected weighting method
+     */
+    auto integrate_(const Neighborhood& n) const -> double;
 
     /** Linear weighting direction */
     LinearWeightDirection linearWeight_{LinearWeightDirection::Positive};
@@ -200,9 +204,6 @@ private:
     /** Setup the linear weights vector */
     void setup_linear_weights_();
 
-    /** Apply the linear weights vector to a neighborhood */
-    auto apply_linear_weights_(NDArray<double>& n) -> NDArray<double>;
-
     /** Exponential diff exponent */
     int expoDiffExponent_{2};
 
@@ -221,17 +222,17 @@ private:
     /** Setup the expo diff weights */
     void setup_expodiff_weights_();
 
-    /** Get the list of intensities on the surface of the mesh */
-    auto expodiff_intersection_pts_() -> std::vector<std::uint16_t>;
+    /** Intensity histogram type. One bin per 16-bit intensity value. */
+    using Histogram = std::vector<std::uint64_t>;
+
+    /** Get the histogram of intensities on the surface of the mesh */
+    auto expodiff_histogram_() -> Histogram;
 
     /** Calculate the mean base value */
-    auto expodiff_mean_base_() -> double;
+    static auto ExpoDiffMeanBase(const Histogram& h) -> double;
 
     /** Calculate the mode base value */
-    auto expodiff_mode_base_() -> double;
-
-    /** Apply the expo diff weights to a neighborhood */
-    auto apply_expodiff_weights_(NDArray<double>& n) const -> NDArray<double>;
+    static auto ExpoDiffModeBase(const Histogram& h) -> double;
 };
 
 }  // namespace volcart::texturing
@@ -3,6 +3,7 @@
 /** @file */
 
 #include <cstddef>
+#include <vector>
 
 #include "vc/core/types/ITKMesh.hpp"
 #include "vc/core/types/Mixins.hpp"
@@ -19,6 +20,12 @@ namespace volcart::texturing
  * correspond to the 3D position and normal vector associated with that pixel:
  * `{x, y, z, nx, ny, nz}`
  *
+ * After a local edit to the mesh or UV map, computeIncremental() updates an
+ * existing PPM in place. Only the pixels which were produced by, or are now
+ * covered by, the changed faces are recomputed. The edit must not change the
+ * mesh topology: face and vertex IDs must match those used to generate the
+ * original PPM.
+ *
  * This class uses raytracing functionality provided by the
  * [bvh library](https://github.com/madmann91/bvh).
  *
@@ -63,20 +70,62 @@ public:
     void setShading(Shading s);
     /**@}*/
 
+    /**@{*/
+    /** @brief Set the IDs of faces changed since the PPM was generated */
+    void setDirtyFaces(std::vector<std::size_t> faces);
+
+    /** @brief Set the IDs of vertices changed since the PPM was generated */
+    void setDirtyVertices(std::vector<std::size_t> vertices);
+    /**@}*/
+
     /**@{*/
     /** @brief Compute the PerPixelMap */
     auto compute() -> PerPixelMap::Pointer;
+
+    /**
+     * @brief Recompute the dirty region of an existing PerPixelMap
+     *
+     * Updates @p ppm in place and returns it. A pixel is recomputed if its
+     * cell map entry references a dirty face, or if it falls within the UV
+     * bounds of a dirty face. Faces which share a dirty vertex are dirty. When
+     * using Shading::Smooth, faces which share a vertex with a dirty face are
+     * also dirty, since their interpolated normals may have changed.
+     *
+     * @throws std::invalid_argument if the PPM dimensions do not match the
+     * generator dimensions or if the PPM does not have a cell map.
+     */
+    auto computeIncremental(const PerPixelMap::Pointer& ppm)
+        -> PerPixelMap::Pointer;
     /**@}*/
 
     /**@{*/
     /** @brief Get the generated PerPixelMap */
     [[nodiscard]] auto getPPM() const -> PerPixelMap::Pointer;
+
+    /**
+     * @brief Get the mask of pixels recomputed by computeIncremental()
+     *
+     * 8bpc, single channel image with the dimensions of the PPM. Recomputed
+     * pixels are 255. Pass to TexturingAlgorithm::computeDirty() to update a
+     * previously generated texture.
+     */
+    [[nodiscard]] auto dirtyMask() const -> cv::Mat;
     /**@}*/
 
     /** @brief Returns the maximum progress value */
     [[nodiscard]] auto progressIterations() const -> std::size_t override;
 
 private:
+    /** Validate the inputs and setup the working mesh */
+    void prepare_();
+    /** Build the set of dirty pixels from the dirty faces and vertices */
+    auto dirty_pixels_(const cv::Mat& cellMap) const -> cv::Mat;
+    /**
+     * Map the pixels selected by @p selection into ppm_. If @p selection is
+     * empty, all pixels are mapped.
+     */
+    void map_pixels_(const cv::Mat& selection, cv::Mat& mask, cv::Mat& cellMap);
+
     /** Input mesh */
     ITKMesh::Pointer inputMesh_;
     /** Input UV Map */
@@ -92,6 +141,12 @@ private:
     std::size_t width_{0};
     /** Output height of the PerPixelMap */
     std::size_t height_{0};
+    /** Faces changed since the PPM was generated */
+    std::vector<std::size_t> dirtyFaces_;
+    /** Vertices changed since the PPM was generated */
+    std::vector<std::size_t> dirtyVertices_;
+    /** Pixels recomputed by the last call to computeIncremental() */
+    cv::Mat dirtyMask_;
 };
 
 /**
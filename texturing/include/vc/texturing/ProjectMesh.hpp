@@ -32,6 +32,10 @@ namespace volcart::texturing
  * By default, the last mesh intersection point is used for each ray, optionally
  * this may be changed to the first intersection point.
  *
+ * The image plane is projected in parallel, one tile of coherent rays at a
+ * time. If the registration transform is affine-only, it is flattened into a
+ * single matrix before projection.
+ *
  * This class uses raytracing functionality provided by the
  * [bvh library](https://github.com/madmann91/bvh).
  *
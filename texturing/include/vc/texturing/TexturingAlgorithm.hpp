@@ -3,6 +3,7 @@
 /** @file */
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 
 #include "vc/core/neighborhood/NeighborhoodGenerator.hpp"
@@ -21,6 +22,12 @@ public:
     /** Image outputs */
     using Texture = std::vector<cv::Mat>;
 
+    /** Default number of PPM mappings in a parallel sampling batch */
+    static constexpr std::size_t DEFAULT_BATCH_SIZE{4096};
+
+    /** Default edge length of a tile recomputed by computeDirty() */
+    static constexpr int DEFAULT_TILE_SIZE{256};
+
     /** Default destructor for virtual base class */
     virtual ~TexturingAlgorithm() = default;
 
@@ -36,6 +43,38 @@ public:
     /** @brief Get the generated Texture */
     auto getTexture() -> Texture;
 
+    /**
+     * @brief Recompute the dirty pixels of the previously computed Texture
+     *
+     * The dirty mask is split into square tiles. For every tile containing a
+     * dirty pixel, the input PPM is cropped to the tile and compute() is run
+     * on the crop. The dirty pixels of the result are then copied into the
+     * existing Texture, which is updated in place and returned.
+     *
+     * Use with PPMGenerator::computeIncremental() and
+     * PPMGenerator::dirtyMask() to update a texture after a local mesh edit.
+     *
+     * @warning Algorithms which normalize or otherwise post-process the whole
+     * output image (e.g. ThicknessTexture with setNormalizeOutput(true)) will
+     * produce tiles that do not match the rest of the Texture.
+     *
+     * @throws std::logic_error if compute() has not been run
+     * @throws std::invalid_argument if the mask and PPM sizes do not match
+     */
+    auto computeDirty(
+        const cv::Mat& dirtyMask, int tileSize = DEFAULT_TILE_SIZE) -> Texture;
+
+    /**
+     * @brief Set the number of PPM mappings per parallel sampling batch
+     *
+     * Only used by algorithms which sample through
+     * parallelForEachMapping_().
+     */
+    void setSamplingBatchSize(std::size_t b);
+
+    /** @copydoc setSamplingBatchSize(std::size_t) */
+    [[nodiscard]] auto samplingBatchSize() const -> std::size_t;
+
     /** @brief Returns the maximum progress value */
     [[nodiscard]] auto progressIterations() const -> std::size_t override;
 
@@ -51,11 +90,30 @@ protected:
     /** Default move operator */
     auto operator=(TexturingAlgorithm&&) -> TexturingAlgorithm& = default;
 
+    /** Per-mapping function. Receives the (y, x) PPM position. */
+    using MappingFunction = std::function<void(std::size_t, std::size_t)>;
+
+    /**
+     * @brief Evaluate a function for every PPM mapping in parallel
+     *
+     * Mappings are sorted by Z and split into contiguous batches, so each
+     * thread only touches a narrow band of slices at a time. Batches are
+     * dynamically scheduled across threads, progress is reported once per
+     * finished batch, and the throughput in mapped pixels per second is logged
+     * on completion.
+     *
+     * @warning fn is called concurrently and must only write to state owned
+     * by the mapping it was given.
+     */
+    void parallelForEachMapping_(const MappingFunction& fn);
+
     /** PPM */
     PerPixelMap::Pointer ppm_;
     /** Volume */
     Volume::Pointer vol_;
     /** Result */
     Texture result_;
+    /** Mappings per parallel sampling batch */
+    std::size_t batchSize_{DEFAULT_BATCH_SIZE};
 };
 }  // namespace volcart::texturing
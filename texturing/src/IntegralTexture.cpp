@@ -1,19 +1,24 @@
 #include "vc/texturing/IntegralTexture.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
-#include <map>
-#include <set>
+#include <iterator>
+#include <limits>
 
 #include <opencv2/core.hpp>
 
-#include "vc/core/util/Iteration.hpp"
-
 using namespace volcart;
 using namespace volcart::texturing;
 
 using Texture = IntegralTexture::Texture;
 
+/** Maximum 16-bit intensity value */
+static constexpr double MAX_INTENSITY{std::numeric_limits<std::uint16_t>::max()};
+/** Number of bins in a 16-bit intensity histogram */
+static constexpr std::size_t HISTOGRAM_BINS{
+    std::numeric_limits<std::uint16_t>::max() + std::size_t{1}};
+
 auto IntegralTexture::compute() -> Texture
 {
     // Setup
@@ -28,49 +33,19 @@ auto IntegralTexture::compute() -> Texture
     // Output image
     cv::Mat image = cv::Mat::zeros(height, width, CV_32FC1);
 
-    // Get the mappings
-    auto mappings = ppm_->getMappingCoords();
-
-    // Sort the mappings by Z-value
-    std::sort(
-        mappings.begin(), mappings.end(),
-        [&](const auto& lhs, const auto& rhs) {
-            return (*ppm_)(lhs.y, lhs.x)[2] < (*ppm_)(rhs.y, rhs.x)[2];
-        });
-
-    // Iterate through the mappings
-    progressStarted();
-    for (const auto [idx, coord] : enumerate(mappings)) {
-        progressUpdated(idx);
-
+    // Integrate the neighborhood at every mapping
+    parallelForEachMapping_([&](std::size_t y, std::size_t x) {
         // Generate the neighborhood
-        const auto [y, x] = coord;
         const auto& m = ppm_->getMapping(y, x);
         const cv::Vec3d pos{m[0], m[1], m[2]};
         const cv::Vec3d normal{m[3], m[4], m[5]};
         auto n = gen_->compute(vol_, pos, {normal});
 
-        // Clamp values
-        if (clampToMax_) {
-            std::replace_if(
-                n.begin(), n.end(),
-                [this](std::uint16_t v) { return v > clampMax_; }, clampMax_);
-        }
-
-        // Convert to double and weight the neighborhood
-        NDArray<double> neighborhoodD(
-            n.dims(), n.extents(), n.begin(), n.end());
-        auto weighted = apply_weights_(neighborhoodD);
-
-        // Sum the neighborhood
-        auto value = std::accumulate(weighted.begin(), weighted.end(), 0.0);
-
         // Assign the intensity value at the UV position
         const auto v = static_cast<int>(y);
         const auto u = static_cast<int>(x);
-        image.at<float>(v, u) = static_cast<float>(value);
-    }
-    progressComplete();
+        image.at<float>(v, u) = static_cast<float>(integrate_(n));
+    });
 
     cv::normalize(image, image, 0.0, 1.0, cv::NORM_MINMAX);
 
@@ -93,16 +68,61 @@ void IntegralTexture::setup_weights_()
     }
 }
 
-auto IntegralTexture::apply_weights_(NDArray<double>& n) -> NDArray<double>
+auto IntegralTexture::integrate_(const Neighborhood& n) const -> double
 {
+    // Clamping is folded into the weighting loops as a min()
+    const auto* vals = n.data();
+    const auto size = n.size();
+    const double maxVal = (clampToMax_) ? clampMax_ : MAX_INTENSITY;
+
+    double sum{0};
     switch (weight_) {
-        case WeightMethod::None:
-            return n;
-        case WeightMethod::Linear:
-            return apply_linear_weights_(n);
-        case WeightMethod::ExpoDiff:
-            return apply_expodiff_weights_(n);
+        case WeightMethod::None: {
+#pragma omp simd reduction(+ : sum)
+            for (std::size_t i = 0; i < size; i++) {
+                sum += std::min(static_cast<double>(vals[i]), maxVal);
+            }
+            break;
+        }
+        case WeightMethod::Linear: {
+            const auto* weights = linearWeights_.data();
+#pragma omp simd reduction(+ : sum)
+            for (std::size_t i = 0; i < size; i++) {
+                auto val = std::min(static_cast<double>(vals[i]), maxVal);
+                sum += val * weights[i];
+            }
+            break;
+        }
+        case WeightMethod::ExpoDiff: {
+            const auto base = expoDiffBase_;
+            const auto suppress = suppressBelowBase_;
+            const auto exponent = expoDiffExponent_;
+
+            // Negative exponents need a real pow()
+            if (exponent < 0) {
+                for (std::size_t i = 0; i < size; i++) {
+                    auto val = std::min(static_cast<double>(vals[i]), maxVal);
+                    auto w = std::pow(std::abs(val - base), exponent);
+                    sum += (suppress and base >= val) ? 0.0 : w;
+                }
+                break;
+            }
+
+#pragma omp simd reduction(+ : sum)
+            for (std::size_t i = 0; i < size; i++) {
+                auto val = std::min(static_cast<double>(vals[i]), maxVal);
+                auto diff = std::abs(val - base);
+                double w{1};
+                for (int e = 0; e < exponent; e++) {
+                    w *= diff;
+                }
+                sum += (suppress and base >= val) ? 0.0 : w;
+            }
+            break;
+        }
     }
+
+    return sum;
 }
 
 ///// Linear weighting /////
@@ -135,15 +155,6 @@ void IntegralTexture::setup_linear_weights_()
     }
 }
 
-auto IntegralTexture::apply_linear_weights_(NDArray<double>& n)
-    -> NDArray<double>
-{
-    std::vector<double> weighted;
-    cv::multiply(n.as_vector(), linearWeights_.as_vector(), weighted);
-    return NDArray<double>(
-        n.dims(), n.extents(), weighted.begin(), weighted.end());
-}
-
 ///// Exponential Difference weighting /////
 void IntegralTexture::setup_expodiff_weights_()
 {
@@ -152,82 +163,66 @@ void IntegralTexture::setup_expodiff_weights_()
             expoDiffBase_ = expoDiffManualBase_;
             return;
         case ExpoDiffBaseMethod::Mean:
-            expoDiffBase_ = expodiff_mean_base_();
+            expoDiffBase_ = ExpoDiffMeanBase(expodiff_histogram_());
             return;
         case ExpoDiffBaseMethod::Mode:
-            expoDiffBase_ = expodiff_mode_base_();
+            expoDiffBase_ = ExpoDiffModeBase(expodiff_histogram_());
             return;
     }
 }
 
-auto IntegralTexture::expodiff_intersection_pts_() -> std::vector<std::uint16_t>
+auto IntegralTexture::expodiff_histogram_() -> Histogram
 {
-    // Get all the intensity values
-    std::vector<std::uint16_t> values;
-    for (const auto [y, x] : ppm_->getMappingCoords()) {
-        const auto& m = ppm_->getMapping(y, x);
-        values.emplace_back(vol_->interpolateAt({m[0], m[1], m[2]}));
-    }
+    // Sort the mappings by Z-value
+    auto mappings = ppm_->getMappingCoords();
+    std::sort(
+        mappings.begin(), mappings.end(),
+        [&](const auto& lhs, const auto& rhs) {
+            return (*ppm_)(lhs.y, lhs.x)[2] < (*ppm_)(rhs.y, rhs.x)[2];
+        });
 
-    return values;
-}
+    // Each thread fills a private histogram which is merged at the end
+    Histogram histogram(HISTOGRAM_BINS, 0);
+#pragma omp parallel
+    {
+        Histogram local(HISTOGRAM_BINS, 0);
+#pragma omp for schedule(dynamic, 4096) nowait
+        for (std::size_t i = 0; i < mappings.size(); i++) {
+            const auto& m = ppm_->getMapping(mappings[i].y, mappings[i].x);
+            local[vol_->interpolateAt({m[0], m[1], m[2]})]++;
+        }
 
-auto IntegralTexture::expodiff_mean_base_() -> double
-{
-    // Get intersection points
-    auto values = expodiff_intersection_pts_();
-
-    // Calculate the mean
-    std::size_t n = 0;
-    double mean = 0.0;
-    for (const auto& v : values) {
-        double delta = v - mean;
-        mean += delta / static_cast<double>(++n);
+#pragma omp critical(integral_texture_histogram)
+        {
+            for (std::size_t b = 0; b < HISTOGRAM_BINS; b++) {
+                histogram[b] += local[b];
+            }
+        }
     }
 
-    return mean;
+    return histogram;
 }
 
-auto IntegralTexture::expodiff_mode_base_() -> double
+auto IntegralTexture::ExpoDiffMeanBase(const Histogram& h) -> double
 {
-    // Get intersection points
-    auto values = expodiff_intersection_pts_();
-
-    // Generate a histogram
-    std::map<std::uint16_t, int> histogram;
-    for (const auto& v : values) {
-        try {
-            histogram.at(v) += 1;
-        } catch (const std::out_of_range&) {
-            histogram[v] = 1;
-        }
+    double sum{0};
+    std::uint64_t count{0};
+    for (std::size_t b = 0; b < h.size(); b++) {
+        sum += static_cast<double>(b) * static_cast<double>(h[b]);
+        count += h[b];
     }
 
-    // Sort by frequency high to low
-    using KVPair = std::pair<std::uint16_t, int>;
-    using Comparator = std::function<bool(KVPair, KVPair)>;
-    Comparator compare = [](KVPair a, KVPair b) { return a.second > b.second; };
-    std::set<KVPair, Comparator> sorter(
-        histogram.begin(), histogram.end(), compare);
-
-    // Return the top candidate
-    return sorter.begin()->first;
+    return (count == 0) ? 0.0 : sum / static_cast<double>(count);
 }
 
-auto IntegralTexture::apply_expodiff_weights_(NDArray<double>& n) const
-    -> NDArray<double>
+auto IntegralTexture::ExpoDiffModeBase(const Histogram& h) -> double
 {
-    std::vector<double> vals;
-    for (const auto& val : n) {
-        if (suppressBelowBase_ && expoDiffBase_ >= val) {
-            vals.emplace_back(0);
-            continue;
-        }
-        double diff = std::abs(val - expoDiffBase_);
-        vals.emplace_back(std::pow(diff, expoDiffExponent_));
+    // Ties resolve to the lowest intensity value
+    auto mode = std::max_element(h.begin(), h.end());
+    if (mode == h.end() or *mode == 0) {
+        return 0;
     }
-
-    return NDArray<double>(n.dims(), n.extents(), vals.begin(), vals.end());
+    return static_cast<double>(std::distance(h.begin(), mode));
 }
 
 auto IntegralTexture::New() -> IntegralTexture::Pointer
@@ -1,6 +1,5 @@
 #include "vc/texturing/IntersectionTexture.hpp"
 
-#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
@@ -24,28 +23,13 @@ auto IntersectionTexture::compute() -> Texture
     // Output image
     cv::Mat image = cv::Mat::zeros(height, width, CV_16UC1);
 
-    // Get the mappings
-    auto mappings = ppm_->getMappingCoords();
-
-    // Sort the mappings by Z-value
-    std::sort(
-        mappings.begin(), mappings.end(),
-        [&](const auto& lhs, const auto& rhs) {
-            return (*ppm_)(lhs.y, lhs.x)[2] < (*ppm_)(rhs.y, rhs.x)[2];
-        });
-
-    // Iterate through the mappings
-    std::size_t counter{0};
-    progressStarted();
-    for (const auto [y, x] : mappings) {
-        progressUpdated(counter++);
-
+    // Sample the volume at every mapping
+    parallelForEachMapping_([&](std::size_t y, std::size_t x) {
         // Assign the intensity value at the XY position
         const auto& m = ppm_->getMapping(y, x);
         image.at<std::uint16_t>(static_cast<int>(y), static_cast<int>(x)) =
             vol_->interpolateAt({m[0], m[1], m[2]});
-    }
-    progressComplete();
+    });
 
     // Set output
     result_.push_back(image);
@@ -1,7 +1,10 @@
 #include "vc/texturing/PPMGenerator.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <exception>
+#include <utility>
 
 #include <bvh/bvh.hpp>
 #include <bvh/primitive_intersectors.hpp>
@@ -56,8 +59,79 @@ auto PPMGenerator::progressIterations() const -> std::size_t
     return width_ * height_;
 }
 
+void PPMGenerator::setDirtyFaces(std::vector<std::size_t> faces)
+{
+    dirtyFaces_ = std::move(faces);
+}
+
+void PPMGenerator::setDirtyVertices(std::vector<std::size_t> vertices)
+{
+    dirtyVertices_ = std::move(vertices);
+}
+
+auto PPMGenerator::dirtyMask() const -> cv::Mat { return dirtyMask_; }
+
 // Compute
 auto PPMGenerator::compute() -> PerPixelMap::Pointer
+{
+    prepare_();
+
+    // Setup the output
+    ppm_ = PerPixelMap::New(height_, width_);
+    cv::Mat mask = cv::Mat::zeros(height_, width_, CV_8UC1);
+    cv::Mat cellMap = cv::Mat(height_, width_, CV_32SC1);
+    cellMap = cv::Scalar::all(-1);
+
+    // Map every pixel
+    map_pixels_(cv::Mat(), mask, cellMap);
+
+    // Finish setting up the output
+    ppm_->setMask(mask);
+    ppm_->setCellMap(cellMap);
+
+    return ppm_;
+}
+
+auto PPMGenerator::computeIncremental(const PerPixelMap::Pointer& ppm)
+    -> PerPixelMap::Pointer
+{
+    if (not ppm or ppm->height() != height_ or ppm->width() != width_) {
+        throw std::invalid_argument("PPM dimensions do not match generator");
+    }
+    if (ppm->cellMap().empty()) {
+        throw std::invalid_argument("PPM does not have a cell map");
+    }
+    prepare_();
+
+    // Work on the existing output
+    ppm_ = ppm;
+    auto cellMap = ppm_->cellMap();
+    auto mask = ppm_->mask();
+    if (mask.empty()) {
+        mask = cv::Mat(height_, width_, CV_8UC1, cv::Scalar::all(MASK_TRUE));
+    }
+
+    // Clear the dirty pixels
+    dirtyMask_ = dirty_pixels_(cellMap);
+    mask.setTo(0, dirtyMask_);
+    cellMap.setTo(-1, dirtyMask_);
+    for (const auto [y, x] : range2D(height_, width_)) {
+        if (dirtyMask_.at<std::uint8_t>(y, x) != 0) {
+            ppm_->getMapping(y, x) = cv::Vec6d::all(0);
+        }
+    }
+
+    // Map the dirty pixels
+    map_pixels_(dirtyMask_, mask, cellMap);
+
+    // Finish setting up the output
+    ppm_->setMask(mask);
+    ppm_->setCellMap(cellMap);
+
+    return ppm_;
+}
+
+void PPMGenerator::prepare_()
 {
     if (inputMesh_.IsNull() || inputMesh_->GetNumberOfPoints() == 0 ||
         inputMesh_->GetNumberOfCells() == 0 || not uvMap_ || uvMap_->empty() ||
@@ -74,13 +148,101 @@ auto PPMGenerator::compute() -> PerPixelMap::Pointer
     } else {
         workingMesh_ = inputMesh_;
     }
+}
+
+auto PPMGenerator::dirty_pixels_(const cv::Mat& cellMap) const -> cv::Mat
+{
+    // Collect the dirty vertices
+    std::vector<bool> dirtyVerts(workingMesh_->GetNumberOfPoints(), false);
+    for (const auto& v : dirtyVertices_) {
+        if (v < dirtyVerts.size()) {
+            dirtyVerts[v] = true;
+        }
+    }
+    std::vector<bool> dirtyFaces(workingMesh_->GetNumberOfCells(), false);
+    for (const auto& f : dirtyFaces_) {
+        if (f < dirtyFaces.size()) {
+            dirtyFaces[f] = true;
+        }
+    }
 
-    // Setup the output
-    ppm_ = PerPixelMap::New(height_, width_);
-    cv::Mat mask = cv::Mat::zeros(height_, width_, CV_8UC1);
-    cv::Mat cellMap = cv::Mat(height_, width_, CV_32SC1);
-    cellMap = cv::Scalar::all(-1);
+    // Faces sharing a dirty vertex are dirty. With smooth shading, a moved
+    // vertex changes the normals of its neighbors, so grow by one ring.
+    auto markFaces = [&]() {
+        for (auto cell = workingMesh_->GetCells()->Begin();
+             cell != workingMesh_->GetCells()->End(); ++cell) {
+            const auto* c = cell->Value();
+            for (auto id = c->PointIdsBegin(); id != c->PointIdsEnd(); ++id) {
+                if (dirtyVerts[*id]) {
+                    dirtyFaces[cell->Index()] = true;
+                    break;
+                }
+            }
+        }
+    };
+    auto markVertices = [&]() {
+        for (auto cell = workingMesh_->GetCells()->Begin();
+             cell != workingMesh_->GetCells()->End(); ++cell) {
+            if (not dirtyFaces[cell->Index()]) {
+                continue;
+            }
+            const auto* c = cell->Value();
+            for (auto id = c->PointIdsBegin(); id != c->PointIdsEnd(); ++id) {
+                dirtyVerts[*id] = true;
+            }
+        }
+    };
+    markFaces();
+    if (shading_ == Shading::Smooth) {
+        markVertices();
+        markFaces();
+    }
+
+    // Pixels previously produced by a dirty face
+    cv::Mat dirty = cv::Mat::zeros(height_, width_, CV_8UC1);
+    for (const auto [y, x] : range2D(height_, width_)) {
+        auto cellId = cellMap.at<std::int32_t>(y, x);
+        if (cellId >= 0 and cellId < static_cast<int>(dirtyFaces.size()) and
+            dirtyFaces[cellId]) {
+            dirty.at<std::uint8_t>(y, x) = MASK_TRUE;
+        }
+    }
 
+    // Pixels covered by the current UV bounds of a dirty face
+    const cv::Rect bounds(0, 0, width_, height_);
+    for (auto cell = workingMesh_->GetCells()->Begin();
+         cell != workingMesh_->GetCells()->End(); ++cell) {
+        if (not dirtyFaces[cell->Index()]) {
+            continue;
+        }
+        double uMin{1};
+        double uMax{0};
+        double vMin{1};
+        double vMax{0};
+        const auto* c = cell->Value();
+        for (auto id = c->PointIdsBegin(); id != c->PointIdsEnd(); ++id) {
+            auto uv = uvMap_->get(*id);
+            uMin = std::min(uMin, uv[0]);
+            uMax = std::max(uMax, uv[0]);
+            vMin = std::min(vMin, uv[1]);
+            vMax = std::max(vMax, uv[1]);
+        }
+        auto x0 = static_cast<int>(std::floor(uMin * (width_ - 1)));
+        auto x1 = static_cast<int>(std::ceil(uMax * (width_ - 1)));
+        auto y0 = static_cast<int>(std::floor(vMin * (height_ - 1)));
+        auto y1 = static_cast<int>(std::ceil(vMax * (height_ - 1)));
+        auto roi = cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1) & bounds;
+        if (not roi.empty()) {
+            dirty(roi).setTo(MASK_TRUE);
+        }
+    }
+
+    return dirty;
+}
+
+void PPMGenerator::map_pixels_(
+    const cv::Mat& selection, cv::Mat& mask, cv::Mat& cellMap)
+{
     // Create BVH for mesh
     std::vector<Triangle> triangles;
     for (auto cell = workingMesh_->GetCells()->Begin();
@@ -114,6 +276,10 @@ auto PPMGenerator::compute() -> PerPixelMap::Pointer
     ITKCell::CellAutoPointer cell;
     for (const auto [y, x] : range2D(height_, width_)) {
         progressUpdated(y * width_ + x);
+        if (not selection.empty() and selection.at<std::uint8_t>(y, x) == 0) {
+            continue;
+        }
+
         // This pixel's uv coordinate
         cv::Vec3d uv{0, 0, 0};
         uv[0] = static_cast<double>(x) / static_cast<double>(width_ - 1);
@@ -185,12 +351,6 @@ auto PPMGenerator::compute() -> PerPixelMap::Pointer
             xyz(0), xyz(1), xyz(2), xyzNorm(0), xyzNorm(1), xyzNorm(2));
     }
     progressComplete();
-
-    // Finish setting up the output
-    ppm_->setMask(mask);
-    ppm_->setCellMap(cellMap);
-
-    return ppm_;
 }
 
 auto vct::GenerateCellMap(
@@ -1,5 +1,7 @@
 #include "vc/texturing/ProjectMesh.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <utility>
 
@@ -11,13 +13,12 @@
 #include <bvh/triangle.hpp>
 #include <bvh/vector.hpp>
 #include <vtkOBBTree.h>
-#include <vtkPointData.h>
 
 #include "vc/core/util/BarycentricCoordinates.hpp"
-#include "vc/core/util/Iteration.hpp"
 #include "vc/meshing/ITK2VTK.hpp"
 
 static constexpr std::uint8_t MASK_TRUE{255};
+static constexpr int TILE_SIZE{16};
 
 using Scalar = double;
 using Vector3 = bvh::Vector3<Scalar>;
@@ -119,11 +120,13 @@ auto vct::ProjectMesh::compute() -> vc::PerPixelMap
 
     // Create BVH for mesh
     std::vector<Triangle> triangles;
+    std::vector<std::array<ITKMesh::PointIdentifier, 3>> faces;
     for (auto cell = inputMesh_->GetCells()->Begin();
          cell != inputMesh_->GetCells()->End(); ++cell) {
         auto aIdx = cell.Value()->GetPointIdsContainer()[0];
         auto bIdx = cell.Value()->GetPointIdsContainer()[1];
         auto cIdx = cell.Value()->GetPointIdsContainer()[2];
+        faces.push_back({aIdx, bIdx, cIdx});
 
         auto a = inputMesh_->GetPoint(aIdx);
         auto b = inputMesh_->GetPoint(bIdx);
@@ -141,8 +144,20 @@ auto vct::ProjectMesh::compute() -> vc::PerPixelMap
     auto meshBBox =
         bvh::compute_bounding_boxes_union(bboxes.get(), triangles.size());
     builder.build(meshBBox, bboxes.get(), centers.get(), triangles.size());
-    Intersector intersector(bvh, triangles.data());
-    Traverser traverser(bvh);
+
+    // Copy vertex positions and normals out of the mesh so that the
+    // projection loop does not touch ITK/VTK containers from worker threads
+    std::vector<cv::Vec3d> vertices(inputMesh_->GetNumberOfPoints());
+    std::vector<cv::Vec3d> normals(inputMesh_->GetNumberOfPoints());
+    for (auto point = inputMesh_->GetPoints()->Begin();
+         point != inputMesh_->GetPoints()->End(); ++point) {
+        const auto& p = point.Value();
+        vertices[point.Index()] = {p[0], p[1], p[2]};
+        ITKPixel normal;
+        if (inputMesh_->GetPointData(point.Index(), &normal)) {
+            normals[point.Index()] = {normal[0], normal[1], normal[2]};
+        }
+    }
 
     auto tfm = tfm_;
     if (useInverse_) {
@@ -150,14 +165,34 @@ auto vct::ProjectMesh::compute() -> vc::PerPixelMap
             tfm_->GetInverseTransform().GetPointer());
     }
 
-    // Loop over every pixel of the image
-    for (const auto uv : vc::range2D(ppmHeight_, ppmWidth_)) {
-        const auto& u = uv.second;
-        const auto& v = uv.first;
+    // Flatten an affine-only transform into a single 2x3 matrix so that the
+    // projection loop doesn't dispatch through every transform in the stack
+    bool affineOnly = tfm and tfm->IsLinear();
+    cv::Matx23d affine;
+    if (affineOnly) {
+        Point p;
+        p[0] = p[1] = 0;
+        auto o = tfm->TransformPoint(p);
+        p[0] = 1;
+        auto ex = tfm->TransformPoint(p);
+        p[0] = 0;
+        p[1] = 1;
+        auto ey = tfm->TransformPoint(p);
+        affine = cv::Matx23d(
+            ex[0] - o[0], ey[0] - o[0], o[0], ex[1] - o[1], ey[1] - o[1],
+            o[1]);
+    }
 
+    // Map a pixel position to the ray origin
+    const auto rayLength = cv::norm(b2) * 2;
+    auto rayOrigin = [&](int u, int v) {
         cv::Vec3d uOffset;
         cv::Vec3d vOffset;
-        if (tfm) {
+        if (affineOnly) {
+            auto pT = affine * cv::Vec3d(u, v, 1);
+            uOffset = pT[0] / textureWidth_ * b0;
+            vOffset = pT[1] / textureHeight_ * b1;
+        } else if (tfm) {
             Point p;
             p[0] = u;
             p[1] = v;
@@ -170,62 +205,77 @@ auto vct::ProjectMesh::compute() -> vc::PerPixelMap
             vOffset = v * sampleRateY_ * normedY;
         }
 
-        auto a0 = origin + uOffset + vOffset;
-        auto a1 = b2;
+        cv::Vec3d a0 = origin + uOffset + vOffset;
         if (not useFirstIntersection_) {
             a0 += b2 * cv::norm(b2);
-            a1 *= -1;
         }
-
-        // Intersect a ray with the data structure
-        Vector3 start(a0[0], a0[1], a0[2]);
-        Vector3 dir(a1[0], a1[1], a1[2]);
-        Ray ray(start, dir, 0.0, cv::norm(b2) * 2);
-        auto hit = traverser.traverse(ray, intersector);
-        if (not hit) {
-            continue;
+        return a0;
+    };
+    cv::Vec3d a1 = (useFirstIntersection_) ? b2 : -b2;
+    const Vector3 dir(a1[0], a1[1], a1[2]);
+
+    // Project the image in tiles. All rays share a direction, so the rays of
+    // a tile are coherent and traverse the same BVH nodes back-to-back.
+    const auto tilesX = (ppmWidth_ + TILE_SIZE - 1) / TILE_SIZE;
+    const auto tilesY = (ppmHeight_ + TILE_SIZE - 1) / TILE_SIZE;
+#pragma omp parallel
+    {
+        Intersector intersector(bvh, triangles.data());
+        Traverser traverser(bvh);
+
+        // Loop over every tile of the image
+#pragma omp for schedule(dynamic)
+        for (int tile = 0; tile < tilesX * tilesY; tile++) {
+            const auto v0 = (tile / tilesX) * TILE_SIZE;
+            const auto u0 = (tile % tilesX) * TILE_SIZE;
+            const auto v1 = std::min(v0 + TILE_SIZE, ppmHeight_);
+            const auto u1 = std::min(u0 + TILE_SIZE, ppmWidth_);
+
+            // Loop over every pixel of the tile
+            for (int v = v0; v < v1; v++) {
+                for (int u = u0; u < u1; u++) {
+                    // Intersect a ray with the data structure
+                    auto a0 = rayOrigin(u, v);
+                    Vector3 start(a0[0], a0[1], a0[2]);
+                    Ray ray(start, dir, 0.0, rayLength);
+                    auto hit = traverser.traverse(ray, intersector);
+                    if (not hit) {
+                        continue;
+                    }
+
+                    // Cell info
+                    auto cellId = hit->primitive_index;
+                    const auto& face = faces[cellId];
+
+                    // Get the 3D positions of each vertex
+                    const auto& A = vertices[face[0]];
+                    const auto& B = vertices[face[1]];
+                    const auto& C = vertices[face[2]];
+
+                    // Intersection point UV coords
+                    auto inter = hit->intersection;
+                    cv::Vec3d bCoord{inter.u, inter.v, 1 - inter.u - inter.v};
+
+                    // Get the 3D position of the intersection pt
+                    auto xyz = BarycentricToCartesian(bCoord, A, B, C);
+
+                    // Interpolate the vertex normal for this point
+                    auto bary = CartesianToBarycentric(xyz, A, B, C);
+                    auto xyzNorm = BarycentricNormalInterpolation(
+                        bary, normals[face[0]], normals[face[1]],
+                        normals[face[2]]);
+
+                    // Assign the cell index to the cell map
+                    cellMap.at<std::int32_t>(v, u) = static_cast<int>(cellId);
+
+                    // Assign 3D position to the lookup map and update the mask
+                    outputPPM_(v, u) = cv::Vec6d{
+                        xyz(0),     xyz(1),     xyz(2),
+                        xyzNorm(0), xyzNorm(1), xyzNorm(2)};
+                    mask.at<std::uint8_t>(v, u) = MASK_TRUE;
+                }
+            }
         }
-
-        // Cell info
-        auto cellId = static_cast<vtkIdType>(hit->primitive_index);
-        auto pointIds = vtkSmartPointer<vtkIdList>::New();
-        vtkMesh->GetCellPoints(cellId, pointIds);
-
-        // Make sure we only have three vertices
-        assert(pointIds->GetNumberOfIds() == 3);
-        auto v_id0 = pointIds->GetId(0);
-        auto v_id1 = pointIds->GetId(1);
-        auto v_id2 = pointIds->GetId(2);
-
-        // Get the 3D positions of each vertex
-        cv::Vec3d A{vtkMesh->GetPoint(v_id0)};
-        cv::Vec3d B{vtkMesh->GetPoint(v_id1)};
-        cv::Vec3d C{vtkMesh->GetPoint(v_id2)};
-
-        // Intersection point UV coords
-        auto inter = hit->intersection;
-        cv::Vec3d bCoord{inter.u, inter.v, 1 - inter.u - inter.v};
-
-        // Get the 3D position of the intersection pt
-        auto xyz = BarycentricToCartesian(bCoord, A, B, C);
-
-        // Interpolate the vertex normal for this point
-        cv::Vec3d n0, n1, n2;
-        auto bary = CartesianToBarycentric(xyz, A, B, C);
-        vtkMesh->GetPointData()->GetNormals()->GetTuple(v_id0, n0.val);
-        vtkMesh->GetPointData()->GetNormals()->GetTuple(v_id1, n1.val);
-        vtkMesh->GetPointData()->GetNormals()->GetTuple(v_id2, n2.val);
-        auto xyzNorm = BarycentricNormalInterpolation(bary, n0, n1, n2);
-
-        // Assign the cell index to the cell map
-        auto intU = static_cast<int>(u);
-        auto intV = static_cast<int>(v);
-        cellMap.at<std::int32_t>(intV, intU) = static_cast<int>(cellId);
-
-        // Assign 3D position to the lookup map and update the mask
-        outputPPM_(v, u) = cv::Vec6d{xyz(0),     xyz(1),     xyz(2),
-                                     xyzNorm(0), xyzNorm(1), xyzNorm(2)};
-        mask.at<std::uint8_t>(v, u) = MASK_TRUE;
     }
 
     outputPPM_.setMask(mask);
@@ -1,5 +1,12 @@
 #include "vc/texturing/TexturingAlgorithm.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "vc/core/util/Logging.hpp"
+
+using namespace volcart;
 using namespace volcart::texturing;
 
 void TexturingAlgorithm::setPerPixelMap(PerPixelMap::Pointer ppm)
@@ -14,7 +21,110 @@ void TexturingAlgorithm::setVolume(Volume::Pointer vol)
 
 auto TexturingAlgorithm::getTexture() -> Texture { return result_; }
 
+auto TexturingAlgorithm::computeDirty(const cv::Mat& dirtyMask, int tileSize)
+    -> Texture
+{
+    if (result_.empty()) {
+        throw std::logic_error("No texture to update. Run compute() first.");
+    }
+    auto height = static_cast<int>(ppm_->height());
+    auto width = static_cast<int>(ppm_->width());
+    if (dirtyMask.rows != height or dirtyMask.cols != width) {
+        throw std::invalid_argument("Dirty mask does not match PPM size");
+    }
+
+    // Recompute one tile at a time against a cropped PPM
+    auto fullPPM = ppm_;
+    auto texture = result_;
+    const cv::Rect bounds(0, 0, width, height);
+    try {
+        for (int y = 0; y < height; y += tileSize) {
+            for (int x = 0; x < width; x += tileSize) {
+                auto roi = cv::Rect(x, y, tileSize, tileSize) & bounds;
+                const auto tileMask = dirtyMask(roi);
+                if (cv::countNonZero(tileMask) == 0) {
+                    continue;
+                }
+
+                ppm_ = PerPixelMap::New(PerPixelMap::Crop(
+                    *fullPPM, roi.y, roi.x, roi.height, roi.width));
+                auto tile = compute();
+                for (std::size_t i = 0; i < texture.size() and i < tile.size();
+                     i++) {
+                    tile[i].copyTo(texture[i](roi), tileMask);
+                }
+            }
+        }
+    } catch (...) {
+        ppm_ = fullPPM;
+        result_ = texture;
+        throw;
+    }
+
+    // Restore the full-size inputs and outputs
+    ppm_ = fullPPM;
+    result_ = texture;
+    return result_;
+}
+
+void TexturingAlgorithm::setSamplingBatchSize(std::size_t b)
+{
+    batchSize_ = std::max<std::size_t>(b, 1);
+}
+
+auto TexturingAlgorithm::samplingBatchSize() const -> std::size_t
+{
+    return batchSize_;
+}
+
 auto TexturingAlgorithm::progressIterations() const -> std::size_t
 {
     return ppm_->numMappings();
-}
\ No newline at end of file
+}
+
+void TexturingAlgorithm::parallelForEachMapping_(const MappingFunction& fn)
+{
+    // Get the mappings
+    auto mappings = ppm_->getMappingCoords();
+
+    // Sort the mappings by Z-value
+    std::sort(
+        mappings.begin(), mappings.end(),
+        [&](const auto& lhs, const auto& rhs) {
+            return (*ppm_)(lhs.y, lhs.x)[2] < (*ppm_)(rhs.y, rhs.x)[2];
+        });
+
+    // Split into contiguous batches
+    const auto numMappings = mappings.size();
+    const auto numBatches = (numMappings + batchSize_ - 1) / batchSize_;
+
+    // Iterate through the batches
+    std::size_t completed{0};
+    progressStarted();
+    auto start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t b = 0; b < numBatches; b++) {
+        const auto first = b * batchSize_;
+        const auto last = std::min(first + batchSize_, numMappings);
+        for (auto i = first; i < last; i++) {
+            fn(mappings[i].y, mappings[i].x);
+        }
+
+#pragma omp critical(texturing_progress)
+        {
+            completed += last - first;
+            progressUpdated(completed);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    progressComplete();
+
+    // Report throughput
+    std::chrono::duration<double> secs = end - start;
+    auto rate = (secs.count() > 0)
+                    ? static_cast<double>(numMappings) / secs.count()
+                    : 0.0;
+    Logger()->info(
+        "Sampled {} mappings in {:.3f} s ({:.0f} mapped pixels/s)",
+        numMappings, secs.count(), rate);
+}
@@ -1,6 +1,6 @@
 #include "vc/texturing/ThicknessTexture.hpp"
 
-#include "vc/core/util/Iteration.hpp"
+#include <opencv2/core.hpp>
 
 using namespace volcart;
 using namespace volcart::texturing;
@@ -31,23 +31,9 @@ auto ThicknessTexture::compute() -> Texture
     // Output image
     cv::Mat image = cv::Mat::zeros(height, width, CV_32FC1);
 
-    // Get the mappings
-    auto mappings = ppm_->getMappingCoords();
-
-    // Sort the mappings by Z-value
-    std::sort(
-        mappings.begin(), mappings.end(),
-        [&](const auto& lhs, const auto& rhs) {
-            return (*ppm_)(lhs.y, lhs.x)[2] < (*ppm_)(rhs.y, rhs.x)[2];
-        });
-
-    // Iterate through the mappings
-    progressStarted();
-    for (const auto [idx, coord] : enumerate(mappings)) {
-        progressUpdated(idx);
-
-        // Generate the neighborhood
-        const auto [y, x] = coord;
+    // Measure the layer thickness at every mapping
+    parallelForEachMapping_([&](std::size_t y, std::size_t x) {
+        // Get the position and normal
         const auto& m = ppm_->getMapping(y, x);
         const cv::Vec3d pos{m[0], m[1], m[2]};
         const cv::Vec3d normal{m[3], m[4], m[5]};
@@ -95,8 +81,7 @@ auto ThicknessTexture::compute() -> Texture
                 image.at<float>(v, u) = static_cast<float>(dist);
             }
         }
-    }
-    progressComplete();
+    });
 
     if (normalize_) {
         cv::normalize(image, image, 0.0, 1.0, cv::NORM_MINMAX);
@@ -55,6 +55,56 @@ TEST(PPMGeneratorTest, RegressionTest)
     }
 }
 
+TEST(PPMGeneratorTest, IncrementalMatchesFullCompute)
+{
+    // Build Plane UVMap
+    vc::shapes::Plane plane(5, 5);
+    auto mesh = plane.itkMesh();
+    auto uvMap = vc::UVMap::New();
+    std::size_t id{0};
+    for (const auto uv : vc::range2D(5, 5)) {
+        auto u = double(uv.first) / 4.0;
+        auto v = double(uv.second) / 4.0;
+        uvMap->set(id++, {u, v});
+    }
+
+    // Generate the original PPM
+    vct::PPMGenerator ppmGenerator;
+    ppmGenerator.setDimensions(100, 100);
+    ppmGenerator.setMesh(mesh);
+    ppmGenerator.setUVMap(uvMap);
+    auto ppm = ppmGenerator.compute();
+
+    // Move the center vertex and update only the affected region
+    auto pt = mesh->GetPoint(12);
+    pt[2] += 1.0;
+    mesh->SetPoint(12, pt);
+    ppmGenerator.setDirtyVertices({12});
+    ppm = ppmGenerator.computeIncremental(ppm);
+    auto dirty = ppmGenerator.dirtyMask();
+    EXPECT_GT(cv::countNonZero(dirty), 0);
+    EXPECT_LT(cv::countNonZero(dirty), 100 * 100);
+
+    // Compare against a full regeneration
+    vct::PPMGenerator fullGenerator;
+    fullGenerator.setDimensions(100, 100);
+    fullGenerator.setMesh(mesh);
+    fullGenerator.setUVMap(uvMap);
+    auto expected = fullGenerator.compute();
+    for (const auto [y, x] : vc::range2D(100, 100)) {
+        EXPECT_EQ(ppm->hasMapping(y, x), expected->hasMapping(y, x));
+
+        if (not ppm->hasMapping(y, x)) {
+            continue;
+        }
+
+        EXPECT_EQ(ppm->getMapping(y, x), expected->getMapping(y, x));
+        EXPECT_EQ(
+            ppm->cellMap().at<std::int32_t>(y, x),
+            expected->cellMap().at<std::int32_t>(y, x));
+    }
+}
+
 TEST_P(PPMGeneratorTest, PerformanceTest)
 {
     // Build Plane
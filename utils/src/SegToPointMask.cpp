@@ -6,7 +6,9 @@
 
 #include "vc/app_support/ProgressIndicator.hpp"
 #include "vc/core/filesystem.hpp"
+#include "vc/core/io/FileFilters.hpp"
 #include "vc/core/io/PointSetIO.hpp"
+#include "vc/core/io/VolumetricMaskIO.hpp"
 #include "vc/core/types/PointSet.hpp"
 #include "vc/core/types/VolumePkg.hpp"
 #include "vc/core/util/Logging.hpp"
@@ -34,7 +36,8 @@ auto main(int argc, char* argv[]) -> int
         ("input-pts,i", po::value<std::string>()->required(),
             "Path to an input point set representing a segmentation")
         ("output-pts,o", po::value<std::string>()->required(),
-         "Path to a directory to store the output point mask");
+         "Path to the output point mask. Masks with the .vcvm extension are "
+         "written in the compact VolumetricMask format.");
 
     // TFF options
     po::options_description tffOptions("Thinned Flood Fill Segmentation Options");
@@ -125,6 +128,10 @@ auto main(int argc, char* argv[]) -> int
 
     // Save the mask
     vc::Logger()->info("Saving mask");
+    if (vc::io::FileExtensionFilter(outPath, {"vcvm"})) {
+        vc::io::WriteVolumetricMask(outPath, *mask);
+        return EXIT_SUCCESS;
+    }
     vc::PointSet<cv::Vec3i> maskPts;
     maskPts.append(mask->as_vector());
     vc::PointSetIO<cv::Vec3i>::WritePointSet(outPath, maskPts);
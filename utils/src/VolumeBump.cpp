@@ -1,9 +1,11 @@
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <iomanip>
 #include <limits>
-#include <map>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <opencv2/core.hpp>
@@ -135,52 +137,58 @@ auto main(int argc, char* argv[]) -> int
             return lhs.pos[2] < rhs.pos[2];
         });
 
-    // Iterate through the mappings
-    int currentZ = -1;
-    cv::Mat currentSlice;
-    std::map<int, cv::Mat> bumpedSlices;
-    for (const auto& pixel : mappings) {
-        // Get integer coordinates
-        auto x = static_cast<int>(std::floor(pixel.pos[0]));
-        auto y = static_cast<int>(std::floor(pixel.pos[1]));
-        auto z = static_cast<int>(std::floor(pixel.pos[2]));
-
-        // Skip if this mapping is outside the volume bounds
-        if (!volume->isInBounds(x, y, z)) {
+    // Group the mappings into runs which share a slice
+    std::vector<std::pair<std::size_t, std::size_t>> sliceRuns;
+    for (std::size_t i = 0; i < mappings.size(); i++) {
+        auto z = static_cast<int>(std::floor(mappings[i].pos[2]));
+        if (i == 0 or
+            z != static_cast<int>(std::floor(mappings[i - 1].pos[2]))) {
+            sliceRuns.emplace_back(i, i);
+        }
+        sliceRuns.back().second = i + 1;
+    }
+
+    // Bump each slice independently
+    auto start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t r = 0; r < sliceRuns.size(); r++) {
+        const auto [first, last] = sliceRuns[r];
+        auto z = static_cast<int>(std::floor(mappings[first].pos[2]));
+        if (z < 0 or z >= volume->numSlices()) {
             continue;
         }
 
-        // Check if our slice index has changed
-        if (z != currentZ) {
-            if (!currentSlice.empty()) {
-                // Add this to our image writing queue
-                bumpedSlices[currentZ] = currentSlice;
-
-                // Clear the queue if it's big enough
-                if (bumpedSlices.size() == 100) {
-                    for (const auto& s : bumpedSlices) {
-                        WriteBumpedSlice(s.second, s.first);
-                    }
-                    bumpedSlices.clear();
-                }
+        // Get the slice image for these PPM mappings
+        auto slice = volume->getSliceDataCopy(z);
+        for (auto i = first; i < last; i++) {
+            const auto& pixel = mappings[i];
+
+            // Get integer coordinates
+            auto x = static_cast<int>(std::floor(pixel.pos[0]));
+            auto y = static_cast<int>(std::floor(pixel.pos[1]));
+
+            // Skip if this mapping is outside the volume bounds
+            if (!volume->isInBounds(x, y, z)) {
+                continue;
             }
 
-            // Get the slice image for this PPM mapping
-            currentZ = z;
-            currentSlice = volume->getSliceDataCopy(currentZ);
+            // Use the bump mask as an opacity function on the bumpVal
+            auto bumpOpacity =
+                bumpMask.at<std::uint16_t>(pixel.y, pixel.x) / MAX_16BPC;
+            auto bumped = slice.at<std::uint16_t>(y, x) + bumpOpacity * bumpVal;
+            slice.at<std::uint16_t>(y, x) =
+                static_cast<std::uint16_t>(std::min(bumped, MAX_16BPC));
         }
 
-        // Use the bump mask as an opacity function on the bumpVal
-        auto bumpOpacity =
-            bumpMask.at<std::uint16_t>(pixel.y, pixel.x) / MAX_16BPC;
-        auto bumped =
-            currentSlice.at<std::uint16_t>(y, x) + bumpOpacity * bumpVal;
-        currentSlice.at<std::uint16_t>(y, x) =
-            static_cast<std::uint16_t>(std::min(bumped, MAX_16BPC));
+        WriteBumpedSlice(slice, z);
     }
+    auto end = std::chrono::steady_clock::now();
 
-    // Write the last slice image
-    WriteBumpedSlice(currentSlice, currentZ);
+    // Report throughput
+    std::chrono::duration<double> secs = end - start;
+    vc::Logger()->info(
+        "Bumped {} mappings in {:.3f} s ({:.0f} mapped pixels/s)",
+        mappings.size(), secs.count(), mappings.size() / secs.count());
 }
 
 void WriteBumpedSlice(const cv::Mat& slice, int index)